@@ -0,0 +1,246 @@
+// Copyright 2021 Factor Robotics
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+#include "odrive_fixtures.hpp"
+
+using namespace odrive;
+using namespace odrive_fixtures;
+
+namespace
+{
+// Emulator that counts the transactions it is handed
+class CountingEmulator : public ODriveEmulator
+{
+public:
+  int transfer(
+    std::vector<Transaction> & transactions,
+    std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::time_point::max()) override
+  {
+    transactions_ += transactions.size();
+    return ODriveEmulator::transfer(transactions, deadline);
+  }
+
+  uint64_t transactions() const { return transactions_; }
+
+protected:
+  int transfer(Transaction & transaction) override
+  {
+    transactions_++;
+    return ODriveEmulator::transfer(transaction);
+  }
+
+private:
+  uint64_t transactions_ = 0;
+};
+
+// Reports allocations and transactions per iteration for the measured loop
+class Counters
+{
+public:
+  explicit Counters(benchmark::State & state, const CountingEmulator * emulator = NULL)
+  : state_(state),
+    emulator_(emulator),
+    allocations_(allocations.load()),
+    transactions_(emulator ? emulator->transactions() : 0)
+  {
+  }
+
+  ~Counters()
+  {
+    state_.counters["allocations"] = benchmark::Counter(
+      allocations.load() - allocations_, benchmark::Counter::kAvgIterations);
+    if (emulator_) {
+      state_.counters["transactions"] = benchmark::Counter(
+        emulator_->transactions() - transactions_, benchmark::Counter::kAvgIterations);
+    }
+  }
+
+private:
+  benchmark::State & state_;
+  const CountingEmulator * emulator_;
+  uint64_t allocations_;
+  uint64_t transactions_;
+};
+
+std::vector<std::vector<int64_t>> serialNumbers(size_t boards)
+{
+  std::vector<std::vector<int64_t>> serial_numbers(2);
+  for (size_t i = 0; i < boards; i++) {
+    serial_numbers[0].emplace_back(serial_number_base + i);
+  }
+  return serial_numbers;
+}
+
+// Codec
+
+void BM_EncodePacket(benchmark::State & state)
+{
+  unsigned char packet[ODRIVE_MAX_PACKET_SIZE];
+  short endpoint_id = Endpoint<AXIS__CONTROLLER__INPUT_POS>::id(1);
+  endpoint_id |= 0x8000;
+  float input_pos = 1.0f;
+  Counters counters(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+      encodePacket(packet, 1, endpoint_id, 0, &input_pos, sizeof(input_pos)));
+    benchmark::ClobberMemory();
+  }
+}
+BENCHMARK(BM_EncodePacket);
+
+void BM_EncodePacketTemplate(benchmark::State & state)
+{
+  unsigned char packet[ODRIVE_MAX_PACKET_SIZE];
+  short endpoint_id = Endpoint<AXIS__CONTROLLER__INPUT_POS>::id(1);
+  endpoint_id |= 0x8000;
+  float input_pos = 1.0f;
+  Counters counters(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(encodePacket(
+      packet, 1, endpoint_id, Endpoint<AXIS__CONTROLLER__INPUT_POS>::write_packet, &input_pos));
+    benchmark::ClobberMemory();
+  }
+}
+BENCHMARK(BM_EncodePacketTemplate);
+
+void BM_DecodePacket(benchmark::State & state)
+{
+  unsigned char packet[ODRIVE_MAX_PACKET_SIZE];
+  float pos_estimate = 1.0f;
+  encodeResponse(packet, 1, &pos_estimate, sizeof(pos_estimate));
+  Counters counters(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(decodePacket(packet, 6, &pos_estimate, sizeof(pos_estimate)));
+    benchmark::ClobberMemory();
+  }
+}
+BENCHMARK(BM_DecodePacket);
+
+// The emulator looks boards up the same way the USB transport looks up devices
+void BM_ResolveDevice(benchmark::State & state)
+{
+  ODriveEmulator emulator;
+  emulator.init(serialNumbers(state.range(0)));
+  int64_t serial_number = serial_number_base + state.range(0) - 1;
+  Counters counters(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(emulator.resolve(serial_number));
+  }
+}
+BENCHMARK(BM_ResolveDevice)->Arg(1)->Arg(4)->Arg(12);
+
+// Round trips against an emulated device without latency, i.e. the software cost of one
+// transaction through the full codec
+
+void BM_RoundTripRead(benchmark::State & state)
+{
+  CountingEmulator emulator;
+  emulator.init(serialNumbers(1));
+  float pos_estimate;
+  Counters counters(state, &emulator);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+      emulator.read<AXIS__ENCODER__POS_ESTIMATE>(serial_number_base, 0, pos_estimate));
+  }
+}
+BENCHMARK(BM_RoundTripRead);
+
+void BM_RoundTripWrite(benchmark::State & state)
+{
+  CountingEmulator emulator;
+  emulator.init(serialNumbers(1));
+  float input_pos = 1.0f;
+  Counters counters(state, &emulator);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+      emulator.write<AXIS__CONTROLLER__INPUT_POS>(serial_number_base, 0, input_pos));
+  }
+}
+BENCHMARK(BM_RoundTripWrite);
+
+// A batch of one, addressed by serial number (0) or by resolved device index (1)
+void BM_RoundTripBatch(benchmark::State & state)
+{
+  CountingEmulator emulator;
+  emulator.init(serialNumbers(1));
+  float pos_estimate;
+  std::vector<Transaction> transactions;
+  transactions.emplace_back(
+    Transaction::read<AXIS__ENCODER__POS_ESTIMATE>(serial_number_base, 0, pos_estimate));
+  if (state.range(0)) {
+    transactions[0].device = emulator.resolve(serial_number_base);
+  }
+  Counters counters(state, &emulator);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(emulator.transfer(transactions));
+  }
+}
+BENCHMARK(BM_RoundTripBatch)->Arg(0)->Arg(1);
+
+// Full read() and write() cycles of the hardware interface on zero-latency emulated ODrives,
+// two joints per board, with acknowledged (1) or unacknowledged (0) setpoints
+
+hardware_interface::HardwareInfo hardwareInfo(size_t joints, bool acknowledge_setpoints)
+{
+  hardware_interface::HardwareInfo info = odrive_fixtures::hardwareInfo(joints);
+  info.hardware_parameters["acknowledge_setpoints"] = acknowledge_setpoints ? "1" : "0";
+  return info;
+}
+
+void BM_Cycle(benchmark::State & state)
+{
+  CountingEmulator emulator;
+  odrive_hardware_interface::ODriveHardwareInterface hardware(&emulator);
+  hardware_interface::HardwareInfo info = hardwareInfo(state.range(0), state.range(1));
+  if (hardware.on_init(info) != CallbackReturn::SUCCESS) {
+    state.SkipWithError("on_init failed");
+    return;
+  }
+  hardware.on_configure(rclcpp_lifecycle::State());
+  hardware.on_activate(rclcpp_lifecycle::State());
+
+  std::vector<std::string> start_interfaces;
+  for (const hardware_interface::ComponentInfo & joint : info.joints) {
+    start_interfaces.emplace_back(joint.name + "/" + hardware_interface::HW_IF_POSITION);
+  }
+  hardware.prepare_command_mode_switch(start_interfaces, {});
+  hardware.perform_command_mode_switch(start_interfaces, {});
+
+  rclcpp::Time time;
+  rclcpp::Duration period(0, 1000000);
+  Counters counters(state, &emulator);
+  for (auto _ : state) {
+    hardware.read(time, period);
+    hardware.write(time, period);
+  }
+  state.counters["joints"] = state.range(0);
+}
+void cycleArguments(benchmark::internal::Benchmark * benchmark)
+{
+  for (int joints : {2, 6, 12, 24}) {
+    for (int acknowledge_setpoints : {1, 0}) {
+      benchmark->Args({joints, acknowledge_setpoints});
+    }
+  }
+}
+BENCHMARK(BM_Cycle)->Apply(cycleArguments);
+}  // namespace
+
+BENCHMARK_MAIN();
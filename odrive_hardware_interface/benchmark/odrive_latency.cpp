@@ -0,0 +1,353 @@
+// Copyright 2021 Factor Robotics
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "odrive_fixtures.hpp"
+
+// Drives read()/write() at a fixed rate against emulated ODrives and reports cycle times, compute
+// times, overruns and the latency from write() to the torque setpoint reaching the board.
+//
+//   odrive_latency [--rate 1000] [--duration 10] [--joints 6] [--io_thread]
+//                  [--latency 0.0001] [--jitter 0.00002] [--priority 0] [--cpu -1]
+//                  [--bin 10] [--format json|csv] [--output file] [--param key=value]...
+//
+// Every --param is passed on as a hardware parameter, e.g. --param acknowledge_setpoints=0.
+
+using namespace odrive;
+using namespace odrive_fixtures;
+
+namespace
+{
+// Emulator that timestamps every torque setpoint it receives. Each cycle commands its own cycle
+// number as the torque, so arrivals can be matched to the write() that issued them.
+class LatencyEmulator : public ODriveEmulator
+{
+public:
+  LatencyEmulator(
+    std::chrono::nanoseconds latency, std::chrono::nanoseconds jitter, size_t cycles,
+    size_t joints)
+  : ODriveEmulator(latency, jitter), joints_(joints), arrivals_((cycles + 1) * joints)
+  {
+  }
+
+  // Time each joint first received each cycle's setpoint, or the epoch if it never did
+  const std::vector<std::chrono::steady_clock::time_point> & arrivals() const { return arrivals_; }
+
+protected:
+  void written(Board & board, short endpoint_id) override
+  {
+    ODriveEmulator::written(board, endpoint_id);
+
+    short endpoint;
+    uint8_t axis;
+    if (!axisEndpoint(endpoint_id, endpoint, axis) || endpoint != AXIS__CONTROLLER__INPUT_TORQUE) {
+      return;
+    }
+
+    size_t joint = board_map_.at(board.serial_number) * ODRIVE_EMULATOR_AXIS_COUNT + axis;
+    float cycle = load<endpoint_type_t<AXIS__CONTROLLER__INPUT_TORQUE>>(board, endpoint_id);
+    if (joint >= joints_ || !(cycle >= 1) || cycle * joints_ >= arrivals_.size()) {
+      return;
+    }
+
+    std::chrono::steady_clock::time_point & arrival = arrivals_[(size_t)cycle * joints_ + joint];
+    if (arrival == std::chrono::steady_clock::time_point()) {
+      arrival = received_;
+    }
+  }
+
+private:
+  size_t joints_;
+  std::vector<std::chrono::steady_clock::time_point> arrivals_;
+};
+
+struct Distribution
+{
+  std::string name;
+  std::vector<int64_t> samples;
+
+  int64_t percentile(double p) const
+  {
+    if (samples.empty()) {
+      return 0;
+    }
+    size_t rank = std::ceil(p * samples.size());
+    return samples[std::min(samples.size(), std::max<size_t>(rank, 1)) - 1];
+  }
+
+  double mean() const
+  {
+    double sum = 0;
+    for (int64_t sample : samples) {
+      sum += sample;
+    }
+    return samples.empty() ? 0 : sum / samples.size();
+  }
+
+  std::vector<size_t> histogram(int64_t bin, size_t bins) const
+  {
+    std::vector<size_t> counts(bins, 0);
+    for (int64_t sample : samples) {
+      counts[std::min<size_t>(bins - 1, std::max<int64_t>(0, sample) / bin)]++;
+    }
+    return counts;
+  }
+};
+
+int usage()
+{
+  std::cerr << "usage: odrive_latency [--rate hz] [--duration s] [--joints n] [--io_thread]"
+            << " [--latency s] [--jitter s] [--priority p] [--cpu n] [--bin us]"
+            << " [--format json|csv] [--output file] [--param key=value]..." << std::endl;
+  return 1;
+}
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  std::map<std::string, std::string> options = {
+    {"rate", "1000"},      {"duration", "10"}, {"joints", "6"},  {"latency", "0.0001"},
+    {"jitter", "0.00002"}, {"priority", "0"},  {"cpu", "-1"},    {"bin", "10"},
+    {"format", "json"},    {"output", ""},     {"io_thread", "0"}};
+  std::map<std::string, std::string> parameters;
+  for (int i = 1; i < argc; i++) {
+    std::string option = argv[i];
+    if (option.compare(0, 2, "--") != 0) {
+      return usage();
+    }
+    option = option.substr(2);
+
+    if (option == "io_thread") {
+      options[option] = "1";
+    } else if (i + 1 >= argc || (!options.count(option) && option != "param")) {
+      return usage();
+    } else if (option == "param") {
+      std::string parameter = argv[++i];
+      size_t separator = parameter.find('=');
+      if (separator == std::string::npos) {
+        return usage();
+      }
+      parameters[parameter.substr(0, separator)] = parameter.substr(separator + 1);
+    } else {
+      options[option] = argv[++i];
+    }
+  }
+
+  double rate = std::stod(options["rate"]);
+  size_t joints = std::stoul(options["joints"]);
+  bool io_thread = std::stoi(options["io_thread"]);
+  if (rate <= 0 || !joints || (options["format"] != "json" && options["format"] != "csv")) {
+    return usage();
+  }
+  std::chrono::nanoseconds period((int64_t)(1e9 / rate));
+  size_t cycles = std::stod(options["duration"]) * rate;
+
+  hardware_interface::HardwareInfo info = hardwareInfo(joints);
+  info.hardware_parameters["io_thread"] = io_thread ? "1" : "0";
+  info.hardware_parameters["io_thread_period"] = std::to_string(period.count() * 1e-9);
+  for (const auto & parameter : parameters) {
+    info.hardware_parameters[parameter.first] = parameter.second;
+  }
+
+  // Keep stdout clean for the results, the transport reports to it while starting up
+  std::streambuf * stdout_buffer = std::cout.rdbuf(std::cerr.rdbuf());
+
+  LatencyEmulator emulator(
+    std::chrono::nanoseconds((int64_t)(std::stod(options["latency"]) * 1e9)),
+    std::chrono::nanoseconds((int64_t)(std::stod(options["jitter"]) * 1e9)), cycles, joints);
+  odrive_hardware_interface::ODriveHardwareInterface hardware(&emulator);
+  if (hardware.on_init(info) != CallbackReturn::SUCCESS) {
+    std::cout.rdbuf(stdout_buffer);
+    std::cerr << "Failed to initialize the hardware interface" << std::endl;
+    return 1;
+  }
+
+  std::vector<hardware_interface::CommandInterface> command_interfaces =
+    hardware.export_command_interfaces();
+  std::vector<hardware_interface::StateInterface> state_interfaces =
+    hardware.export_state_interfaces();
+  std::vector<hardware_interface::CommandInterface *> efforts;
+  std::vector<std::string> start_interfaces;
+  for (const hardware_interface::ComponentInfo & joint : info.joints) {
+    start_interfaces.emplace_back(joint.name + "/" + hardware_interface::HW_IF_EFFORT);
+    for (hardware_interface::CommandInterface & command_interface : command_interfaces) {
+      if (command_interface.get_name() == start_interfaces.back()) {
+        efforts.emplace_back(&command_interface);
+      }
+    }
+  }
+
+  int priority = std::stoi(options["priority"]);
+  if (priority > 0) {
+    sched_param param;
+    param.sched_priority = priority;
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param)) {
+      std::cerr << "Failed to set priority" << std::endl;
+    }
+  }
+  int cpu = std::stoi(options["cpu"]);
+  if (cpu >= 0) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set)) {
+      std::cerr << "Failed to set affinity" << std::endl;
+    }
+  }
+
+  rclcpp::Time time;
+  rclcpp::Duration duration(0, period.count());
+  if (
+    hardware.on_configure(rclcpp_lifecycle::State()) != CallbackReturn::SUCCESS ||
+    hardware.on_activate(rclcpp_lifecycle::State()) != CallbackReturn::SUCCESS) {
+    std::cout.rdbuf(stdout_buffer);
+    std::cerr << "Failed to activate the hardware interface" << std::endl;
+    return 1;
+  }
+  hardware.read(time, duration);
+  hardware.prepare_command_mode_switch(start_interfaces, {});
+  hardware.perform_command_mode_switch(start_interfaces, {});
+
+  Distribution cycle_time{"cycle_time", {}};
+  Distribution compute_time{"compute_time", {}};
+  Distribution latency{"latency", {}};
+  cycle_time.samples.reserve(cycles);
+  compute_time.samples.reserve(cycles);
+  latency.samples.reserve(cycles * joints);
+  std::vector<std::chrono::steady_clock::time_point> issued(cycles + 1);
+  size_t overruns = 0;
+
+  std::chrono::steady_clock::time_point wakeup = std::chrono::steady_clock::now() + period;
+  std::chrono::steady_clock::time_point last_start;
+  for (size_t cycle = 1; cycle <= cycles; cycle++) {
+    std::this_thread::sleep_until(wakeup);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (cycle > 1) {
+      cycle_time.samples.emplace_back((start - last_start).count());
+    }
+    last_start = start;
+
+    hardware.read(time, duration);
+    for (hardware_interface::CommandInterface * effort : efforts) {
+      effort->set_value(cycle);
+    }
+    issued[cycle] = std::chrono::steady_clock::now();
+    hardware.write(time, duration);
+
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    compute_time.samples.emplace_back((end - start).count());
+
+    // An overrun skips the missed wakeups rather than bursting to catch up
+    wakeup += period;
+    if (end > wakeup) {
+      overruns++;
+      wakeup = end;
+    }
+  }
+
+  hardware.on_deactivate(rclcpp_lifecycle::State());
+  std::cout.rdbuf(stdout_buffer);
+
+  size_t undelivered = 0;
+  for (size_t cycle = 1; cycle <= cycles; cycle++) {
+    for (size_t joint = 0; joint < joints; joint++) {
+      std::chrono::steady_clock::time_point arrival = emulator.arrivals()[cycle * joints + joint];
+      if (arrival == std::chrono::steady_clock::time_point()) {
+        undelivered++;
+      } else {
+        latency.samples.emplace_back((arrival - issued[cycle]).count());
+      }
+    }
+  }
+
+  std::vector<Distribution *> distributions = {&cycle_time, &compute_time, &latency};
+  int64_t bin = std::max<int64_t>(1, std::stod(options["bin"]) * 1e3);
+  int64_t range = 0;
+  for (Distribution * distribution : distributions) {
+    std::sort(distribution->samples.begin(), distribution->samples.end());
+    if (!distribution->samples.empty()) {
+      range = std::max(range, distribution->samples.back());
+    }
+  }
+  size_t bins = range / bin + 1;
+
+  std::ofstream file;
+  if (!options["output"].empty()) {
+    file.open(options["output"]);
+    if (!file) {
+      std::cerr << "Failed to open " << options["output"] << std::endl;
+      return 1;
+    }
+  }
+  std::ostream & out = file.is_open() ? file : std::cout;
+
+  if (options["format"] == "csv") {
+    out << "bin_us";
+    for (Distribution * distribution : distributions) {
+      out << "," << distribution->name;
+    }
+    out << "\n";
+
+    std::vector<std::vector<size_t>> histograms;
+    for (Distribution * distribution : distributions) {
+      histograms.emplace_back(distribution->histogram(bin, bins));
+    }
+    for (size_t i = 0; i < bins; i++) {
+      out << i * bin * 1e-3;
+      for (const std::vector<size_t> & histogram : histograms) {
+        out << "," << histogram[i];
+      }
+      out << "\n";
+    }
+  } else {
+    out << "{\n";
+    out << "  \"rate\": " << rate << ",\n";
+    out << "  \"joints\": " << joints << ",\n";
+    out << "  \"io_thread\": " << (io_thread ? "true" : "false") << ",\n";
+    out << "  \"cycles\": " << cycles << ",\n";
+    out << "  \"overruns\": " << overruns << ",\n";
+    out << "  \"undelivered\": " << undelivered << ",\n";
+    out << "  \"bin_us\": " << bin * 1e-3;
+    for (Distribution * distribution : distributions) {
+      out << ",\n  \"" << distribution->name << "\": {\n";
+      out << "    \"samples\": " << distribution->samples.size() << ",\n";
+      out << "    \"mean_us\": " << distribution->mean() * 1e-3 << ",\n";
+      out << "    \"p50_us\": " << distribution->percentile(0.5) * 1e-3 << ",\n";
+      out << "    \"p90_us\": " << distribution->percentile(0.9) * 1e-3 << ",\n";
+      out << "    \"p99_us\": " << distribution->percentile(0.99) * 1e-3 << ",\n";
+      out << "    \"p999_us\": " << distribution->percentile(0.999) * 1e-3 << ",\n";
+      out << "    \"max_us\": " << distribution->percentile(1) * 1e-3 << ",\n";
+      out << "    \"histogram\": [";
+      std::vector<size_t> histogram = distribution->histogram(bin, bins);
+      for (size_t i = 0; i < bins; i++) {
+        out << (i ? ", " : "") << histogram[i];
+      }
+      out << "]\n  }";
+    }
+    out << "\n}\n";
+  }
+
+  return 0;
+}
@@ -0,0 +1,259 @@
+// Copyright 2021 Factor Robotics
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <linux/can.h>
+#include <sys/socket.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "odrive_hardware_interface/odrive_transport.hpp"
+
+#define ODRIVE_CAN_DEFAULT_HEARTBEAT_TIMEOUT 500
+#define ODRIVE_CAN_COMMAND_COUNT 32
+#define ODRIVE_CAN_NODE_COUNT 64
+#define ODRIVE_CAN_RECEIVE_BATCH 32
+
+namespace odrive
+{
+// CANSimple commands of firmware 0.5. The 11 bit frame id is the node id of an axis followed by
+// the 5 bit command.
+enum CanCommand : uint8_t
+{
+  CAN_HEARTBEAT = 0x01,
+  CAN_GET_MOTOR_ERROR = 0x03,
+  CAN_GET_ENCODER_ERROR = 0x04,
+  CAN_SET_AXIS_REQUESTED_STATE = 0x07,
+  CAN_GET_ENCODER_ESTIMATES = 0x09,
+  CAN_SET_CONTROLLER_MODES = 0x0B,
+  CAN_SET_INPUT_POS = 0x0C,
+  CAN_SET_INPUT_VEL = 0x0D,
+  CAN_SET_INPUT_TORQUE = 0x0E,
+  CAN_GET_IQ = 0x14,
+  CAN_GET_VBUS_VOLTAGE = 0x17,
+  CAN_CLEAR_ERRORS = 0x18,
+  CAN_GET_CONTROLLER_ERROR = 0x1D
+};
+
+// Heartbeat bytes 5 to 7 flag a motor, encoder and controller error, so the error messages only
+// need to be asked for when their flag is set
+#define ODRIVE_CAN_MOTOR_ERROR_FLAG 5
+#define ODRIVE_CAN_ENCODER_ERROR_FLAG 6
+#define ODRIVE_CAN_CONTROLLER_ERROR_FLAG 7
+
+inline canid_t canId(uint8_t node_id, uint8_t command) { return (node_id << 5) | command; }
+
+// An endpoint value as CANSimple carries it: in which message at which byte offset, and whether
+// the board sends that message by itself or only in reply to a remote frame
+struct CanSignal
+{
+  short endpoint;
+  uint8_t command;
+  uint8_t offset;
+  short size;
+  bool polled;
+};
+
+template <int ENDPOINT>
+constexpr CanSignal canSignal(uint8_t command, uint8_t offset, bool polled)
+{
+  return {ENDPOINT, command, offset, Endpoint<ENDPOINT>::size, polled};
+}
+
+static constexpr CanSignal can_signals[] = {
+  canSignal<AXIS__ERROR>(CAN_HEARTBEAT, 0, false),
+  canSignal<AXIS__CURRENT_STATE>(CAN_HEARTBEAT, 4, false),
+  canSignal<AXIS__ENCODER__POS_ESTIMATE>(CAN_GET_ENCODER_ESTIMATES, 0, false),
+  canSignal<AXIS__ENCODER__VEL_ESTIMATE>(CAN_GET_ENCODER_ESTIMATES, 4, false),
+  canSignal<AXIS__MOTOR__ERROR>(CAN_GET_MOTOR_ERROR, 0, true),
+  canSignal<AXIS__ENCODER__ERROR>(CAN_GET_ENCODER_ERROR, 0, true),
+  canSignal<AXIS__CONTROLLER__ERROR>(CAN_GET_CONTROLLER_ERROR, 0, true),
+  canSignal<AXIS__MOTOR__CURRENT_CONTROL__IQ_SETPOINT>(CAN_GET_IQ, 0, true),
+  canSignal<AXIS__MOTOR__CURRENT_CONTROL__IQ_MEASURED>(CAN_GET_IQ, 4, true),
+  canSignal<VBUS_VOLTAGE>(CAN_GET_VBUS_VOLTAGE, 0, true)};
+
+// NULL for endpoints CANSimple cannot read
+const CanSignal * findCanSignal(short endpoint);
+
+// Opens a raw CAN socket on the interface that only receives standard frames of the given nodes.
+// Returns the socket or a libusb error code.
+int openCanSocket(const std::string & interface, const std::vector<uint8_t> & node_ids);
+
+// Fixed set of receive buffers for draining a CAN socket with one recvmmsg call
+class CanReceiver
+{
+public:
+  CanReceiver();
+  CanReceiver(const CanReceiver &) = delete;
+  CanReceiver & operator=(const CanReceiver &) = delete;
+
+  // Returns the number of frames received, 0 if none were pending
+  int receive(int socket);
+  const can_frame & frame(int i) const { return frames_[i]; }
+
+private:
+  can_frame frames_[ODRIVE_CAN_RECEIVE_BATCH];
+  iovec vectors_[ODRIVE_CAN_RECEIVE_BATCH];
+  mmsghdr messages_[ODRIVE_CAN_RECEIVE_BATCH];
+};
+
+// Frames to go out together with one sendmmsg call
+class CanSender
+{
+public:
+  void queue(uint8_t node_id, uint8_t command, const void * payload, uint8_t size, bool rtr);
+  bool empty() const { return frames_.empty(); }
+  int send(int socket, std::chrono::steady_clock::time_point deadline);
+  // Bus bits of every frame sent so far
+  uint64_t bits() const { return bits_.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<uint64_t> bits_{0};
+  std::vector<can_frame> frames_;
+  std::vector<iovec> vectors_;
+  std::vector<mmsghdr> messages_;
+};
+
+// ODrives running CANSimple on a SocketCAN interface. Setpoints go out as single frames, and the
+// heartbeat and encoder estimates the boards broadcast are consumed as they arrive, so reading
+// them only copies the latest values. Values CANSimple only sends on request are polled in the
+// background and lag by one transfer once their first reply is in. Thermistor temperatures are
+// not part of CANSimple and read as NaN, other endpoints fail with LIBUSB_ERROR_NOT_SUPPORTED.
+class ODriveCAN : public ODriveTransport
+{
+public:
+  explicit ODriveCAN(
+    const std::string & interface,
+    std::chrono::milliseconds heartbeat_timeout =
+      std::chrono::milliseconds(ODRIVE_CAN_DEFAULT_HEARTBEAT_TIMEOUT));
+  ~ODriveCAN() override;
+
+  // CANSimple addresses axes rather than boards, so every axis in use needs the node id it was
+  // configured with. Board-level values are asked for through the first node of a board.
+  int addNode(int64_t serial_number, uint8_t axis, uint8_t node_id);
+
+  // Bus bitrate for utilization(), and how often polled values are asked for again once they
+  // arrived. The nodes take turns within the poll period instead of polling in the same batch.
+  void schedule(uint32_t baud_rate, std::chrono::nanoseconds poll_period);
+  // Share of the bus the frames sent and received since the previous call took up. Frames of
+  // other nodes are filtered out and not counted. Safe to call during a transfer.
+  double utilization();
+
+  // Waits up to the heartbeat timeout for every node to show up
+  int init(
+    const std::vector<std::vector<int64_t>> & serial_numbers,
+    size_t pipeline_depth = ODRIVE_DEFAULT_PIPELINE_DEPTH,
+    unsigned int transaction_timeout = ODRIVE_DEFAULT_TRANSACTION_TIMEOUT) override;
+
+  int transfer(
+    std::vector<Transaction> & transactions,
+    std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::time_point::max()) override;
+
+  // CANSimple messages do not depend on how the firmware numbers its endpoints
+  void setEndpointTable(int64_t, const EndpointTable &) override {}
+  int resolve(int64_t serial_number) override;
+  // A board counts as connected while its heartbeats keep coming
+  bool connected(int64_t serial_number) override;
+  uint32_t connections(int64_t serial_number) override;
+  bool fullAccess() const override { return false; }
+
+protected:
+  int transfer(Transaction & transaction) override;
+
+private:
+  struct Node
+  {
+    int node_id;
+    // Latest payload of every message and which of them arrived or are being asked for
+    unsigned char messages[ODRIVE_CAN_COMMAND_COUNT][CAN_MAX_DLEN];
+    uint32_t received;
+    uint32_t requested;
+    std::chrono::steady_clock::time_point request_time;
+    // When the next poll is due, and whether the current batch polls
+    std::chrono::steady_clock::time_point poll_time;
+    bool polling;
+    // Inputs as last sent, which the setpoint messages carry together
+    float input_pos;
+    float input_vel;
+    float input_torque;
+    int32_t control_mode;
+    int32_t input_mode;
+    uint8_t pending_inputs;
+    // Whether the axis is part of the current batch, got a frame in it and had its watchdog fed
+    bool active;
+    bool sent;
+    bool fed;
+  };
+
+  struct Board
+  {
+    int64_t serial_number;
+    Node nodes[ODRIVE_AXIS_COUNT];
+    bool connected;
+    uint32_t connections;
+    std::chrono::steady_clock::time_point heartbeat_time;
+    std::chrono::steady_clock::time_point connect_time;
+  };
+
+  // A read that waits for the first reply to a message
+  struct Waiting
+  {
+    Transaction * transaction;
+    Node * node;
+    const CanSignal * signal;
+  };
+
+  std::string interface_;
+  std::chrono::milliseconds heartbeat_timeout_;
+  std::chrono::milliseconds transaction_timeout_;
+  int socket_;
+  uint32_t baud_rate_;
+  std::chrono::nanoseconds poll_period_;
+
+  std::atomic<uint64_t> received_bits_;
+  uint64_t utilization_bits_;
+  std::chrono::steady_clock::time_point utilization_time_;
+
+  std::map<int64_t, size_t> board_map_;
+  std::vector<Board> boards_;
+  // Board and axis of every node id as board * ODRIVE_AXIS_COUNT + axis, -1 if unused
+  int node_map_[ODRIVE_CAN_NODE_COUNT];
+
+  CanReceiver receiver_;
+  CanSender sender_;
+  std::vector<Waiting> waiting_;
+  std::vector<Node *> active_nodes_;
+
+  Board * board(const Transaction & transaction);
+  void receive(std::chrono::steady_clock::time_point now);
+  void expire(Board & board, std::chrono::steady_clock::time_point now);
+  int serve(Board & board, Transaction & transaction, std::chrono::steady_clock::time_point now);
+  int serveRead(
+    Node & node, Transaction & transaction, const CanSignal & signal,
+    std::chrono::steady_clock::time_point now);
+  int serveWrite(Node & node, short endpoint, const Transaction & transaction);
+  bool pollDue(Node & node, std::chrono::steady_clock::time_point now);
+  void activate(Node & node);
+  void flushInputs(Node & node);
+  void finish(Node & node);
+  static int copyValue(Transaction & transaction, const void * value, size_t size);
+  static int16_t scaledFeedforward(float value);
+};
+}  // namespace odrive
@@ -0,0 +1,73 @@
+// Copyright 2021 Factor Robotics
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "odrive_hardware_interface/odrive_can.hpp"
+
+namespace odrive
+{
+// CANSimple front end for emulated ODrives, to test ODriveCAN on a vcan interface. Every axis
+// answers on the node id from its AXIS__CONFIG__CAN__NODE_ID, or stays off the bus if that is
+// out of range, and broadcasts its heartbeat and encoder estimates at
+// AXIS__CONFIG__CAN__HEARTBEAT_RATE_MS and ..._ENCODER_RATE_MS. Received frames become
+// transactions on the boards and feed the watchdog of their axis, as in firmware.
+class ODriveCANEmulator
+{
+public:
+  // The boards are only accessed from the emulator thread while it runs
+  explicit ODriveCANEmulator(ODriveTransport & boards);
+  ~ODriveCANEmulator();
+
+  int start(const std::string & interface, const std::vector<int64_t> & serial_numbers);
+  void stop();
+
+private:
+  struct Node
+  {
+    int64_t serial_number;
+    uint8_t axis;
+    uint8_t node_id;
+    std::chrono::milliseconds heartbeat_period;
+    std::chrono::milliseconds encoder_period;
+    std::chrono::steady_clock::time_point next_heartbeat;
+    std::chrono::steady_clock::time_point next_encoder;
+  };
+
+  ODriveTransport & boards_;
+  int socket_;
+  std::vector<Node> nodes_;
+  int node_map_[ODRIVE_CAN_NODE_COUNT];
+  std::vector<Transaction> transactions_;
+
+  CanReceiver receiver_;
+  CanSender sender_;
+
+  std::thread thread_;
+  std::atomic<bool> running_;
+
+  void run();
+  void handle(const can_frame & frame);
+  void reply(const Node & node, uint8_t command);
+  void broadcast(
+    const Node & node, uint8_t command, std::chrono::milliseconds period,
+    std::chrono::steady_clock::time_point & next, std::chrono::steady_clock::time_point now);
+};
+}  // namespace odrive
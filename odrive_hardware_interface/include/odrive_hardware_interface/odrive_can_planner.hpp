@@ -0,0 +1,62 @@
+// Copyright 2021 Factor Robotics
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <linux/can.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace odrive
+{
+// Bits of a standard frame with size data bytes, or of a remote frame for size 0, with the most
+// stuff bits its length allows
+constexpr int canWorstCaseBits(int size) { return 47 + 8 * size + (34 + 8 * size - 1) / 4; }
+
+// Bits the frame takes on the bus with its actual stuff bits, including the interframe space
+int canFrameBits(const can_frame & frame);
+
+// What one axis puts on the bus. Periods are in seconds, 0 if the message is not sent.
+struct CanAxisTraffic
+{
+  uint8_t node_id;
+  double encoder_period;
+  double heartbeat_period;
+  // Bus voltage is polled through the first node of every board
+  bool polls_vbus;
+};
+
+struct CanPlan
+{
+  // How often ODriveCAN polls values CANSimple only sends on request
+  double poll_period;
+  // Worst-case share of the bus and worst-case time from queueing a frame until it is through,
+  // for the setpoints and the broadcast encoder estimates
+  double utilization;
+  double setpoint_latency;
+  double telemetry_latency;
+  bool feasible;
+};
+
+// Worst-case analysis of the traffic ODriveCAN and the boards generate: one setpoint frame per
+// axis and update, the broadcasts at their rates and the polls with their replies. Every frame
+// must get through within its period under CAN priority arbitration, and the utilization must
+// stay below max_utilization. Error messages are left out, since they are only polled while the
+// heartbeat flags an error. Without a poll period the shortest multiple of the update period of
+// up to 64 that is feasible is chosen.
+CanPlan planCanTraffic(
+  const std::vector<CanAxisTraffic> & axes, uint32_t baud_rate, double update_period,
+  double max_utilization, double poll_period = 0);
+}  // namespace odrive
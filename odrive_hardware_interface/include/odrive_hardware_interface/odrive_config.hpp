@@ -0,0 +1,93 @@
+// Copyright 2021 Factor Robotics
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <limits>
+#include <type_traits>
+
+#include "odrive_hardware_interface/odrive_protocol.hpp"
+
+namespace odrive
+{
+// Axis settings pushed at startup, in the order they are written. They are named like the joint
+// parameters that set them.
+enum AxisConfigField
+{
+  CONFIG_WATCHDOG_TIMEOUT,
+  CONFIG_ENABLE_WATCHDOG,
+  CONFIG_POS_GAIN,
+  CONFIG_VEL_GAIN,
+  CONFIG_VEL_INTEGRATOR_GAIN,
+  CONFIG_VEL_LIMIT,
+  CONFIG_CURRENT_LIM,
+  CONFIG_INPUT_FILTER_BANDWIDTH,
+  CONFIG_TORQUE_CONSTANT,
+  AXIS_CONFIG_FIELDS
+};
+
+// A setting as a float for comparing, or NaN if unknown, and as the bool a flag endpoint
+// transfers
+struct ConfigValue
+{
+  float value = std::numeric_limits<float>::quiet_NaN();
+  bool flag = false;
+};
+
+inline float & configStorage(ConfigValue & config, float *) { return config.value; }
+inline bool & configStorage(ConfigValue & config, bool *) { return config.flag; }
+
+template <int ENDPOINT>
+Transaction readConfig(int64_t serial_number, uint8_t axis, ConfigValue & config)
+{
+  return Transaction::read<ENDPOINT>(
+    serial_number, axis, configStorage(config, (endpoint_type_t<ENDPOINT> *)NULL));
+}
+
+template <int ENDPOINT>
+Transaction writeConfig(int64_t serial_number, uint8_t axis, ConfigValue & config)
+{
+  return Transaction::write<ENDPOINT>(
+    serial_number, axis, configStorage(config, (endpoint_type_t<ENDPOINT> *)NULL));
+}
+
+struct AxisConfigEndpoint
+{
+  const char * name;
+  bool flag;
+  Transaction (*read)(int64_t, uint8_t, ConfigValue &);
+  // NULL for settings that are only read from the board
+  Transaction (*write)(int64_t, uint8_t, ConfigValue &);
+};
+
+template <int ENDPOINT>
+constexpr AxisConfigEndpoint axisConfigEndpoint(const char * name, bool writable = true)
+{
+  return {name, std::is_same<endpoint_type_t<ENDPOINT>, bool>::value, &readConfig<ENDPOINT>,
+          writable ? &writeConfig<ENDPOINT> : NULL};
+}
+
+// In AxisConfigField order
+static constexpr AxisConfigEndpoint axis_config_endpoints[AXIS_CONFIG_FIELDS] = {
+  axisConfigEndpoint<AXIS__CONFIG__WATCHDOG_TIMEOUT>("watchdog_timeout"),
+  axisConfigEndpoint<AXIS__CONFIG__ENABLE_WATCHDOG>("enable_watchdog"),
+  axisConfigEndpoint<AXIS__CONTROLLER__CONFIG__POS_GAIN>("pos_gain"),
+  axisConfigEndpoint<AXIS__CONTROLLER__CONFIG__VEL_GAIN>("vel_gain"),
+  axisConfigEndpoint<AXIS__CONTROLLER__CONFIG__VEL_INTEGRATOR_GAIN>("vel_integrator_gain"),
+  axisConfigEndpoint<AXIS__CONTROLLER__CONFIG__VEL_LIMIT>("vel_limit"),
+  axisConfigEndpoint<AXIS__MOTOR__CONFIG__CURRENT_LIM>("current_lim"),
+  axisConfigEndpoint<AXIS__CONTROLLER__CONFIG__INPUT_FILTER_BANDWIDTH>("input_filter_bandwidth"),
+  // A torque_constant parameter only overrides the board's value in the unit conversion
+  axisConfigEndpoint<AXIS__MOTOR__CONFIG__TORQUE_CONSTANT>("torque_constant", false)};
+}  // namespace odrive
@@ -0,0 +1,160 @@
+// Copyright 2021 Factor Robotics
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "odrive_hardware_interface/odrive_transport.hpp"
+
+#define ODRIVE_EMULATOR_AXIS_COUNT 2
+#define ODRIVE_EMULATOR_ENDPOINT_COUNT 1024
+
+namespace odrive
+{
+// In-process stand-in for a set of ODrives. Every transaction is encoded into a Fibre packet,
+// served from a value store indexed by endpoint id and decoded again, taking a configurable
+// latency with uniform jitter per transaction and pipelining up to pipeline_depth of them.
+class ODriveEmulator : public ODriveTransport
+{
+public:
+  ODriveEmulator(
+    std::chrono::nanoseconds latency = std::chrono::nanoseconds(0),
+    std::chrono::nanoseconds jitter = std::chrono::nanoseconds(0));
+  ~ODriveEmulator() override;
+
+  int init(
+    const std::vector<std::vector<int64_t>> & serial_numbers,
+    size_t pipeline_depth = ODRIVE_DEFAULT_PIPELINE_DEPTH,
+    unsigned int transaction_timeout = ODRIVE_DEFAULT_TRANSACTION_TIMEOUT) override;
+
+  int transfer(
+    std::vector<Transaction> & transactions,
+    std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::time_point::max()) override;
+
+  void setEndpointTable(int64_t serial_number, const EndpointTable & table) override;
+  int resolve(int64_t serial_number) override;
+  bool connected(int64_t serial_number) override;
+  uint32_t connections(int64_t serial_number) override;
+
+  // Direct access to the emulated endpoint values, e.g. to preset a configuration. The axis is
+  // ignored for board-level endpoints.
+  template <int ENDPOINT>
+  void set(int64_t serial_number, uint8_t axis, endpoint_type_t<ENDPOINT> value)
+  {
+    Board * emulated_board = board(serial_number);
+    if (emulated_board) {
+      store(*emulated_board, endpointId<ENDPOINT>(axis), value);
+    }
+  }
+
+  template <int ENDPOINT>
+  endpoint_type_t<ENDPOINT> get(int64_t serial_number, uint8_t axis)
+  {
+    endpoint_type_t<ENDPOINT> value = {};
+    Board * emulated_board = board(serial_number);
+    if (emulated_board) {
+      value = load<endpoint_type_t<ENDPOINT>>(*emulated_board, endpointId<ENDPOINT>(axis));
+    }
+    return value;
+  }
+
+  // JSON descriptor served on endpoint 0 by every board, which also decides how the emulated
+  // firmware numbers its endpoints. Defaults to the layout of odrive_endpoints.hpp.
+  void setDescriptor(const std::string & descriptor);
+
+protected:
+  struct Board
+  {
+    int64_t serial_number;
+    // How requests to this board are addressed, as set by setEndpointTable()
+    EndpointTable endpoints;
+    short sequence_number;
+    std::chrono::steady_clock::time_point boot_time;
+    // Little endian payload of every endpoint, each in its own 8 byte cell
+    std::vector<uint64_t> values;
+    // When each pipeline slot becomes free within the current batch
+    std::vector<std::chrono::steady_clock::time_point> slots;
+  };
+
+  std::map<int64_t, size_t> board_map_;
+  std::vector<Board> boards_;
+
+  // When the request being served reaches the board, i.e. the end of its emulated latency. Lets
+  // the hooks timestamp what they receive.
+  std::chrono::steady_clock::time_point received_;
+
+  int transfer(Transaction & transaction) override;
+
+  // Hooks for emulating board behaviour, called before every batch and after every write or
+  // function call the board receives
+  virtual void reset(Board & board);
+  virtual void update(Board & board, std::chrono::steady_clock::time_point now);
+  virtual void written(Board & board, short endpoint_id);
+
+  Board * board(int64_t serial_number);
+
+  template <typename T>
+  static void store(Board & board, short endpoint_id, const T & value)
+  {
+    static_assert(sizeof(T) <= sizeof(uint64_t), "Endpoint value does not fit a cell");
+    std::memcpy(&board.values[endpoint_id], &value, sizeof(value));
+  }
+
+  template <typename T>
+  static T load(const Board & board, short endpoint_id)
+  {
+    T value;
+    std::memcpy(&value, &board.values[endpoint_id], sizeof(value));
+    return value;
+  }
+
+  template <int ENDPOINT>
+  static short endpointId(uint8_t axis)
+  {
+    return Endpoint<ENDPOINT>::per_axis ? Endpoint<ENDPOINT>::id(axis) : ENDPOINT;
+  }
+
+  // Splits a per-axis endpoint id into its axis0 endpoint and the axis number. Returns false for
+  // board-level endpoints.
+  static bool axisEndpoint(short endpoint_id, short & endpoint, uint8_t & axis);
+
+private:
+  std::chrono::nanoseconds latency_;
+  std::chrono::nanoseconds jitter_;
+  std::mt19937 random_;
+
+  size_t pipeline_depth_;
+  std::chrono::milliseconds transaction_timeout_;
+
+  std::string descriptor_;
+  uint16_t descriptor_crc_;
+  // Id from odrive_endpoints.hpp for every endpoint id of the emulated firmware, empty if they
+  // are the same
+  std::vector<short> compiled_ids_;
+
+  int exchange(Board & board, Transaction & transaction);
+  int serve(
+    Board & board, const unsigned char * request_packet, int length,
+    unsigned char * response_packet);
+  int serveDescriptor(const Request & request, unsigned char * response_packet);
+  std::chrono::nanoseconds sampleLatency();
+};
+}  // namespace odrive
@@ -0,0 +1,455 @@
+// Copyright 2021 Factor Robotics
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "odrive_hardware_interface/odrive_endpoints.hpp"
+
+namespace odrive
+{
+// Descriptor path and Fibre type of every endpoint in odrive_endpoints.hpp, generated from it.
+// Per-axis endpoints are listed under axis0.
+struct EndpointName
+{
+  short id;
+  const char * path;
+  const char * type;
+};
+
+static constexpr EndpointName endpoint_names[] = {
+  {ERROR, "error", "uint8"},
+  {VBUS_VOLTAGE, "vbus_voltage", "float"},
+  {IBUS, "ibus", "float"},
+  {IBUS_REPORT_FILTER_K, "ibus_report_filter_k", "float"},
+  {SERIAL_NUMBER, "serial_number", "uint64"},
+  {HW_VERSION_MAJOR, "hw_version_major", "uint8"},
+  {HW_VERSION_MINOR, "hw_version_minor", "uint8"},
+  {HW_VERSION_VARIANT, "hw_version_variant", "uint8"},
+  {FW_VERSION_MAJOR, "fw_version_major", "uint8"},
+  {FW_VERSION_MINOR, "fw_version_minor", "uint8"},
+  {FW_VERSION_REVISION, "fw_version_revision", "uint8"},
+  {FW_VERSION_UNRELEASED, "fw_version_unreleased", "uint8"},
+  {BRAKE_RESISTOR_ARMED, "brake_resistor_armed", "bool"},
+  {BRAKE_RESISTOR_SATURATED, "brake_resistor_saturated", "bool"},
+  {BRAKE_RESISTOR_CURRENT, "brake_resistor_current", "float"},
+  {N_EVT_SAMPLING, "n_evt_sampling", "uint32"},
+  {N_EVT_CONTROL_LOOP, "n_evt_control_loop", "uint32"},
+  {TASK_TIMERS_ARMED, "task_timers_armed", "bool"},
+  {TASK_TIMES__SAMPLING__START_TIME, "task_times.sampling.start_time", "uint32"},
+  {TASK_TIMES__SAMPLING__END_TIME, "task_times.sampling.end_time", "uint32"},
+  {TASK_TIMES__SAMPLING__LENGTH, "task_times.sampling.length", "uint32"},
+  {TASK_TIMES__SAMPLING__MAX_LENGTH, "task_times.sampling.max_length", "uint32"},
+  {TASK_TIMES__CONTROL_LOOP_MISC__START_TIME, "task_times.control_loop_misc.start_time", "uint32"},
+  {TASK_TIMES__CONTROL_LOOP_MISC__END_TIME, "task_times.control_loop_misc.end_time", "uint32"},
+  {TASK_TIMES__CONTROL_LOOP_MISC__LENGTH, "task_times.control_loop_misc.length", "uint32"},
+  {TASK_TIMES__CONTROL_LOOP_MISC__MAX_LENGTH, "task_times.control_loop_misc.max_length", "uint32"},
+  {TASK_TIMES__CONTROL_LOOP_CHECKS__START_TIME, "task_times.control_loop_checks.start_time", "uint32"},
+  {TASK_TIMES__CONTROL_LOOP_CHECKS__END_TIME, "task_times.control_loop_checks.end_time", "uint32"},
+  {TASK_TIMES__CONTROL_LOOP_CHECKS__LENGTH, "task_times.control_loop_checks.length", "uint32"},
+  {TASK_TIMES__CONTROL_LOOP_CHECKS__MAX_LENGTH, "task_times.control_loop_checks.max_length", "uint32"},
+  {TASK_TIMES__DC_CALIB_WAIT__START_TIME, "task_times.dc_calib_wait.start_time", "uint32"},
+  {TASK_TIMES__DC_CALIB_WAIT__END_TIME, "task_times.dc_calib_wait.end_time", "uint32"},
+  {TASK_TIMES__DC_CALIB_WAIT__LENGTH, "task_times.dc_calib_wait.length", "uint32"},
+  {TASK_TIMES__DC_CALIB_WAIT__MAX_LENGTH, "task_times.dc_calib_wait.max_length", "uint32"},
+  {SYSTEM_STATS__UPTIME, "system_stats.uptime", "uint32"},
+  {SYSTEM_STATS__MIN_HEAP_SPACE, "system_stats.min_heap_space", "uint32"},
+  {SYSTEM_STATS__MAX_STACK_USAGE_AXIS, "system_stats.max_stack_usage_axis", "uint32"},
+  {SYSTEM_STATS__MAX_STACK_USAGE_USB, "system_stats.max_stack_usage_usb", "uint32"},
+  {SYSTEM_STATS__MAX_STACK_USAGE_UART, "system_stats.max_stack_usage_uart", "uint32"},
+  {SYSTEM_STATS__MAX_STACK_USAGE_CAN, "system_stats.max_stack_usage_can", "uint32"},
+  {SYSTEM_STATS__MAX_STACK_USAGE_STARTUP, "system_stats.max_stack_usage_startup", "uint32"},
+  {SYSTEM_STATS__MAX_STACK_USAGE_ANALOG, "system_stats.max_stack_usage_analog", "uint32"},
+  {SYSTEM_STATS__STACK_SIZE_AXIS, "system_stats.stack_size_axis", "uint32"},
+  {SYSTEM_STATS__STACK_SIZE_USB, "system_stats.stack_size_usb", "uint32"},
+  {SYSTEM_STATS__STACK_SIZE_UART, "system_stats.stack_size_uart", "uint32"},
+  {SYSTEM_STATS__STACK_SIZE_STARTUP, "system_stats.stack_size_startup", "uint32"},
+  {SYSTEM_STATS__STACK_SIZE_CAN, "system_stats.stack_size_can", "uint32"},
+  {SYSTEM_STATS__STACK_SIZE_ANALOG, "system_stats.stack_size_analog", "uint32"},
+  {SYSTEM_STATS__PRIO_AXIS, "system_stats.prio_axis", "int32"},
+  {SYSTEM_STATS__PRIO_USB, "system_stats.prio_usb", "int32"},
+  {SYSTEM_STATS__PRIO_UART, "system_stats.prio_uart", "int32"},
+  {SYSTEM_STATS__PRIO_STARTUP, "system_stats.prio_startup", "int32"},
+  {SYSTEM_STATS__PRIO_CAN, "system_stats.prio_can", "int32"},
+  {SYSTEM_STATS__PRIO_ANALOG, "system_stats.prio_analog", "int32"},
+  {SYSTEM_STATS__USB__RX_CNT, "system_stats.usb.rx_cnt", "uint32"},
+  {SYSTEM_STATS__USB__TX_CNT, "system_stats.usb.tx_cnt", "uint32"},
+  {SYSTEM_STATS__USB__TX_OVERRUN_CNT, "system_stats.usb.tx_overrun_cnt", "uint32"},
+  {SYSTEM_STATS__I2C__ADDR, "system_stats.i2c.addr", "uint8"},
+  {SYSTEM_STATS__I2C__ADDR_MATCH_CNT, "system_stats.i2c.addr_match_cnt", "uint32"},
+  {SYSTEM_STATS__I2C__RX_CNT, "system_stats.i2c.rx_cnt", "uint32"},
+  {SYSTEM_STATS__I2C__ERROR_CNT, "system_stats.i2c.error_cnt", "uint32"},
+  {USER_CONFIG_LOADED, "user_config_loaded", "uint32"},
+  {MISCONFIGURED, "misconfigured", "bool"},
+  {OSCILLOSCOPE__SIZE, "oscilloscope.size", "uint32"},
+  {CAN__ERROR, "can.error", "uint8"},
+  {CAN__CONFIG__BAUD_RATE, "can.config.baud_rate", "uint32"},
+  {CAN__CONFIG__PROTOCOL, "can.config.protocol", "uint8"},
+  {TEST_PROPERTY, "test_property", "uint32"},
+  {OTP_VALID, "otp_valid", "bool"},
+  {CONFIG__ENABLE_UART_A, "config.enable_uart_a", "bool"},
+  {CONFIG__ENABLE_UART_B, "config.enable_uart_b", "bool"},
+  {CONFIG__ENABLE_UART_C, "config.enable_uart_c", "bool"},
+  {CONFIG__UART_A_BAUDRATE, "config.uart_a_baudrate", "uint32"},
+  {CONFIG__UART_B_BAUDRATE, "config.uart_b_baudrate", "uint32"},
+  {CONFIG__UART_C_BAUDRATE, "config.uart_c_baudrate", "uint32"},
+  {CONFIG__ENABLE_CAN_A, "config.enable_can_a", "bool"},
+  {CONFIG__ENABLE_I2C_A, "config.enable_i2c_a", "bool"},
+  {CONFIG__USB_CDC_PROTOCOL, "config.usb_cdc_protocol", "uint8"},
+  {CONFIG__UART0_PROTOCOL, "config.uart0_protocol", "uint8"},
+  {CONFIG__UART1_PROTOCOL, "config.uart1_protocol", "uint8"},
+  {CONFIG__UART2_PROTOCOL, "config.uart2_protocol", "uint8"},
+  {CONFIG__MAX_REGEN_CURRENT, "config.max_regen_current", "float"},
+  {CONFIG__BRAKE_RESISTANCE, "config.brake_resistance", "float"},
+  {CONFIG__ENABLE_BRAKE_RESISTOR, "config.enable_brake_resistor", "bool"},
+  {CONFIG__DC_BUS_UNDERVOLTAGE_TRIP_LEVEL, "config.dc_bus_undervoltage_trip_level", "float"},
+  {CONFIG__DC_BUS_OVERVOLTAGE_TRIP_LEVEL, "config.dc_bus_overvoltage_trip_level", "float"},
+  {CONFIG__ENABLE_DC_BUS_OVERVOLTAGE_RAMP, "config.enable_dc_bus_overvoltage_ramp", "bool"},
+  {CONFIG__DC_BUS_OVERVOLTAGE_RAMP_START, "config.dc_bus_overvoltage_ramp_start", "float"},
+  {CONFIG__DC_BUS_OVERVOLTAGE_RAMP_END, "config.dc_bus_overvoltage_ramp_end", "float"},
+  {CONFIG__DC_MAX_POSITIVE_CURRENT, "config.dc_max_positive_current", "float"},
+  {CONFIG__DC_MAX_NEGATIVE_CURRENT, "config.dc_max_negative_current", "float"},
+  {CONFIG__ERROR_GPIO_PIN, "config.error_gpio_pin", "uint32"},
+  {CONFIG__GPIO3_ANALOG_MAPPING__MIN, "config.gpio3_analog_mapping.min", "float"},
+  {CONFIG__GPIO3_ANALOG_MAPPING__MAX, "config.gpio3_analog_mapping.max", "float"},
+  {CONFIG__GPIO4_ANALOG_MAPPING__MIN, "config.gpio4_analog_mapping.min", "float"},
+  {CONFIG__GPIO4_ANALOG_MAPPING__MAX, "config.gpio4_analog_mapping.max", "float"},
+  {CONFIG__GPIO1_MODE, "config.gpio1_mode", "uint8"},
+  {CONFIG__GPIO2_MODE, "config.gpio2_mode", "uint8"},
+  {CONFIG__GPIO3_MODE, "config.gpio3_mode", "uint8"},
+  {CONFIG__GPIO4_MODE, "config.gpio4_mode", "uint8"},
+  {CONFIG__GPIO5_MODE, "config.gpio5_mode", "uint8"},
+  {CONFIG__GPIO6_MODE, "config.gpio6_mode", "uint8"},
+  {CONFIG__GPIO7_MODE, "config.gpio7_mode", "uint8"},
+  {CONFIG__GPIO8_MODE, "config.gpio8_mode", "uint8"},
+  {CONFIG__GPIO9_MODE, "config.gpio9_mode", "uint8"},
+  {CONFIG__GPIO10_MODE, "config.gpio10_mode", "uint8"},
+  {CONFIG__GPIO11_MODE, "config.gpio11_mode", "uint8"},
+  {CONFIG__GPIO12_MODE, "config.gpio12_mode", "uint8"},
+  {CONFIG__GPIO13_MODE, "config.gpio13_mode", "uint8"},
+  {CONFIG__GPIO14_MODE, "config.gpio14_mode", "uint8"},
+  {CONFIG__GPIO15_MODE, "config.gpio15_mode", "uint8"},
+  {CONFIG__GPIO16_MODE, "config.gpio16_mode", "uint8"},
+  {CONFIG__GPIO1_PWM_MAPPING__MIN, "config.gpio1_pwm_mapping.min", "float"},
+  {CONFIG__GPIO1_PWM_MAPPING__MAX, "config.gpio1_pwm_mapping.max", "float"},
+  {CONFIG__GPIO2_PWM_MAPPING__MIN, "config.gpio2_pwm_mapping.min", "float"},
+  {CONFIG__GPIO2_PWM_MAPPING__MAX, "config.gpio2_pwm_mapping.max", "float"},
+  {CONFIG__GPIO3_PWM_MAPPING__MIN, "config.gpio3_pwm_mapping.min", "float"},
+  {CONFIG__GPIO3_PWM_MAPPING__MAX, "config.gpio3_pwm_mapping.max", "float"},
+  {CONFIG__GPIO4_PWM_MAPPING__MIN, "config.gpio4_pwm_mapping.min", "float"},
+  {CONFIG__GPIO4_PWM_MAPPING__MAX, "config.gpio4_pwm_mapping.max", "float"},
+  {ERASE_CONFIGURATION, "erase_configuration", "function"},
+  {REBOOT, "reboot", "function"},
+  {ENTER_DFU_MODE, "enter_dfu_mode", "function"},
+  {CLEAR_ERRORS, "clear_errors", "function"},
+  {AXIS__ERROR, "axis0.error", "uint32"},
+  {AXIS__STEP_DIR_ACTIVE, "axis0.step_dir_active", "bool"},
+  {AXIS__LAST_DRV_FAULT, "axis0.last_drv_fault", "uint32"},
+  {AXIS__STEPS, "axis0.steps", "int64"},
+  {AXIS__CURRENT_STATE, "axis0.current_state", "uint8"},
+  {AXIS__REQUESTED_STATE, "axis0.requested_state", "uint8"},
+  {AXIS__IS_HOMED, "axis0.is_homed", "bool"},
+  {AXIS__CONFIG__STARTUP_MOTOR_CALIBRATION, "axis0.config.startup_motor_calibration", "bool"},
+  {AXIS__CONFIG__STARTUP_ENCODER_INDEX_SEARCH, "axis0.config.startup_encoder_index_search", "bool"},
+  {AXIS__CONFIG__STARTUP_ENCODER_OFFSET_CALIBRATION, "axis0.config.startup_encoder_offset_calibration", "bool"},
+  {AXIS__CONFIG__STARTUP_CLOSED_LOOP_CONTROL, "axis0.config.startup_closed_loop_control", "bool"},
+  {AXIS__CONFIG__STARTUP_HOMING, "axis0.config.startup_homing", "bool"},
+  {AXIS__CONFIG__ENABLE_STEP_DIR, "axis0.config.enable_step_dir", "bool"},
+  {AXIS__CONFIG__STEP_DIR_ALWAYS_ON, "axis0.config.step_dir_always_on", "bool"},
+  {AXIS__CONFIG__ENABLE_SENSORLESS_MODE, "axis0.config.enable_sensorless_mode", "bool"},
+  {AXIS__CONFIG__WATCHDOG_TIMEOUT, "axis0.config.watchdog_timeout", "float"},
+  {AXIS__CONFIG__ENABLE_WATCHDOG, "axis0.config.enable_watchdog", "bool"},
+  {AXIS__CONFIG__STEP_GPIO_PIN, "axis0.config.step_gpio_pin", "uint16"},
+  {AXIS__CONFIG__DIR_GPIO_PIN, "axis0.config.dir_gpio_pin", "uint16"},
+  {AXIS__CONFIG__CALIBRATION_LOCKIN__CURRENT, "axis0.config.calibration_lockin.current", "float"},
+  {AXIS__CONFIG__CALIBRATION_LOCKIN__RAMP_TIME, "axis0.config.calibration_lockin.ramp_time", "float"},
+  {AXIS__CONFIG__CALIBRATION_LOCKIN__RAMP_DISTANCE, "axis0.config.calibration_lockin.ramp_distance", "float"},
+  {AXIS__CONFIG__CALIBRATION_LOCKIN__ACCEL, "axis0.config.calibration_lockin.accel", "float"},
+  {AXIS__CONFIG__CALIBRATION_LOCKIN__VEL, "axis0.config.calibration_lockin.vel", "float"},
+  {AXIS__CONFIG__SENSORLESS_RAMP__CURRENT, "axis0.config.sensorless_ramp.current", "float"},
+  {AXIS__CONFIG__SENSORLESS_RAMP__RAMP_TIME, "axis0.config.sensorless_ramp.ramp_time", "float"},
+  {AXIS__CONFIG__SENSORLESS_RAMP__RAMP_DISTANCE, "axis0.config.sensorless_ramp.ramp_distance", "float"},
+  {AXIS__CONFIG__SENSORLESS_RAMP__ACCEL, "axis0.config.sensorless_ramp.accel", "float"},
+  {AXIS__CONFIG__SENSORLESS_RAMP__VEL, "axis0.config.sensorless_ramp.vel", "float"},
+  {AXIS__CONFIG__SENSORLESS_RAMP__FINISH_DISTANCE, "axis0.config.sensorless_ramp.finish_distance", "float"},
+  {AXIS__CONFIG__SENSORLESS_RAMP__FINISH_ON_VEL, "axis0.config.sensorless_ramp.finish_on_vel", "bool"},
+  {AXIS__CONFIG__SENSORLESS_RAMP__FINISH_ON_DISTANCE, "axis0.config.sensorless_ramp.finish_on_distance", "bool"},
+  {AXIS__CONFIG__SENSORLESS_RAMP__FINISH_ON_ENC_IDX, "axis0.config.sensorless_ramp.finish_on_enc_idx", "bool"},
+  {AXIS__CONFIG__GENERAL_LOCKIN__CURRENT, "axis0.config.general_lockin.current", "float"},
+  {AXIS__CONFIG__GENERAL_LOCKIN__RAMP_TIME, "axis0.config.general_lockin.ramp_time", "float"},
+  {AXIS__CONFIG__GENERAL_LOCKIN__RAMP_DISTANCE, "axis0.config.general_lockin.ramp_distance", "float"},
+  {AXIS__CONFIG__GENERAL_LOCKIN__ACCEL, "axis0.config.general_lockin.accel", "float"},
+  {AXIS__CONFIG__GENERAL_LOCKIN__VEL, "axis0.config.general_lockin.vel", "float"},
+  {AXIS__CONFIG__GENERAL_LOCKIN__FINISH_DISTANCE, "axis0.config.general_lockin.finish_distance", "float"},
+  {AXIS__CONFIG__GENERAL_LOCKIN__FINISH_ON_VEL, "axis0.config.general_lockin.finish_on_vel", "bool"},
+  {AXIS__CONFIG__GENERAL_LOCKIN__FINISH_ON_DISTANCE, "axis0.config.general_lockin.finish_on_distance", "bool"},
+  {AXIS__CONFIG__GENERAL_LOCKIN__FINISH_ON_ENC_IDX, "axis0.config.general_lockin.finish_on_enc_idx", "bool"},
+  {AXIS__CONFIG__CAN__NODE_ID, "axis0.config.can.node_id", "uint32"},
+  {AXIS__CONFIG__CAN__IS_EXTENDED, "axis0.config.can.is_extended", "bool"},
+  {AXIS__CONFIG__CAN__HEARTBEAT_RATE_MS, "axis0.config.can.heartbeat_rate_ms", "uint32"},
+  {AXIS__CONFIG__CAN__ENCODER_RATE_MS, "axis0.config.can.encoder_rate_ms", "uint32"},
+  {AXIS__MOTOR__LAST_ERROR_TIME, "axis0.motor.last_error_time", "float"},
+  {AXIS__MOTOR__ERROR, "axis0.motor.error", "uint64"},
+  {AXIS__MOTOR__IS_ARMED, "axis0.motor.is_armed", "bool"},
+  {AXIS__MOTOR__IS_CALIBRATED, "axis0.motor.is_calibrated", "bool"},
+  {AXIS__MOTOR__CURRENT_MEAS_PHA, "axis0.motor.current_meas_pha", "float"},
+  {AXIS__MOTOR__CURRENT_MEAS_PHB, "axis0.motor.current_meas_phb", "float"},
+  {AXIS__MOTOR__CURRENT_MEAS_PHC, "axis0.motor.current_meas_phc", "float"},
+  {AXIS__MOTOR__DC_CALIB_PHA, "axis0.motor.dc_calib_pha", "float"},
+  {AXIS__MOTOR__DC_CALIB_PHB, "axis0.motor.dc_calib_phb", "float"},
+  {AXIS__MOTOR__DC_CALIB_PHC, "axis0.motor.dc_calib_phc", "float"},
+  {AXIS__MOTOR__I_BUS, "axis0.motor.i_bus", "float"},
+  {AXIS__MOTOR__PHASE_CURRENT_REV_GAIN, "axis0.motor.phase_current_rev_gain", "float"},
+  {AXIS__MOTOR__EFFECTIVE_CURRENT_LIM, "axis0.motor.effective_current_lim", "float"},
+  {AXIS__MOTOR__MAX_ALLOWED_CURRENT, "axis0.motor.max_allowed_current", "float"},
+  {AXIS__MOTOR__MAX_DC_CALIB, "axis0.motor.max_dc_calib", "float"},
+  {AXIS__MOTOR__FET_THERMISTOR__TEMPERATURE, "axis0.motor.fet_thermistor.temperature", "float"},
+  {AXIS__MOTOR__FET_THERMISTOR__CONFIG__TEMP_LIMIT_LOWER, "axis0.motor.fet_thermistor.config.temp_limit_lower", "float"},
+  {AXIS__MOTOR__FET_THERMISTOR__CONFIG__TEMP_LIMIT_UPPER, "axis0.motor.fet_thermistor.config.temp_limit_upper", "float"},
+  {AXIS__MOTOR__FET_THERMISTOR__CONFIG__ENABLED, "axis0.motor.fet_thermistor.config.enabled", "bool"},
+  {AXIS__MOTOR__MOTOR_THERMISTOR__TEMPERATURE, "axis0.motor.motor_thermistor.temperature", "float"},
+  {AXIS__MOTOR__MOTOR_THERMISTOR__CONFIG__GPIO_PIN, "axis0.motor.motor_thermistor.config.gpio_pin", "uint16"},
+  {AXIS__MOTOR__MOTOR_THERMISTOR__CONFIG__POLY_COEFFICIENT_0, "axis0.motor.motor_thermistor.config.poly_coefficient_0", "float"},
+  {AXIS__MOTOR__MOTOR_THERMISTOR__CONFIG__POLY_COEFFICIENT_1, "axis0.motor.motor_thermistor.config.poly_coefficient_1", "float"},
+  {AXIS__MOTOR__MOTOR_THERMISTOR__CONFIG__POLY_COEFFICIENT_2, "axis0.motor.motor_thermistor.config.poly_coefficient_2", "float"},
+  {AXIS__MOTOR__MOTOR_THERMISTOR__CONFIG__POLY_COEFFICIENT_3, "axis0.motor.motor_thermistor.config.poly_coefficient_3", "float"},
+  {AXIS__MOTOR__MOTOR_THERMISTOR__CONFIG__TEMP_LIMIT_LOWER, "axis0.motor.motor_thermistor.config.temp_limit_lower", "float"},
+  {AXIS__MOTOR__MOTOR_THERMISTOR__CONFIG__TEMP_LIMIT_UPPER, "axis0.motor.motor_thermistor.config.temp_limit_upper", "float"},
+  {AXIS__MOTOR__MOTOR_THERMISTOR__CONFIG__ENABLED, "axis0.motor.motor_thermistor.config.enabled", "bool"},
+  {AXIS__MOTOR__CURRENT_CONTROL__P_GAIN, "axis0.motor.current_control.p_gain", "float"},
+  {AXIS__MOTOR__CURRENT_CONTROL__I_GAIN, "axis0.motor.current_control.i_gain", "float"},
+  {AXIS__MOTOR__CURRENT_CONTROL__I_MEASURED_REPORT_FILTER_K, "axis0.motor.current_control.i_measured_report_filter_k", "float"},
+  {AXIS__MOTOR__CURRENT_CONTROL__ID_SETPOINT, "axis0.motor.current_control.id_setpoint", "float"},
+  {AXIS__MOTOR__CURRENT_CONTROL__IQ_SETPOINT, "axis0.motor.current_control.iq_setpoint", "float"},
+  {AXIS__MOTOR__CURRENT_CONTROL__VD_SETPOINT, "axis0.motor.current_control.vd_setpoint", "float"},
+  {AXIS__MOTOR__CURRENT_CONTROL__VQ_SETPOINT, "axis0.motor.current_control.vq_setpoint", "float"},
+  {AXIS__MOTOR__CURRENT_CONTROL__PHASE, "axis0.motor.current_control.phase", "float"},
+  {AXIS__MOTOR__CURRENT_CONTROL__PHASE_VEL, "axis0.motor.current_control.phase_vel", "float"},
+  {AXIS__MOTOR__CURRENT_CONTROL__IALPHA_MEASURED, "axis0.motor.current_control.ialpha_measured", "float"},
+  {AXIS__MOTOR__CURRENT_CONTROL__IBETA_MEASURED, "axis0.motor.current_control.ibeta_measured", "float"},
+  {AXIS__MOTOR__CURRENT_CONTROL__ID_MEASURED, "axis0.motor.current_control.id_measured", "float"},
+  {AXIS__MOTOR__CURRENT_CONTROL__IQ_MEASURED, "axis0.motor.current_control.iq_measured", "float"},
+  {AXIS__MOTOR__CURRENT_CONTROL__POWER, "axis0.motor.current_control.power", "float"},
+  {AXIS__MOTOR__CURRENT_CONTROL__V_CURRENT_CONTROL_INTEGRAL_D, "axis0.motor.current_control.v_current_control_integral_d", "float"},
+  {AXIS__MOTOR__CURRENT_CONTROL__V_CURRENT_CONTROL_INTEGRAL_Q, "axis0.motor.current_control.v_current_control_integral_q", "float"},
+  {AXIS__MOTOR__CURRENT_CONTROL__FINAL_V_ALPHA, "axis0.motor.current_control.final_v_alpha", "float"},
+  {AXIS__MOTOR__CURRENT_CONTROL__FINAL_V_BETA, "axis0.motor.current_control.final_v_beta", "float"},
+  {AXIS__MOTOR__N_EVT_CURRENT_MEASUREMENT, "axis0.motor.n_evt_current_measurement", "uint32"},
+  {AXIS__MOTOR__N_EVT_PWM_UPDATE, "axis0.motor.n_evt_pwm_update", "uint32"},
+  {AXIS__MOTOR__CONFIG__PRE_CALIBRATED, "axis0.motor.config.pre_calibrated", "bool"},
+  {AXIS__MOTOR__CONFIG__POLE_PAIRS, "axis0.motor.config.pole_pairs", "int32"},
+  {AXIS__MOTOR__CONFIG__CALIBRATION_CURRENT, "axis0.motor.config.calibration_current", "float"},
+  {AXIS__MOTOR__CONFIG__RESISTANCE_CALIB_MAX_VOLTAGE, "axis0.motor.config.resistance_calib_max_voltage", "float"},
+  {AXIS__MOTOR__CONFIG__PHASE_INDUCTANCE, "axis0.motor.config.phase_inductance", "float"},
+  {AXIS__MOTOR__CONFIG__PHASE_RESISTANCE, "axis0.motor.config.phase_resistance", "float"},
+  {AXIS__MOTOR__CONFIG__TORQUE_CONSTANT, "axis0.motor.config.torque_constant", "float"},
+  {AXIS__MOTOR__CONFIG__MOTOR_TYPE, "axis0.motor.config.motor_type", "uint8"},
+  {AXIS__MOTOR__CONFIG__CURRENT_LIM, "axis0.motor.config.current_lim", "float"},
+  {AXIS__MOTOR__CONFIG__CURRENT_LIM_MARGIN, "axis0.motor.config.current_lim_margin", "float"},
+  {AXIS__MOTOR__CONFIG__TORQUE_LIM, "axis0.motor.config.torque_lim", "float"},
+  {AXIS__MOTOR__CONFIG__INVERTER_TEMP_LIMIT_LOWER, "axis0.motor.config.inverter_temp_limit_lower", "float"},
+  {AXIS__MOTOR__CONFIG__INVERTER_TEMP_LIMIT_UPPER, "axis0.motor.config.inverter_temp_limit_upper", "float"},
+  {AXIS__MOTOR__CONFIG__REQUESTED_CURRENT_RANGE, "axis0.motor.config.requested_current_range", "float"},
+  {AXIS__MOTOR__CONFIG__CURRENT_CONTROL_BANDWIDTH, "axis0.motor.config.current_control_bandwidth", "float"},
+  {AXIS__MOTOR__CONFIG__ACIM_GAIN_MIN_FLUX, "axis0.motor.config.acim_gain_min_flux", "float"},
+  {AXIS__MOTOR__CONFIG__ACIM_AUTOFLUX_MIN_ID, "axis0.motor.config.acim_autoflux_min_id", "float"},
+  {AXIS__MOTOR__CONFIG__ACIM_AUTOFLUX_ENABLE, "axis0.motor.config.acim_autoflux_enable", "bool"},
+  {AXIS__MOTOR__CONFIG__ACIM_AUTOFLUX_ATTACK_GAIN, "axis0.motor.config.acim_autoflux_attack_gain", "float"},
+  {AXIS__MOTOR__CONFIG__ACIM_AUTOFLUX_DECAY_GAIN, "axis0.motor.config.acim_autoflux_decay_gain", "float"},
+  {AXIS__MOTOR__CONFIG__R_WL_FF_ENABLE, "axis0.motor.config.r_wl_ff_enable", "bool"},
+  {AXIS__MOTOR__CONFIG__BEMF_FF_ENABLE, "axis0.motor.config.bemf_ff_enable", "bool"},
+  {AXIS__MOTOR__CONFIG__I_BUS_HARD_MIN, "axis0.motor.config.i_bus_hard_min", "float"},
+  {AXIS__MOTOR__CONFIG__I_BUS_HARD_MAX, "axis0.motor.config.i_bus_hard_max", "float"},
+  {AXIS__MOTOR__CONFIG__I_LEAK_MAX, "axis0.motor.config.i_leak_max", "float"},
+  {AXIS__MOTOR__CONFIG__DC_CALIB_TAU, "axis0.motor.config.dc_calib_tau", "float"},
+  {AXIS__CONTROLLER__ERROR, "axis0.controller.error", "uint8"},
+  {AXIS__CONTROLLER__LAST_ERROR_TIME, "axis0.controller.last_error_time", "float"},
+  {AXIS__CONTROLLER__INPUT_POS, "axis0.controller.input_pos", "float"},
+  {AXIS__CONTROLLER__INPUT_VEL, "axis0.controller.input_vel", "float"},
+  {AXIS__CONTROLLER__INPUT_TORQUE, "axis0.controller.input_torque", "float"},
+  {AXIS__CONTROLLER__POS_SETPOINT, "axis0.controller.pos_setpoint", "float"},
+  {AXIS__CONTROLLER__VEL_SETPOINT, "axis0.controller.vel_setpoint", "float"},
+  {AXIS__CONTROLLER__TORQUE_SETPOINT, "axis0.controller.torque_setpoint", "float"},
+  {AXIS__CONTROLLER__TRAJECTORY_DONE, "axis0.controller.trajectory_done", "bool"},
+  {AXIS__CONTROLLER__VEL_INTEGRATOR_TORQUE, "axis0.controller.vel_integrator_torque", "float"},
+  {AXIS__CONTROLLER__ANTICOGGING_VALID, "axis0.controller.anticogging_valid", "bool"},
+  {AXIS__CONTROLLER__AUTOTUNING_PHASE, "axis0.controller.autotuning_phase", "float"},
+  {AXIS__CONTROLLER__CONFIG__GAIN_SCHEDULING_WIDTH, "axis0.controller.config.gain_scheduling_width", "float"},
+  {AXIS__CONTROLLER__CONFIG__ENABLE_VEL_LIMIT, "axis0.controller.config.enable_vel_limit", "bool"},
+  {AXIS__CONTROLLER__CONFIG__ENABLE_TORQUE_MODE_VEL_LIMIT, "axis0.controller.config.enable_torque_mode_vel_limit", "bool"},
+  {AXIS__CONTROLLER__CONFIG__ENABLE_GAIN_SCHEDULING, "axis0.controller.config.enable_gain_scheduling", "bool"},
+  {AXIS__CONTROLLER__CONFIG__ENABLE_OVERSPEED_ERROR, "axis0.controller.config.enable_overspeed_error", "bool"},
+  {AXIS__CONTROLLER__CONFIG__CONTROL_MODE, "axis0.controller.config.control_mode", "uint8"},
+  {AXIS__CONTROLLER__CONFIG__INPUT_MODE, "axis0.controller.config.input_mode", "uint8"},
+  {AXIS__CONTROLLER__CONFIG__POS_GAIN, "axis0.controller.config.pos_gain", "float"},
+  {AXIS__CONTROLLER__CONFIG__VEL_GAIN, "axis0.controller.config.vel_gain", "float"},
+  {AXIS__CONTROLLER__CONFIG__VEL_INTEGRATOR_GAIN, "axis0.controller.config.vel_integrator_gain", "float"},
+  {AXIS__CONTROLLER__CONFIG__VEL_LIMIT, "axis0.controller.config.vel_limit", "float"},
+  {AXIS__CONTROLLER__CONFIG__VEL_LIMIT_TOLERANCE, "axis0.controller.config.vel_limit_tolerance", "float"},
+  {AXIS__CONTROLLER__CONFIG__VEL_RAMP_RATE, "axis0.controller.config.vel_ramp_rate", "float"},
+  {AXIS__CONTROLLER__CONFIG__TORQUE_RAMP_RATE, "axis0.controller.config.torque_ramp_rate", "float"},
+  {AXIS__CONTROLLER__CONFIG__CIRCULAR_SETPOINTS, "axis0.controller.config.circular_setpoints", "bool"},
+  {AXIS__CONTROLLER__CONFIG__CIRCULAR_SETPOINT_RANGE, "axis0.controller.config.circular_setpoint_range", "float"},
+  {AXIS__CONTROLLER__CONFIG__STEPS_PER_CIRCULAR_RANGE, "axis0.controller.config.steps_per_circular_range", "int32"},
+  {AXIS__CONTROLLER__CONFIG__HOMING_SPEED, "axis0.controller.config.homing_speed", "float"},
+  {AXIS__CONTROLLER__CONFIG__INERTIA, "axis0.controller.config.inertia", "float"},
+  {AXIS__CONTROLLER__CONFIG__AXIS_TO_MIRROR, "axis0.controller.config.axis_to_mirror", "uint8"},
+  {AXIS__CONTROLLER__CONFIG__MIRROR_RATIO, "axis0.controller.config.mirror_ratio", "float"},
+  {AXIS__CONTROLLER__CONFIG__TORQUE_MIRROR_RATIO, "axis0.controller.config.torque_mirror_ratio", "float"},
+  {AXIS__CONTROLLER__CONFIG__LOAD_ENCODER_AXIS, "axis0.controller.config.load_encoder_axis", "uint8"},
+  {AXIS__CONTROLLER__CONFIG__INPUT_FILTER_BANDWIDTH, "axis0.controller.config.input_filter_bandwidth", "float"},
+  {AXIS__CONTROLLER__CONFIG__ANTICOGGING__INDEX, "axis0.controller.config.anticogging.index", "uint32"},
+  {AXIS__CONTROLLER__CONFIG__ANTICOGGING__PRE_CALIBRATED, "axis0.controller.config.anticogging.pre_calibrated", "bool"},
+  {AXIS__CONTROLLER__CONFIG__ANTICOGGING__CALIB_ANTICOGGING, "axis0.controller.config.anticogging.calib_anticogging", "bool"},
+  {AXIS__CONTROLLER__CONFIG__ANTICOGGING__CALIB_POS_THRESHOLD, "axis0.controller.config.anticogging.calib_pos_threshold", "float"},
+  {AXIS__CONTROLLER__CONFIG__ANTICOGGING__CALIB_VEL_THRESHOLD, "axis0.controller.config.anticogging.calib_vel_threshold", "float"},
+  {AXIS__CONTROLLER__CONFIG__ANTICOGGING__COGGING_RATIO, "axis0.controller.config.anticogging.cogging_ratio", "float"},
+  {AXIS__CONTROLLER__CONFIG__ANTICOGGING__ANTICOGGING_ENABLED, "axis0.controller.config.anticogging.anticogging_enabled", "bool"},
+  {AXIS__CONTROLLER__CONFIG__MECHANICAL_POWER_BANDWIDTH, "axis0.controller.config.mechanical_power_bandwidth", "float"},
+  {AXIS__CONTROLLER__CONFIG__ELECTRICAL_POWER_BANDWIDTH, "axis0.controller.config.electrical_power_bandwidth", "float"},
+  {AXIS__CONTROLLER__CONFIG__SPINOUT_MECHANICAL_POWER_THRESHOLD, "axis0.controller.config.spinout_mechanical_power_threshold", "float"},
+  {AXIS__CONTROLLER__CONFIG__SPINOUT_ELECTRICAL_POWER_THRESHOLD, "axis0.controller.config.spinout_electrical_power_threshold", "float"},
+  {AXIS__CONTROLLER__AUTOTUNING__FREQUENCY, "axis0.controller.autotuning.frequency", "float"},
+  {AXIS__CONTROLLER__AUTOTUNING__POS_AMPLITUDE, "axis0.controller.autotuning.pos_amplitude", "float"},
+  {AXIS__CONTROLLER__AUTOTUNING__VEL_AMPLITUDE, "axis0.controller.autotuning.vel_amplitude", "float"},
+  {AXIS__CONTROLLER__AUTOTUNING__TORQUE_AMPLITUDE, "axis0.controller.autotuning.torque_amplitude", "float"},
+  {AXIS__CONTROLLER__MECHANICAL_POWER, "axis0.controller.mechanical_power", "float"},
+  {AXIS__CONTROLLER__ELECTRICAL_POWER, "axis0.controller.electrical_power", "float"},
+  {AXIS__CONTROLLER__START_ANTICOGGING_CALIBRATION, "axis0.controller.start_anticogging_calibration", "function"},
+  {AXIS__ENCODER__ERROR, "axis0.encoder.error", "uint16"},
+  {AXIS__ENCODER__IS_READY, "axis0.encoder.is_ready", "bool"},
+  {AXIS__ENCODER__INDEX_FOUND, "axis0.encoder.index_found", "bool"},
+  {AXIS__ENCODER__SHADOW_COUNT, "axis0.encoder.shadow_count", "int32"},
+  {AXIS__ENCODER__COUNT_IN_CPR, "axis0.encoder.count_in_cpr", "int32"},
+  {AXIS__ENCODER__INTERPOLATION, "axis0.encoder.interpolation", "float"},
+  {AXIS__ENCODER__PHASE, "axis0.encoder.phase", "float"},
+  {AXIS__ENCODER__POS_ESTIMATE, "axis0.encoder.pos_estimate", "float"},
+  {AXIS__ENCODER__POS_ESTIMATE_COUNTS, "axis0.encoder.pos_estimate_counts", "float"},
+  {AXIS__ENCODER__POS_CIRCULAR, "axis0.encoder.pos_circular", "float"},
+  {AXIS__ENCODER__POS_CPR_COUNTS, "axis0.encoder.pos_cpr_counts", "float"},
+  {AXIS__ENCODER__DELTA_POS_CPR_COUNTS, "axis0.encoder.delta_pos_cpr_counts", "float"},
+  {AXIS__ENCODER__HALL_STATE, "axis0.encoder.hall_state", "uint8"},
+  {AXIS__ENCODER__VEL_ESTIMATE, "axis0.encoder.vel_estimate", "float"},
+  {AXIS__ENCODER__VEL_ESTIMATE_COUNTS, "axis0.encoder.vel_estimate_counts", "float"},
+  {AXIS__ENCODER__CALIB_SCAN_RESPONSE, "axis0.encoder.calib_scan_response", "float"},
+  {AXIS__ENCODER__POS_ABS, "axis0.encoder.pos_abs", "int32"},
+  {AXIS__ENCODER__SPI_ERROR_RATE, "axis0.encoder.spi_error_rate", "float"},
+  {AXIS__ENCODER__CONFIG__MODE, "axis0.encoder.config.mode", "uint16"},
+  {AXIS__ENCODER__CONFIG__USE_INDEX, "axis0.encoder.config.use_index", "bool"},
+  {AXIS__ENCODER__CONFIG__INDEX_OFFSET, "axis0.encoder.config.index_offset", "float"},
+  {AXIS__ENCODER__CONFIG__USE_INDEX_OFFSET, "axis0.encoder.config.use_index_offset", "bool"},
+  {AXIS__ENCODER__CONFIG__FIND_IDX_ON_LOCKIN_ONLY, "axis0.encoder.config.find_idx_on_lockin_only", "bool"},
+  {AXIS__ENCODER__CONFIG__ABS_SPI_CS_GPIO_PIN, "axis0.encoder.config.abs_spi_cs_gpio_pin", "uint16"},
+  {AXIS__ENCODER__CONFIG__CPR, "axis0.encoder.config.cpr", "int32"},
+  {AXIS__ENCODER__CONFIG__PHASE_OFFSET, "axis0.encoder.config.phase_offset", "int32"},
+  {AXIS__ENCODER__CONFIG__PHASE_OFFSET_FLOAT, "axis0.encoder.config.phase_offset_float", "float"},
+  {AXIS__ENCODER__CONFIG__DIRECTION, "axis0.encoder.config.direction", "int32"},
+  {AXIS__ENCODER__CONFIG__PRE_CALIBRATED, "axis0.encoder.config.pre_calibrated", "bool"},
+  {AXIS__ENCODER__CONFIG__ENABLE_PHASE_INTERPOLATION, "axis0.encoder.config.enable_phase_interpolation", "bool"},
+  {AXIS__ENCODER__CONFIG__BANDWIDTH, "axis0.encoder.config.bandwidth", "float"},
+  {AXIS__ENCODER__CONFIG__CALIB_RANGE, "axis0.encoder.config.calib_range", "float"},
+  {AXIS__ENCODER__CONFIG__CALIB_SCAN_DISTANCE, "axis0.encoder.config.calib_scan_distance", "float"},
+  {AXIS__ENCODER__CONFIG__CALIB_SCAN_OMEGA, "axis0.encoder.config.calib_scan_omega", "float"},
+  {AXIS__ENCODER__CONFIG__IGNORE_ILLEGAL_HALL_STATE, "axis0.encoder.config.ignore_illegal_hall_state", "bool"},
+  {AXIS__ENCODER__CONFIG__HALL_POLARITY, "axis0.encoder.config.hall_polarity", "uint8"},
+  {AXIS__ENCODER__CONFIG__HALL_POLARITY_CALIBRATED, "axis0.encoder.config.hall_polarity_calibrated", "bool"},
+  {AXIS__ENCODER__CONFIG__SINCOS_GPIO_PIN_SIN, "axis0.encoder.config.sincos_gpio_pin_sin", "uint16"},
+  {AXIS__ENCODER__CONFIG__SINCOS_GPIO_PIN_COS, "axis0.encoder.config.sincos_gpio_pin_cos", "uint16"},
+  {AXIS__ACIM_ESTIMATOR__ROTOR_FLUX, "axis0.acim_estimator.rotor_flux", "float"},
+  {AXIS__ACIM_ESTIMATOR__SLIP_VEL, "axis0.acim_estimator.slip_vel", "float"},
+  {AXIS__ACIM_ESTIMATOR__PHASE_OFFSET, "axis0.acim_estimator.phase_offset", "float"},
+  {AXIS__ACIM_ESTIMATOR__STATOR_PHASE_VEL, "axis0.acim_estimator.stator_phase_vel", "float"},
+  {AXIS__ACIM_ESTIMATOR__STATOR_PHASE, "axis0.acim_estimator.stator_phase", "float"},
+  {AXIS__ACIM_ESTIMATOR__CONFIG__SLIP_VELOCITY, "axis0.acim_estimator.config.slip_velocity", "float"},
+  {AXIS__SENSORLESS_ESTIMATOR__ERROR, "axis0.sensorless_estimator.error", "uint8"},
+  {AXIS__SENSORLESS_ESTIMATOR__PHASE, "axis0.sensorless_estimator.phase", "float"},
+  {AXIS__SENSORLESS_ESTIMATOR__PLL_POS, "axis0.sensorless_estimator.pll_pos", "float"},
+  {AXIS__SENSORLESS_ESTIMATOR__PHASE_VEL, "axis0.sensorless_estimator.phase_vel", "float"},
+  {AXIS__SENSORLESS_ESTIMATOR__VEL_ESTIMATE, "axis0.sensorless_estimator.vel_estimate", "float"},
+  {AXIS__SENSORLESS_ESTIMATOR__CONFIG__OBSERVER_GAIN, "axis0.sensorless_estimator.config.observer_gain", "float"},
+  {AXIS__SENSORLESS_ESTIMATOR__CONFIG__PLL_BANDWIDTH, "axis0.sensorless_estimator.config.pll_bandwidth", "float"},
+  {AXIS__SENSORLESS_ESTIMATOR__CONFIG__PM_FLUX_LINKAGE, "axis0.sensorless_estimator.config.pm_flux_linkage", "float"},
+  {AXIS__TRAP_TRAJ__CONFIG__VEL_LIMIT, "axis0.trap_traj.config.vel_limit", "float"},
+  {AXIS__TRAP_TRAJ__CONFIG__ACCEL_LIMIT, "axis0.trap_traj.config.accel_limit", "float"},
+  {AXIS__TRAP_TRAJ__CONFIG__DECEL_LIMIT, "axis0.trap_traj.config.decel_limit", "float"},
+  {AXIS__MIN_ENDSTOP__ENDSTOP_STATE, "axis0.min_endstop.endstop_state", "bool"},
+  {AXIS__MIN_ENDSTOP__CONFIG__GPIO_NUM, "axis0.min_endstop.config.gpio_num", "uint16"},
+  {AXIS__MIN_ENDSTOP__CONFIG__ENABLED, "axis0.min_endstop.config.enabled", "bool"},
+  {AXIS__MIN_ENDSTOP__CONFIG__OFFSET, "axis0.min_endstop.config.offset", "float"},
+  {AXIS__MIN_ENDSTOP__CONFIG__IS_ACTIVE_HIGH, "axis0.min_endstop.config.is_active_high", "bool"},
+  {AXIS__MIN_ENDSTOP__CONFIG__DEBOUNCE_MS, "axis0.min_endstop.config.debounce_ms", "uint32"},
+  {AXIS__MAX_ENDSTOP__ENDSTOP_STATE, "axis0.max_endstop.endstop_state", "bool"},
+  {AXIS__MAX_ENDSTOP__CONFIG__GPIO_NUM, "axis0.max_endstop.config.gpio_num", "uint16"},
+  {AXIS__MAX_ENDSTOP__CONFIG__ENABLED, "axis0.max_endstop.config.enabled", "bool"},
+  {AXIS__MAX_ENDSTOP__CONFIG__OFFSET, "axis0.max_endstop.config.offset", "float"},
+  {AXIS__MAX_ENDSTOP__CONFIG__IS_ACTIVE_HIGH, "axis0.max_endstop.config.is_active_high", "bool"},
+  {AXIS__MAX_ENDSTOP__CONFIG__DEBOUNCE_MS, "axis0.max_endstop.config.debounce_ms", "uint32"},
+  {AXIS__MECHANICAL_BRAKE__CONFIG__GPIO_NUM, "axis0.mechanical_brake.config.gpio_num", "uint16"},
+  {AXIS__MECHANICAL_BRAKE__CONFIG__IS_ACTIVE_LOW, "axis0.mechanical_brake.config.is_active_low", "bool"},
+  {AXIS__MECHANICAL_BRAKE__ENGAGE, "axis0.mechanical_brake.engage", "function"},
+  {AXIS__MECHANICAL_BRAKE__RELEASE, "axis0.mechanical_brake.release", "function"},
+  {AXIS__TASK_TIMES__THERMISTOR_UPDATE__START_TIME, "axis0.task_times.thermistor_update.start_time", "uint32"},
+  {AXIS__TASK_TIMES__THERMISTOR_UPDATE__END_TIME, "axis0.task_times.thermistor_update.end_time", "uint32"},
+  {AXIS__TASK_TIMES__THERMISTOR_UPDATE__LENGTH, "axis0.task_times.thermistor_update.length", "uint32"},
+  {AXIS__TASK_TIMES__THERMISTOR_UPDATE__MAX_LENGTH, "axis0.task_times.thermistor_update.max_length", "uint32"},
+  {AXIS__TASK_TIMES__ENCODER_UPDATE__START_TIME, "axis0.task_times.encoder_update.start_time", "uint32"},
+  {AXIS__TASK_TIMES__ENCODER_UPDATE__END_TIME, "axis0.task_times.encoder_update.end_time", "uint32"},
+  {AXIS__TASK_TIMES__ENCODER_UPDATE__LENGTH, "axis0.task_times.encoder_update.length", "uint32"},
+  {AXIS__TASK_TIMES__ENCODER_UPDATE__MAX_LENGTH, "axis0.task_times.encoder_update.max_length", "uint32"},
+  {AXIS__TASK_TIMES__SENSORLESS_ESTIMATOR_UPDATE__START_TIME, "axis0.task_times.sensorless_estimator_update.start_time", "uint32"},
+  {AXIS__TASK_TIMES__SENSORLESS_ESTIMATOR_UPDATE__END_TIME, "axis0.task_times.sensorless_estimator_update.end_time", "uint32"},
+  {AXIS__TASK_TIMES__SENSORLESS_ESTIMATOR_UPDATE__LENGTH, "axis0.task_times.sensorless_estimator_update.length", "uint32"},
+  {AXIS__TASK_TIMES__SENSORLESS_ESTIMATOR_UPDATE__MAX_LENGTH, "axis0.task_times.sensorless_estimator_update.max_length", "uint32"},
+  {AXIS__TASK_TIMES__ENDSTOP_UPDATE__START_TIME, "axis0.task_times.endstop_update.start_time", "uint32"},
+  {AXIS__TASK_TIMES__ENDSTOP_UPDATE__END_TIME, "axis0.task_times.endstop_update.end_time", "uint32"},
+  {AXIS__TASK_TIMES__ENDSTOP_UPDATE__LENGTH, "axis0.task_times.endstop_update.length", "uint32"},
+  {AXIS__TASK_TIMES__ENDSTOP_UPDATE__MAX_LENGTH, "axis0.task_times.endstop_update.max_length", "uint32"},
+  {AXIS__TASK_TIMES__CAN_HEARTBEAT__START_TIME, "axis0.task_times.can_heartbeat.start_time", "uint32"},
+  {AXIS__TASK_TIMES__CAN_HEARTBEAT__END_TIME, "axis0.task_times.can_heartbeat.end_time", "uint32"},
+  {AXIS__TASK_TIMES__CAN_HEARTBEAT__LENGTH, "axis0.task_times.can_heartbeat.length", "uint32"},
+  {AXIS__TASK_TIMES__CAN_HEARTBEAT__MAX_LENGTH, "axis0.task_times.can_heartbeat.max_length", "uint32"},
+  {AXIS__TASK_TIMES__CONTROLLER_UPDATE__START_TIME, "axis0.task_times.controller_update.start_time", "uint32"},
+  {AXIS__TASK_TIMES__CONTROLLER_UPDATE__END_TIME, "axis0.task_times.controller_update.end_time", "uint32"},
+  {AXIS__TASK_TIMES__CONTROLLER_UPDATE__LENGTH, "axis0.task_times.controller_update.length", "uint32"},
+  {AXIS__TASK_TIMES__CONTROLLER_UPDATE__MAX_LENGTH, "axis0.task_times.controller_update.max_length", "uint32"},
+  {AXIS__TASK_TIMES__OPEN_LOOP_CONTROLLER_UPDATE__START_TIME, "axis0.task_times.open_loop_controller_update.start_time", "uint32"},
+  {AXIS__TASK_TIMES__OPEN_LOOP_CONTROLLER_UPDATE__END_TIME, "axis0.task_times.open_loop_controller_update.end_time", "uint32"},
+  {AXIS__TASK_TIMES__OPEN_LOOP_CONTROLLER_UPDATE__LENGTH, "axis0.task_times.open_loop_controller_update.length", "uint32"},
+  {AXIS__TASK_TIMES__OPEN_LOOP_CONTROLLER_UPDATE__MAX_LENGTH, "axis0.task_times.open_loop_controller_update.max_length", "uint32"},
+  {AXIS__TASK_TIMES__ACIM_ESTIMATOR_UPDATE__START_TIME, "axis0.task_times.acim_estimator_update.start_time", "uint32"},
+  {AXIS__TASK_TIMES__ACIM_ESTIMATOR_UPDATE__END_TIME, "axis0.task_times.acim_estimator_update.end_time", "uint32"},
+  {AXIS__TASK_TIMES__ACIM_ESTIMATOR_UPDATE__LENGTH, "axis0.task_times.acim_estimator_update.length", "uint32"},
+  {AXIS__TASK_TIMES__ACIM_ESTIMATOR_UPDATE__MAX_LENGTH, "axis0.task_times.acim_estimator_update.max_length", "uint32"},
+  {AXIS__TASK_TIMES__MOTOR_UPDATE__START_TIME, "axis0.task_times.motor_update.start_time", "uint32"},
+  {AXIS__TASK_TIMES__MOTOR_UPDATE__END_TIME, "axis0.task_times.motor_update.end_time", "uint32"},
+  {AXIS__TASK_TIMES__MOTOR_UPDATE__LENGTH, "axis0.task_times.motor_update.length", "uint32"},
+  {AXIS__TASK_TIMES__MOTOR_UPDATE__MAX_LENGTH, "axis0.task_times.motor_update.max_length", "uint32"},
+  {AXIS__TASK_TIMES__CURRENT_CONTROLLER_UPDATE__START_TIME, "axis0.task_times.current_controller_update.start_time", "uint32"},
+  {AXIS__TASK_TIMES__CURRENT_CONTROLLER_UPDATE__END_TIME, "axis0.task_times.current_controller_update.end_time", "uint32"},
+  {AXIS__TASK_TIMES__CURRENT_CONTROLLER_UPDATE__LENGTH, "axis0.task_times.current_controller_update.length", "uint32"},
+  {AXIS__TASK_TIMES__CURRENT_CONTROLLER_UPDATE__MAX_LENGTH, "axis0.task_times.current_controller_update.max_length", "uint32"},
+  {AXIS__TASK_TIMES__DC_CALIB__START_TIME, "axis0.task_times.dc_calib.start_time", "uint32"},
+  {AXIS__TASK_TIMES__DC_CALIB__END_TIME, "axis0.task_times.dc_calib.end_time", "uint32"},
+  {AXIS__TASK_TIMES__DC_CALIB__LENGTH, "axis0.task_times.dc_calib.length", "uint32"},
+  {AXIS__TASK_TIMES__DC_CALIB__MAX_LENGTH, "axis0.task_times.dc_calib.max_length", "uint32"},
+  {AXIS__TASK_TIMES__CURRENT_SENSE__START_TIME, "axis0.task_times.current_sense.start_time", "uint32"},
+  {AXIS__TASK_TIMES__CURRENT_SENSE__END_TIME, "axis0.task_times.current_sense.end_time", "uint32"},
+  {AXIS__TASK_TIMES__CURRENT_SENSE__LENGTH, "axis0.task_times.current_sense.length", "uint32"},
+  {AXIS__TASK_TIMES__CURRENT_SENSE__MAX_LENGTH, "axis0.task_times.current_sense.max_length", "uint32"},
+  {AXIS__TASK_TIMES__PWM_UPDATE__START_TIME, "axis0.task_times.pwm_update.start_time", "uint32"},
+  {AXIS__TASK_TIMES__PWM_UPDATE__END_TIME, "axis0.task_times.pwm_update.end_time", "uint32"},
+  {AXIS__TASK_TIMES__PWM_UPDATE__LENGTH, "axis0.task_times.pwm_update.length", "uint32"},
+  {AXIS__TASK_TIMES__PWM_UPDATE__MAX_LENGTH, "axis0.task_times.pwm_update.max_length", "uint32"},
+  {AXIS__WATCHDOG_FEED, "axis0.watchdog_feed", "function"},
+};
+}  // namespace odrive
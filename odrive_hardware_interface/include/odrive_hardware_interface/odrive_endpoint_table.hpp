@@ -0,0 +1,50 @@
+// Copyright 2021 Factor Robotics
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "odrive_hardware_interface/odrive_endpoints.hpp"
+
+#define ODRIVE_AXIS_COUNT 2
+
+namespace odrive
+{
+// How one board numbers its endpoints when it runs firmware other than the build
+// odrive_endpoints.hpp was generated for. Resolved once from the board's JSON descriptor and
+// indexed by the ids from odrive_endpoints.hpp, so requests only pay for one array lookup.
+struct EndpointTable
+{
+  uint16_t crc = json_crc;
+  // Empty for the build odrive_endpoints.hpp was generated for
+  std::vector<short> ids;
+
+  // -1 if the firmware lacks the endpoint or has it with another type
+  short id(short endpoint_id) const
+  {
+    if (ids.empty() || endpoint_id == 0) {
+      return endpoint_id;
+    }
+    return (size_t)endpoint_id < ids.size() ? ids[endpoint_id] : -1;
+  }
+};
+
+// Fills the table from a JSON descriptor. Returns how many endpoints of odrive_endpoints.hpp the
+// firmware lacks, or -1 if the descriptor does not parse.
+int parseDescriptor(const std::string & descriptor, EndpointTable & table);
+}  // namespace odrive
@@ -14,17 +14,26 @@
 
 #pragma once
 
+#include <pthread.h>
+
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <memory>
+#include <thread>
 
 #include "hardware_interface/system_interface.hpp"
 #include "hardware_interface/types/hardware_interface_type_values.hpp"
+#include "odrive_hardware_interface/odrive_can.hpp"
+#include "odrive_hardware_interface/odrive_can_planner.hpp"
+#include "odrive_hardware_interface/odrive_config.hpp"
+#include "odrive_hardware_interface/odrive_serial.hpp"
+#include "odrive_hardware_interface/odrive_simulator.hpp"
 #include "odrive_hardware_interface/odrive_usb.hpp"
+#include "odrive_hardware_interface/triple_buffer.hpp"
 #include "odrive_hardware_interface/visibility_control.hpp"
 #include "rclcpp/rclcpp.hpp"
 
-#define AXIS_STATE_IDLE 1
-#define AXIS_STATE_CLOSED_LOOP_CONTROL 8
-
 #define CHECK_TS(status)                                                                   \
   do {                                                                                     \
     int ret = (status);                                                                    \
@@ -54,9 +63,23 @@ class ODriveHardwareInterface : public hardware_interface::SystemInterface
 public:
   RCLCPP_SHARED_PTR_DEFINITIONS(ODriveHardwareInterface)
 
+  ODRIVE_HARDWARE_INTERFACE_PUBLIC
+  ODriveHardwareInterface();
+
+  // Uses the given transport instead of the one selected by the transport parameter, e.g. to
+  // benchmark against an instrumented emulator. The transport has to outlive the interface.
+  ODRIVE_HARDWARE_INTERFACE_PUBLIC
+  explicit ODriveHardwareInterface(ODriveTransport * transport);
+
+  ODRIVE_HARDWARE_INTERFACE_PUBLIC
+  ~ODriveHardwareInterface();
+
   ODRIVE_HARDWARE_INTERFACE_PUBLIC
   CallbackReturn on_init(const hardware_interface::HardwareInfo & info) override;
 
+  ODRIVE_HARDWARE_INTERFACE_PUBLIC
+  CallbackReturn on_configure(const rclcpp_lifecycle::State &) override;
+
   ODRIVE_HARDWARE_INTERFACE_PUBLIC
   CallbackReturn on_activate(const rclcpp_lifecycle::State &) override;
 
@@ -85,14 +108,63 @@ public:
   return_type write(const rclcpp::Time &, const rclcpp::Duration &) override;
 
 private:
-  ODriveUSB * odrive;
+  // Either the injected transport or owned_transport_, which on_init() creates from the transport
+  // parameter and which is destroyed with the interface
+  ODriveTransport * odrive;
+  std::unique_ptr<ODriveTransport> owned_transport_;
+
+  ODriveTransport * createTransport();
+
+  // Set when the transport is CANSimple, whose bus load is planned up front and measured
+  ODriveCAN * can_;
+
+  bool planCanBus(ODriveCAN & can);
+
+  // Set when the transport is USB. Boards may be bound by usb_port instead of serial_number, and
+  // the port every board was found at is kept in device_registry_ for the next startup.
+  ODriveUSB * usb_;
+  std::string device_registry_;
+
+  bool bindUsbPorts();
+  void storeDeviceRegistry();
+
+  // Boards running other firmware than odrive_endpoints.hpp was generated for are addressed
+  // through an endpoint table from their JSON descriptor. Descriptors are cached in
+  // descriptor_cache_ by the version id their boards report.
+  bool load_endpoint_tables_;
+  std::string descriptor_cache_;
+
+  int loadEndpointTable(int64_t serial_number);
 
   std::vector<std::vector<int64_t>> serial_numbers_;
   std::vector<int> axes_;
   std::vector<float> torque_constants_;
-  std::vector<bool> enable_watchdogs_;
+
+  // Configuration written to an axis at startup and again whenever its ODrive comes back.
+  // Settings left NaN are not configured and keep what the board has.
+  struct AxisConfig
+  {
+    bool enable_watchdog;
+    ConfigValue values[AXIS_CONFIG_FIELDS];
+  };
+
+  std::vector<AxisConfig> axis_configs_;
+
+  // At startup only settings that differ from the board are written. What the boards hold is
+  // cached per serial number in config_cache_ together with their boot time, and the cache is
+  // trusted as long as a board has not rebooted since.
+  std::string config_cache_;
+
+  int pushConfiguration();
+  void loadConfigCache(
+    size_t board, int64_t boot_time, uint32_t uptime, std::vector<AxisConfig> & current);
+  void storeConfigCache(
+    size_t board, int64_t boot_time, uint32_t uptime, const std::vector<AxisConfig> & current);
 
   std::vector<double> hw_vbus_voltages_;
+  std::vector<double> hw_deadline_misses_;
+  std::vector<double> hw_stalenesses_;
+  std::vector<double> hw_bus_utilizations_;
 
   std::vector<double> hw_commands_positions_;
   std::vector<double> hw_commands_velocities_;
@@ -117,5 +189,183 @@ private:
   };
 
   std::vector<integration_level_t> control_level_;
+
+  // Joints and sensors grouped by the ODrive they live on
+  struct Board
+  {
+    int64_t serial_number;
+    std::vector<size_t> sensors;
+    std::vector<size_t> joints;
+  };
+
+  // Raw endpoint values, kept alive while a batch is in flight
+  struct AxisFeedback
+  {
+    float Iq_measured;
+    float vel_estimate;
+    float pos_estimate;
+    uint32_t axis_error;
+    uint64_t motor_error;
+    uint16_t encoder_error;
+    uint8_t controller_error;
+    float fet_temperature;
+    float motor_temperature;
+  };
+
+  struct AxisSetpoint
+  {
+    integration_level_t control_level;
+    endpoint_type_t<AXIS__CONTROLLER__CONFIG__CONTROL_MODE> control_mode;
+    endpoint_type_t<AXIS__REQUESTED_STATE> requested_state;
+    float input_pos;
+    float input_vel;
+    float input_torque;
+  };
+
+  // Everything read from the ODrives in one cycle
+  struct Feedback
+  {
+    std::vector<float> vbus_voltages;
+    std::vector<AxisFeedback> axes;
+    std::vector<uint32_t> deadline_misses;
+    // Cycles the most overdue read of every poll tier is late, for every board in turn
+    std::vector<uint32_t> stalenesses;
+    std::vector<uint32_t> uptimes;
+    std::vector<bool> available;
+    int status;
+  };
+
+  // Everything written to the ODrives in one cycle
+  struct Command
+  {
+    std::vector<AxisSetpoint> axes;
+    uint32_t mode_switches;
+  };
+
+  std::vector<Board> boards_;
+  std::vector<Transaction> transactions_;
+  Feedback feedback_;
+  Command command_;
+
+  // Each of read() and write() may use this fraction of the controller period before pending
+  // transactions are cancelled and counted as deadline misses of their board
+  double deadline_ratio_;
+
+  std::chrono::steady_clock::time_point deadline(std::chrono::nanoseconds period);
+  void countDeadlineMisses(std::vector<uint32_t> & deadline_misses);
+
+  // The cyclic transactions, compiled once against one Feedback and Command with device index,
+  // endpoint id, packet layout and destination already resolved
+  struct IoPlan
+  {
+    Feedback * feedback;
+    const Command * command;
+    std::vector<Transaction> reads;
+    // Every read is polled in the cycles where the cycle count modulo its divisor is its phase,
+    // or, if it has a rate, whenever its poll credit grown by rate times elapsed period reaches one
+    std::vector<uint32_t> read_divisors;
+    std::vector<uint32_t> read_phases;
+    std::vector<double> read_rates;
+    std::vector<uint8_t> read_tiers;
+    std::vector<size_t> read_boards;
+    // input_pos, input_vel, input_torque and the watchdog feed for every joint in turn
+    std::vector<Transaction> setpoints;
+    // Reads of input_pos, input_vel and input_torque for every joint in turn
+    std::vector<Transaction> verifications;
+    std::vector<float> readbacks;
+  };
+
+  IoPlan plan_;
+
+  // Setpoints and watchdog feeds may be sent without waiting for a response. Every
+  // setpoint_verify_period_ write cycles the inputs are read back in the same batch, and a joint
+  // whose write got lost is acknowledged again until it verifies.
+  bool acknowledge_setpoints_;
+  uint32_t setpoint_verify_period_;
+  uint32_t setpoint_cycles_;
+
+  void verifySetpoints(size_t verifications);
+
+  // An input that moved no more than its deadband since it was last sent is skipped, except once
+  // every setpoint_refresh_period_ write cycles, spread over the joints. The watchdog is still
+  // fed every cycle. Deadbands and sent values are kept for input_pos, input_vel and input_torque
+  // of every joint in turn, and a NaN sent value is written in the next cycle.
+  uint32_t setpoint_refresh_period_;
+  std::vector<float> setpoint_deadbands_;
+  std::vector<float> sent_setpoints_;
+  std::vector<size_t> written_setpoints_;
+
+  void resendSetpoints(size_t joint);
+
+  void compilePlan(Feedback & feedback, const Command & command);
+
+  // Slow state interfaces are polled every few cycles and hold their last value in between
+  uint64_t read_cycles_;
+  std::vector<double> poll_credits_;
+
+  // Reads that are due come in tiers. Critical reads are always made, while important and
+  // background reads share what the setpoints and critical reads leave of the cycle budget in
+  // round-robin order, and stay due until a later cycle has room for them. A background read that
+  // missed a whole poll period is served along with the important ones. The budget is at most
+  // cycle_transaction_budget_ transactions, and no more than the measured cost of a transaction
+  // lets fit into cycle_time_budget_ seconds. Zero leaves either one unlimited.
+  enum PollTier : uint8_t
+  {
+    CRITICAL,
+    IMPORTANT,
+    BACKGROUND,
+    POLL_TIERS
+  };
+
+  uint32_t cycle_transaction_budget_;
+  double cycle_time_budget_;
+  double transaction_cost_;
+  size_t written_transactions_;
+  std::vector<uint8_t> reads_due_;
+  std::vector<uint64_t> read_cycles_done_;
+  std::vector<size_t> polled_reads_;
+  size_t poll_cursors_[POLL_TIERS];
+
+  size_t readBudget(size_t critical) const;
+  uint32_t pollInterval(size_t read, double period) const;
+  void measureStaleness(Feedback & feedback, double period) const;
+
+  uint32_t pollDivisor(
+    const hardware_interface::ComponentInfo & component, const std::string & interface);
+  double pollRate(
+    const hardware_interface::ComponentInfo & component, const std::string & interface);
+  static std::vector<uint32_t> spreadPolls(const std::vector<uint32_t> & divisors);
+
+  int readDevices(std::chrono::steady_clock::time_point deadline, double period);
+  int writeDevices(std::chrono::steady_clock::time_point deadline);
+  int switchDevices(const Command & command);
+
+  // Boards that reconnect or reboot (their uptime drops) get their configuration and current
+  // control mode re-applied, while only their own joints report NaN in the meantime
+  std::vector<uint32_t> board_connections_;
+  std::vector<uint32_t> board_uptimes_;
+  std::vector<bool> board_available_;
+
+  int recoverDevices(Feedback & feedback, const Command & command);
+  int configureBoard(size_t board, const Command & command);
+  void appendConfiguration(size_t joint);
+  void appendModeSwitch(size_t joint, const AxisSetpoint & setpoint);
+  static bool transient(int status);
+
+  // Optional thread that owns the USB traffic while the hardware is active, so read() and
+  // write() only exchange snapshots with it
+  bool io_thread_enabled_;
+  std::chrono::nanoseconds io_thread_period_;
+  int io_thread_priority_;
+  int io_thread_cpu_;
+  std::thread io_thread_;
+  std::atomic<bool> io_thread_running_;
+  TripleBuffer<Feedback> feedback_buffer_;
+  TripleBuffer<Command> command_buffer_;
+  Command io_command_;
+
+  void startIoThread();
+  void stopIoThread();
+  void ioLoop();
 };
 }  // namespace odrive_hardware_interface
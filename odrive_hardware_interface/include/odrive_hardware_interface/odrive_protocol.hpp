@@ -0,0 +1,442 @@
+// Copyright 2021 Factor Robotics
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <libusb-1.0/libusb.h>
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+#include "odrive_hardware_interface/odrive_endpoints.hpp"
+
+#define ODRIVE_PROTOCOL_VERSION 1
+#define ODRIVE_MAX_PACKET_SIZE 16
+// Responses fill up to a full-speed USB bulk packet, which only descriptor chunks make use of
+#define ODRIVE_MAX_RESPONSE_PACKET_SIZE 64
+#define ODRIVE_DESCRIPTOR_CHUNK_SIZE (ODRIVE_MAX_RESPONSE_PACKET_SIZE - 2)
+#define ODRIVE_DESCRIPTOR_VERSION_OFFSET 0xffffffff
+#define ODRIVE_MAX_DESCRIPTOR_SIZE (1 << 20)
+
+// Stream framing for links without packet boundaries like UART: sync byte, packet length and a
+// CRC8 over both, then the packet followed by its CRC16 in big endian
+#define ODRIVE_STREAM_SYNC 0xAA
+#define ODRIVE_STREAM_CRC8_INIT 0x42
+#define ODRIVE_STREAM_CRC16_INIT 0x1337
+#define ODRIVE_STREAM_HEADER_SIZE 3
+#define ODRIVE_MAX_STREAM_FRAME_SIZE (ODRIVE_STREAM_HEADER_SIZE + ODRIVE_MAX_RESPONSE_PACKET_SIZE + 2)
+
+#define AXIS_STATE_IDLE 1
+#define AXIS_STATE_CLOSED_LOOP_CONTROL 8
+#define INPUT_MODE_PASSTHROUGH 1
+
+namespace odrive
+{
+// Endpoints from AXIS__ERROR up to AXIS__WATCHDOG_FEED belong to axis0 and repeat for every
+// further axis at per_axis_offset
+static constexpr const uint16_t first_axis_endpoint = AXIS__ERROR;
+
+template <typename T>
+struct payload_size
+{
+  static constexpr short value = sizeof(T);
+};
+
+template <>
+struct payload_size<void>
+{
+  static constexpr short value = 0;
+};
+
+// A request packet with everything but the sequence number, the endpoint id and the request
+// payload already in place
+struct PacketTemplate
+{
+  unsigned char bytes[ODRIVE_MAX_PACKET_SIZE];
+  short length;
+
+  constexpr PacketTemplate(uint16_t endpoint_id, short response_size, short request_size)
+  : bytes{}, length(8 + request_size)
+  {
+    uint16_t crc = (endpoint_id & 0x7fff) == 0 ? ODRIVE_PROTOCOL_VERSION : json_crc;
+    bytes[2] = (endpoint_id >> 0) & 0xFF;
+    bytes[3] = (endpoint_id >> 8) & 0xFF;
+    bytes[4] = (response_size >> 0) & 0xFF;
+    bytes[5] = (response_size >> 8) & 0xFF;
+    bytes[6 + request_size] = (crc >> 0) & 0xFF;
+    bytes[7 + request_size] = (crc >> 8) & 0xFF;
+  }
+};
+
+// Everything about an endpoint that endpoint_type<I> lets us work out at compile time
+template <int ENDPOINT>
+struct Endpoint
+{
+  typedef endpoint_type_t<ENDPOINT> type;
+
+  static constexpr short size = payload_size<type>::value;
+  static constexpr bool per_axis =
+    ENDPOINT >= first_axis_endpoint && ENDPOINT < first_axis_endpoint + per_axis_offset;
+
+  static_assert(size + 8 <= ODRIVE_MAX_PACKET_SIZE, "Endpoint payload does not fit a packet");
+
+  static constexpr PacketTemplate read_packet{ENDPOINT | 0x8000, size, 0};
+  static constexpr PacketTemplate write_packet{ENDPOINT | 0x8000, 0, size};
+
+  static constexpr short id(uint8_t axis) { return ENDPOINT + per_axis_offset * axis; }
+};
+
+template <int ENDPOINT>
+constexpr short Endpoint<ENDPOINT>::size;
+template <int ENDPOINT>
+constexpr bool Endpoint<ENDPOINT>::per_axis;
+template <int ENDPOINT>
+constexpr PacketTemplate Endpoint<ENDPOINT>::read_packet;
+template <int ENDPOINT>
+constexpr PacketTemplate Endpoint<ENDPOINT>::write_packet;
+
+// A single endpoint operation as it travels through the transfer pipeline
+struct Transaction
+{
+  int64_t serial_number;
+  short endpoint_id;
+  const void * request;
+  short request_size;
+  void * response;
+  short response_size;
+  bool ack;
+  const PacketTemplate * packet;
+  // Index from ODriveUSB::resolve(), or -1 to look the board up by serial number
+  int device;
+  int status;
+
+  template <typename T>
+  static Transaction read(int64_t serial_number, short endpoint_id, T & value)
+  {
+    return {
+      serial_number, endpoint_id, NULL, 0, &value, sizeof(value), true, NULL, -1, LIBUSB_SUCCESS};
+  }
+
+  template <typename T>
+  static Transaction write(int64_t serial_number, short endpoint_id, const T & value)
+  {
+    return {
+      serial_number, endpoint_id, &value, sizeof(value), NULL, 0, true, NULL, -1, LIBUSB_SUCCESS};
+  }
+
+  static Transaction call(int64_t serial_number, short endpoint_id)
+  {
+    return {serial_number, endpoint_id, NULL, 0, NULL, 0, true, NULL, -1, LIBUSB_SUCCESS};
+  }
+
+  // Reads the part of the JSON descriptor behind endpoint 0 that starts at offset. The board
+  // answers with fewer bytes at the end of the descriptor, and transports then lower
+  // response_size to what was received.
+  static Transaction readChunk(
+    int64_t serial_number, const uint32_t & offset, unsigned char * chunk, short size)
+  {
+    return {serial_number, 0, &offset, sizeof(offset), chunk, size, true, NULL, -1,
+            LIBUSB_SUCCESS};
+  }
+
+  // Typed operations take the payload type and packet layout from odrive_endpoints.hpp, so a
+  // value of the wrong size does not compile. Per-axis endpoints need the axis number.
+  template <int ENDPOINT>
+  static Transaction read(int64_t serial_number, uint8_t axis, endpoint_type_t<ENDPOINT> & value)
+  {
+    static_assert(Endpoint<ENDPOINT>::per_axis, "Endpoint does not belong to an axis");
+    return typedRead<ENDPOINT>(serial_number, Endpoint<ENDPOINT>::id(axis), value);
+  }
+
+  template <int ENDPOINT>
+  static Transaction read(int64_t serial_number, endpoint_type_t<ENDPOINT> & value)
+  {
+    static_assert(!Endpoint<ENDPOINT>::per_axis, "Endpoint needs an axis");
+    return typedRead<ENDPOINT>(serial_number, ENDPOINT, value);
+  }
+
+  template <int ENDPOINT, typename T>
+  static Transaction write(int64_t serial_number, uint8_t axis, const T & value)
+  {
+    static_assert(Endpoint<ENDPOINT>::per_axis, "Endpoint does not belong to an axis");
+    return typedWrite<ENDPOINT>(serial_number, Endpoint<ENDPOINT>::id(axis), value);
+  }
+
+  template <int ENDPOINT, typename T>
+  static Transaction write(int64_t serial_number, const T & value)
+  {
+    static_assert(!Endpoint<ENDPOINT>::per_axis, "Endpoint needs an axis");
+    return typedWrite<ENDPOINT>(serial_number, ENDPOINT, value);
+  }
+
+  // The request payload is only referenced, so it has to outlive the transfer
+  template <int ENDPOINT, typename T>
+  static Transaction write(int64_t serial_number, uint8_t axis, const T && value) = delete;
+  template <int ENDPOINT, typename T>
+  static Transaction write(int64_t serial_number, const T && value) = delete;
+
+  template <int ENDPOINT>
+  static Transaction call(int64_t serial_number, uint8_t axis)
+  {
+    static_assert(Endpoint<ENDPOINT>::per_axis, "Endpoint does not belong to an axis");
+    return typedCall<ENDPOINT>(serial_number, Endpoint<ENDPOINT>::id(axis));
+  }
+
+  template <int ENDPOINT>
+  static Transaction call(int64_t serial_number)
+  {
+    static_assert(!Endpoint<ENDPOINT>::per_axis, "Endpoint needs an axis");
+    return typedCall<ENDPOINT>(serial_number, ENDPOINT);
+  }
+
+private:
+  template <int ENDPOINT>
+  static Transaction typedRead(
+    int64_t serial_number, short endpoint_id, endpoint_type_t<ENDPOINT> & value)
+  {
+    return {serial_number, endpoint_id, NULL, 0, &value, Endpoint<ENDPOINT>::size, true,
+            &Endpoint<ENDPOINT>::read_packet, -1, LIBUSB_SUCCESS};
+  }
+
+  template <int ENDPOINT, typename T>
+  static Transaction typedWrite(int64_t serial_number, short endpoint_id, const T & value)
+  {
+    static_assert(
+      std::is_same<T, endpoint_type_t<ENDPOINT>>::value, "Value does not match endpoint type");
+    return {serial_number, endpoint_id, &value, Endpoint<ENDPOINT>::size, NULL, 0, true,
+            &Endpoint<ENDPOINT>::write_packet, -1, LIBUSB_SUCCESS};
+  }
+
+  template <int ENDPOINT>
+  static Transaction typedCall(int64_t serial_number, short endpoint_id)
+  {
+    static_assert(std::is_void<endpoint_type_t<ENDPOINT>>::value, "Endpoint is not a function");
+    return {serial_number, endpoint_id, NULL, 0, NULL, 0, true, &Endpoint<ENDPOINT>::write_packet,
+            -1, LIBUSB_SUCCESS};
+  }
+};
+
+// Fibre request packets are sequence number, endpoint id with the MSB requesting a response,
+// response size, payload and CRC. Responses are the sequence number followed by the payload.
+inline int encodePacket(
+  unsigned char * packet, short sequence_number, short endpoint_id, short response_size,
+  const void * request_payload, short request_size, uint16_t crc = json_crc)
+{
+  if (request_size + 8 > ODRIVE_MAX_PACKET_SIZE) {
+    return LIBUSB_ERROR_OVERFLOW;
+  }
+
+  packet[0] = (sequence_number >> 0) & 0xFF;
+  packet[1] = (sequence_number >> 8) & 0xFF;
+  packet[2] = (endpoint_id >> 0) & 0xFF;
+  packet[3] = (endpoint_id >> 8) & 0xFF;
+  packet[4] = (response_size >> 0) & 0xFF;
+  packet[5] = (response_size >> 8) & 0xFF;
+
+  if (request_size) {
+    std::memcpy(&packet[6], request_payload, request_size);
+  }
+
+  if ((endpoint_id & 0x7fff) == 0) {
+    crc = ODRIVE_PROTOCOL_VERSION;
+  }
+  packet[6 + request_size] = (crc >> 0) & 0xFF;
+  packet[7 + request_size] = (crc >> 8) & 0xFF;
+
+  return 8 + request_size;
+}
+
+// Only the parts that vary at runtime are filled in, the rest comes from the compile-time
+// template. Boards with other firmware than odrive_endpoints.hpp was generated for also get their
+// own CRC.
+inline int encodePacket(
+  unsigned char * packet, short sequence_number, short endpoint_id,
+  const PacketTemplate & packet_template, const void * request_payload, uint16_t crc = json_crc)
+{
+  std::memcpy(packet, packet_template.bytes, packet_template.length);
+
+  packet[0] = (sequence_number >> 0) & 0xFF;
+  packet[1] = (sequence_number >> 8) & 0xFF;
+  packet[2] = (endpoint_id >> 0) & 0xFF;
+  packet[3] = (endpoint_id >> 8) & 0xFF;
+
+  if (packet_template.length > 8) {
+    std::memcpy(&packet[6], request_payload, packet_template.length - 8);
+  }
+  if (crc != json_crc && (endpoint_id & 0x7fff) != 0) {
+    packet[packet_template.length - 2] = (crc >> 0) & 0xFF;
+    packet[packet_template.length - 1] = (crc >> 8) & 0xFF;
+  }
+
+  return packet_template.length;
+}
+
+inline int decodePacket(
+  const unsigned char * response_packet, int length, void * response_payload, short response_size)
+{
+  int payload_size = std::max(0, std::min<int>(length - 2, response_size));
+  if (payload_size) {
+    std::memcpy(response_payload, &response_packet[2], payload_size);
+  }
+
+  return payload_size;
+}
+
+// CRC16 over the JSON descriptor as Fibre computes it, seeded with ODRIVE_PROTOCOL_VERSION. The
+// result is the json_crc every request to a non-zero endpoint has to carry.
+inline uint16_t descriptorCrc(
+  const void * data, size_t size, uint16_t crc = ODRIVE_PROTOCOL_VERSION)
+{
+  const unsigned char * bytes = static_cast<const unsigned char *>(data);
+  for (size_t i = 0; i < size; i++) {
+    crc ^= bytes[i] << 8;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x3d65 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+inline uint8_t streamCrc8(const unsigned char * data, size_t size)
+{
+  uint8_t crc = ODRIVE_STREAM_CRC8_INIT;
+  for (size_t i = 0; i < size; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x37 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+// Wraps a packet for a stream, returns the length of the frame
+inline int encodeStreamFrame(unsigned char * frame, const unsigned char * packet, int length)
+{
+  if (length > ODRIVE_MAX_RESPONSE_PACKET_SIZE) {
+    return LIBUSB_ERROR_OVERFLOW;
+  }
+
+  frame[0] = ODRIVE_STREAM_SYNC;
+  frame[1] = length;
+  frame[2] = streamCrc8(frame, 2);
+  std::memcpy(&frame[ODRIVE_STREAM_HEADER_SIZE], packet, length);
+  uint16_t crc = descriptorCrc(packet, length, ODRIVE_STREAM_CRC16_INIT);
+  frame[ODRIVE_STREAM_HEADER_SIZE + length] = (crc >> 8) & 0xFF;
+  frame[ODRIVE_STREAM_HEADER_SIZE + length + 1] = (crc >> 0) & 0xFF;
+
+  return ODRIVE_STREAM_HEADER_SIZE + length + 2;
+}
+
+// Cuts packets out of a byte stream. Bytes that do not start a valid frame, and frames with a bad
+// CRC, are skipped one byte at a time until the next sync byte that does.
+class StreamDecoder
+{
+public:
+  StreamDecoder() : length_(0) {}
+
+  void reset() { length_ = 0; }
+
+  // Calls packet(data, length) for every complete packet in the bytes
+  template <typename Callback>
+  void decode(const unsigned char * data, size_t size, Callback packet)
+  {
+    for (size_t i = 0; i < size; i++) {
+      buffer_[length_++] = data[i];
+      while (length_) {
+        if (
+          buffer_[0] != ODRIVE_STREAM_SYNC ||
+          (length_ >= ODRIVE_STREAM_HEADER_SIZE &&
+           (streamCrc8(buffer_, ODRIVE_STREAM_HEADER_SIZE) != 0 ||
+            buffer_[1] > ODRIVE_MAX_RESPONSE_PACKET_SIZE))) {
+          skip();
+          continue;
+        }
+        size_t frame_size = ODRIVE_STREAM_HEADER_SIZE + buffer_[1] + 2;
+        if (length_ < ODRIVE_STREAM_HEADER_SIZE || length_ < frame_size) {
+          break;
+        }
+        // The CRC16 over a packet followed by its own CRC is zero
+        if (
+          descriptorCrc(
+            &buffer_[ODRIVE_STREAM_HEADER_SIZE], buffer_[1] + 2, ODRIVE_STREAM_CRC16_INIT) != 0) {
+          skip();
+          continue;
+        }
+        packet(&buffer_[ODRIVE_STREAM_HEADER_SIZE], buffer_[1]);
+        length_ = 0;
+      }
+    }
+  }
+
+private:
+  unsigned char buffer_[ODRIVE_MAX_STREAM_FRAME_SIZE];
+  size_t length_;
+
+  void skip()
+  {
+    length_--;
+    std::memmove(buffer_, buffer_ + 1, length_);
+  }
+};
+
+// The board side of the codec, used by the emulator
+struct Request
+{
+  short sequence_number;
+  short endpoint_id;
+  short response_size;
+  const unsigned char * payload;
+  short payload_size;
+};
+
+inline int decodeRequest(
+  const unsigned char * request_packet, int length, Request & request, uint16_t crc = json_crc)
+{
+  if (length < 8 || length > ODRIVE_MAX_PACKET_SIZE) {
+    return LIBUSB_ERROR_IO;
+  }
+
+  request.sequence_number = request_packet[0] | (request_packet[1] << 8);
+  request.endpoint_id = request_packet[2] | (request_packet[3] << 8);
+  request.response_size = request_packet[4] | (request_packet[5] << 8);
+  request.payload = &request_packet[6];
+  request.payload_size = length - 8;
+
+  uint16_t request_crc = request_packet[length - 2] | (request_packet[length - 1] << 8);
+  if (request_crc != (((request.endpoint_id & 0x7fff) == 0) ? ODRIVE_PROTOCOL_VERSION : crc)) {
+    return LIBUSB_ERROR_IO;
+  }
+
+  return LIBUSB_SUCCESS;
+}
+
+inline int encodeResponse(
+  unsigned char * response_packet, short sequence_number, const void * response_payload,
+  short response_size)
+{
+  if (response_size + 2 > ODRIVE_MAX_RESPONSE_PACKET_SIZE) {
+    return LIBUSB_ERROR_OVERFLOW;
+  }
+
+  // Like the firmware, echo the sequence number with the MSB set
+  response_packet[0] = (sequence_number >> 0) & 0xFF;
+  response_packet[1] = ((sequence_number >> 8) & 0xFF) | 0x80;
+  if (response_size) {
+    std::memcpy(&response_packet[2], response_payload, response_size);
+  }
+
+  return 2 + response_size;
+}
+}  // namespace odrive
@@ -0,0 +1,133 @@
+// Copyright 2021 Factor Robotics
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <poll.h>
+#include <termios.h>
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "odrive_hardware_interface/odrive_transport.hpp"
+
+#define ODRIVE_SERIAL_DEFAULT_BAUD_RATE 115200
+#define ODRIVE_SERIAL_REOPEN_INTERVAL 1000
+
+namespace odrive
+{
+// Opens a serial port in raw 8N1 mode without flow control for nonblocking I/O. Returns the file
+// descriptor or a libusb error code.
+int openSerialPort(const std::string & path, unsigned int baud_rate);
+
+// ODrives on UART ports speaking the native protocol in stream framing. Every board has a port
+// of its own, each with up to pipeline_depth requests in flight, and all ports are serviced from
+// one poll loop. A port that fails is closed and opened again every
+// ODRIVE_SERIAL_REOPEN_INTERVAL ms, and counts as a new connection once the same board answers.
+class ODriveSerial : public ODriveTransport
+{
+public:
+  explicit ODriveSerial(unsigned int baud_rate = ODRIVE_SERIAL_DEFAULT_BAUD_RATE);
+  ~ODriveSerial() override;
+
+  // init() reads the serial number of the board behind every port, so ports may be given in any
+  // order
+  void addPort(const std::string & path);
+
+  int init(
+    const std::vector<std::vector<int64_t>> & serial_numbers,
+    size_t pipeline_depth = ODRIVE_DEFAULT_PIPELINE_DEPTH,
+    unsigned int transaction_timeout = ODRIVE_DEFAULT_TRANSACTION_TIMEOUT) override;
+
+  int transfer(
+    std::vector<Transaction> & transactions,
+    std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::time_point::max()) override;
+
+  void setEndpointTable(int64_t serial_number, const EndpointTable & table) override;
+  int resolve(int64_t serial_number) override;
+  bool connected(int64_t serial_number) override;
+  uint32_t connections(int64_t serial_number) override;
+
+protected:
+  int transfer(Transaction & transaction) override;
+
+private:
+  // A request whose frame is still being written or whose response is awaited
+  struct Slot
+  {
+    Transaction * transaction;
+    short sequence_number;
+    // Where its frame lies in the output buffer
+    size_t start;
+    size_t end;
+    std::chrono::steady_clock::time_point timeout;
+    bool sending;
+    bool waiting;
+  };
+
+  struct Port
+  {
+    std::string path;
+    int fd;
+    int64_t serial_number;
+    bool connected;
+    uint32_t connections;
+    std::chrono::steady_clock::time_point reopen_time;
+    // A reopened port takes requests again once it answered this read with its serial number.
+    // The read stays in flight across batches without holding them up.
+    bool probing;
+    uint64_t probed_serial_number;
+    Transaction probe;
+    EndpointTable endpoints;
+    short sequence_number;
+    StreamDecoder decoder;
+    std::vector<unsigned char> output;
+    size_t written;
+    std::vector<Slot> slots;
+    std::vector<Transaction *> queue;
+    size_t next;
+    size_t outstanding;
+  };
+
+  unsigned int baud_rate_;
+  size_t pipeline_depth_;
+  std::chrono::milliseconds transaction_timeout_;
+
+  std::vector<Port> ports_;
+  std::map<int64_t, size_t> port_map_;
+  std::vector<Port *> active_ports_;
+  std::vector<pollfd> descriptors_;
+  std::vector<Port *> polled_ports_;
+
+  Port * port(int64_t serial_number);
+  int openPort(Port & port);
+  void closePort(Port & port, int status);
+  void reopenPorts(std::chrono::steady_clock::time_point now);
+  void checkProbe(Port & port);
+  int identify(Port & port, uint64_t & serial_number);
+
+  int transfer(Port & port, Transaction & transaction);
+  void enqueue(Port & port, Transaction & transaction);
+  void run(std::chrono::steady_clock::time_point deadline);
+  void expire(Port & port, std::chrono::steady_clock::time_point now, bool cancel);
+  void dispatch(Port & port, std::chrono::steady_clock::time_point now);
+  void flush(Port & port);
+  void receive(Port & port);
+  void respond(Port & port, const unsigned char * packet, int length);
+  static void finish(Port & port, Slot & slot, int status);
+};
+}  // namespace odrive
@@ -0,0 +1,63 @@
+// Copyright 2021 Factor Robotics
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "odrive_hardware_interface/odrive_transport.hpp"
+
+namespace odrive
+{
+// UART front end for emulated ODrives, to test ODriveSerial without hardware. Every board gets a
+// pseudo terminal whose requests become transactions on the boards, answered in stream framing
+// like the firmware does.
+class ODriveSerialEmulator
+{
+public:
+  // The boards are only accessed from the emulator thread while it runs
+  explicit ODriveSerialEmulator(ODriveTransport & boards);
+  ~ODriveSerialEmulator();
+
+  // Fills in the terminal device to open for every board
+  int start(const std::vector<int64_t> & serial_numbers, std::vector<std::string> & paths);
+  void stop();
+
+private:
+  struct Port
+  {
+    int64_t serial_number;
+    int master;
+    // Held open so the terminal does not hang up while no client has it open
+    int slave;
+    uint16_t crc;
+    StreamDecoder decoder;
+    std::vector<unsigned char> output;
+  };
+
+  ODriveTransport & boards_;
+  std::vector<Port> ports_;
+  std::vector<Transaction> transactions_;
+
+  std::thread thread_;
+  std::atomic<bool> running_;
+
+  void run();
+  void handle(Port & port, const unsigned char * packet, int length);
+  void flush(Port & port);
+};
+}  // namespace odrive
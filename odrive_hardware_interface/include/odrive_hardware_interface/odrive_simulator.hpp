@@ -0,0 +1,82 @@
+// Copyright 2021 Factor Robotics
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <chrono>
+#include <vector>
+
+#include "odrive_hardware_interface/odrive_emulator.hpp"
+
+#define ODRIVE_SIMULATOR_RATE 8000
+
+#define CONTROL_MODE_TORQUE_CONTROL 1
+#define CONTROL_MODE_VELOCITY_CONTROL 2
+#define CONTROL_MODE_POSITION_CONTROL 3
+
+#define AXIS_ERROR_WATCHDOG_TIMER_EXPIRED 0x800
+
+namespace odrive
+{
+// Load seen by every simulated motor, in SI units at the motor shaft
+struct AxisDynamics
+{
+  double inertia;
+  double viscous_friction;
+  double coulomb_friction;
+};
+
+// Emulator whose axes are driven by a motor, encoder and controller model stepped at the
+// firmware's control loop rate. Like the firmware, the controller runs the position, velocity
+// and torque cascade in closed loop control with passthrough input mode, limits velocity and
+// torque, and drops to idle when its watchdog expires.
+class ODriveSimulator : public ODriveEmulator
+{
+public:
+  ODriveSimulator(
+    const AxisDynamics & dynamics, std::chrono::nanoseconds latency = std::chrono::nanoseconds(0),
+    std::chrono::nanoseconds jitter = std::chrono::nanoseconds(0));
+
+protected:
+  void reset(Board & board) override;
+  void update(Board & board, std::chrono::steady_clock::time_point now) override;
+  void written(Board & board, short endpoint_id) override;
+
+private:
+  // Simulation state that the firmware keeps outside of its endpoints, positions in turns
+  struct AxisState
+  {
+    double position;
+    double velocity;
+    double pll_position;
+    double pll_velocity;
+    double vel_integrator_torque;
+    std::chrono::steady_clock::time_point watchdog_fed;
+  };
+
+  struct BoardState
+  {
+    std::chrono::steady_clock::time_point stepped;
+    AxisState axes[ODRIVE_EMULATOR_AXIS_COUNT];
+  };
+
+  AxisDynamics dynamics_;
+  std::vector<BoardState> states_;
+
+  BoardState & state(const Board & board);
+  void step(
+    Board & board, uint8_t axis, AxisState & state, std::chrono::steady_clock::time_point now);
+  void control(Board & board, uint8_t axis, AxisState & state, double dt);
+};
+}  // namespace odrive
@@ -0,0 +1,202 @@
+// Copyright 2021 Factor Robotics
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "odrive_hardware_interface/odrive_endpoint_table.hpp"
+#include "odrive_hardware_interface/odrive_protocol.hpp"
+
+#define ODRIVE_DEFAULT_PIPELINE_DEPTH 8
+#define ODRIVE_DEFAULT_TRANSACTION_TIMEOUT 100
+
+namespace odrive
+{
+// Status of a failed system call on the devices of socket and file based backends
+inline int errnoStatus(int error)
+{
+  switch (error) {
+    case EACCES:
+    case EPERM:
+      return LIBUSB_ERROR_ACCESS;
+    case ENOENT:
+      return LIBUSB_ERROR_NOT_FOUND;
+    case ENODEV:
+    case ENXIO:
+    case ENETDOWN:
+      return LIBUSB_ERROR_NO_DEVICE;
+    case EAGAIN:
+    case ETIMEDOUT:
+      return LIBUSB_ERROR_TIMEOUT;
+    case ENOBUFS:
+    case ENOMEM:
+      return LIBUSB_ERROR_NO_MEM;
+    case EINTR:
+      return LIBUSB_ERROR_INTERRUPTED;
+    default:
+      return LIBUSB_ERROR_IO;
+  }
+}
+
+// Link to a set of ODrives. Every backend reports libusb error codes.
+class ODriveTransport
+{
+public:
+  virtual ~ODriveTransport() {}
+
+  virtual int init(
+    const std::vector<std::vector<int64_t>> & serial_numbers,
+    size_t pipeline_depth = ODRIVE_DEFAULT_PIPELINE_DEPTH,
+    unsigned int transaction_timeout = ODRIVE_DEFAULT_TRANSACTION_TIMEOUT) = 0;
+
+  // Blocking single operations, see Transaction for the typed variants
+  template <int ENDPOINT>
+  int read(int64_t serial_number, uint8_t axis, endpoint_type_t<ENDPOINT> & value)
+  {
+    Transaction transaction = Transaction::read<ENDPOINT>(serial_number, axis, value);
+    return transfer(transaction);
+  }
+  template <int ENDPOINT>
+  int read(int64_t serial_number, endpoint_type_t<ENDPOINT> & value)
+  {
+    Transaction transaction = Transaction::read<ENDPOINT>(serial_number, value);
+    return transfer(transaction);
+  }
+  template <int ENDPOINT, typename T>
+  int write(int64_t serial_number, uint8_t axis, const T & value)
+  {
+    Transaction transaction = Transaction::write<ENDPOINT>(serial_number, axis, value);
+    return transfer(transaction);
+  }
+  template <int ENDPOINT, typename T>
+  int write(int64_t serial_number, const T & value)
+  {
+    Transaction transaction = Transaction::write<ENDPOINT>(serial_number, value);
+    return transfer(transaction);
+  }
+  template <int ENDPOINT>
+  int call(int64_t serial_number, uint8_t axis)
+  {
+    Transaction transaction = Transaction::call<ENDPOINT>(serial_number, axis);
+    return transfer(transaction);
+  }
+  template <int ENDPOINT>
+  int call(int64_t serial_number)
+  {
+    Transaction transaction = Transaction::call<ENDPOINT>(serial_number);
+    return transfer(transaction);
+  }
+
+  // Downloads the JSON descriptor of a board. Endpoint 0 does not depend on json_crc, so this
+  // also works with firmware whose endpoints do not match odrive_endpoints.hpp.
+  int readDescriptor(int64_t serial_number, std::string & descriptor)
+  {
+    return readDescriptor(
+      [this](Transaction & transaction) { return transfer(transaction); }, serial_number,
+      descriptor);
+  }
+
+  // Reads the version id of a board's JSON descriptor, which endpoint 0 answers with at offset
+  // 0xffffffff. Its upper half is the descriptor CRC. Firmware that does not report it leaves
+  // the version at 0.
+  int readDescriptorVersion(int64_t serial_number, uint32_t & version)
+  {
+    const uint32_t offset = ODRIVE_DESCRIPTOR_VERSION_OFFSET;
+    unsigned char response[sizeof(version)];
+    Transaction transaction =
+      Transaction::readChunk(serial_number, offset, response, sizeof(response));
+    int ret = transfer(transaction);
+    version = 0;
+    if (ret == LIBUSB_SUCCESS && transaction.response_size == sizeof(version)) {
+      std::memcpy(&version, response, sizeof(version));
+    }
+    return ret;
+  }
+
+  // Whether any endpoint can be reached. Transports that only carry a fixed set of values, like
+  // CANSimple, have no descriptor and leave the axis configuration to what the boards stored.
+  virtual bool fullAccess() const { return true; }
+
+  // Makes requests to a board follow the table from its descriptor, see EndpointTable
+  virtual void setEndpointTable(int64_t serial_number, const EndpointTable & table) = 0;
+
+  // All boards are serviced concurrently and every entry gets its own status. Entries still
+  // pending at the deadline fail with LIBUSB_ERROR_TIMEOUT and entries for a disconnected board
+  // with LIBUSB_ERROR_NO_DEVICE; these are only returned if nothing else failed.
+  virtual int transfer(
+    std::vector<Transaction> & transactions,
+    std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::time_point::max()) = 0;
+
+  // Stable index of a board for Transaction::device, so batches built once can skip the serial
+  // number lookup. Returns LIBUSB_ERROR_NO_DEVICE for unknown boards.
+  virtual int resolve(int64_t serial_number) = 0;
+
+  // A board that is unplugged or reboots is re-attached automatically once it shows up again,
+  // which bumps its connection count
+  virtual bool connected(int64_t serial_number) = 0;
+  virtual uint32_t connections(int64_t serial_number) = 0;
+
+protected:
+  virtual int transfer(Transaction & transaction) = 0;
+
+  // The descriptor comes in chunks until the board answers with an empty one
+  template <typename Transfer>
+  static int readDescriptor(Transfer transfer, int64_t serial_number, std::string & descriptor)
+  {
+    unsigned char chunk[ODRIVE_DESCRIPTOR_CHUNK_SIZE];
+    descriptor.clear();
+    while (descriptor.size() < ODRIVE_MAX_DESCRIPTOR_SIZE) {
+      uint32_t offset = descriptor.size();
+      Transaction transaction = Transaction::readChunk(serial_number, offset, chunk, sizeof(chunk));
+      int ret = transfer(transaction);
+      if (ret != LIBUSB_SUCCESS) {
+        return ret;
+      }
+      if (!transaction.response_size) {
+        return LIBUSB_SUCCESS;
+      }
+      descriptor.append(reinterpret_cast<const char *>(chunk), transaction.response_size);
+    }
+
+    return LIBUSB_ERROR_OVERFLOW;
+  }
+
+  static int batchStatus(const std::vector<Transaction> & transactions)
+  {
+    int ret = LIBUSB_SUCCESS;
+    for (const Transaction & transaction : transactions) {
+      switch (transaction.status) {
+        case LIBUSB_SUCCESS:
+          break;
+        case LIBUSB_ERROR_TIMEOUT:
+        case LIBUSB_ERROR_NO_DEVICE:
+          if (ret == LIBUSB_SUCCESS) {
+            ret = transaction.status;
+          }
+          break;
+        default:
+          return transaction.status;
+      }
+    }
+
+    return ret;
+  }
+};
+}  // namespace odrive
@@ -16,12 +16,16 @@
 
 #include <libusb-1.0/libusb.h>
 
-#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
 #include <map>
+#include <string>
+#include <thread>
 #include <vector>
 
-#include "odrive_hardware_interface/odrive_endpoints.hpp"
+#include "odrive_hardware_interface/odrive_transport.hpp"
 
 #define ODRIVE_USB_VENDORID 0x1209
 #define ODRIVE_USB_PRODUCTID 0x0d32
@@ -29,46 +33,123 @@
 #define ODRIVE_OUT_ENDPOINT 0x03
 #define ODRIVE_IN_ENDPOINT 0x83
 
-#define ODRIVE_PROTOCOL_VERSION 1
-#define ODRIVE_MAX_PACKET_SIZE 16
-
-typedef std::vector<uint8_t> bytes;
-
 namespace odrive
 {
-class ODriveUSB
+class ODriveUSB : public ODriveTransport
 {
 public:
   ODriveUSB();
-  ~ODriveUSB();
+  ~ODriveUSB() override;
 
-  int init(const std::vector<std::vector<int64_t>> & serial_numbers);
+  int init(
+    const std::vector<std::vector<int64_t>> & serial_numbers,
+    size_t pipeline_depth = ODRIVE_DEFAULT_PIPELINE_DEPTH,
+    unsigned int transaction_timeout = ODRIVE_DEFAULT_TRANSACTION_TIMEOUT) override;
 
-  template <typename T>
-  int read(int64_t & serial_number, short endpoint_id, T & value);
-  template <typename T>
-  int write(int64_t & serial_number, short endpoint_id, const T & value);
-  int call(int64_t & serial_number, short endpoint_id);
+  // Transactions are queued on their ODrive and all boards are serviced from one event loop
+  int transfer(
+    std::vector<Transaction> & transactions,
+    std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::time_point::max()) override;
 
-private:
-  libusb_context * libusb_context_;
+  void setEndpointTable(int64_t serial_number, const EndpointTable & table) override;
+  int resolve(int64_t serial_number) override;
+  bool connected(int64_t serial_number) override;
+  uint32_t connections(int64_t serial_number) override;
 
-  std::map<int64_t, libusb_device_handle *> odrive_map_;
+  // Restricts enumeration to ODrives plugged into these USB port paths, e.g. "1-1.4"
+  void setPortPaths(const std::vector<std::string> & port_paths);
+  static std::string portPath(libusb_device * usb_device);
 
-  short sequence_number_;
+  // Ports boards were found at by a previous run. When every configured serial number has one,
+  // only those ports are opened and a serial number read confirms each board is still there.
+  void setKnownPorts(const std::map<int64_t, std::string> & known_ports);
+  std::string portPath(int64_t serial_number);
+  int64_t serialNumber(const std::string & port_path);
 
-  template <typename T>
-  int read(libusb_device_handle * odrive_handle, short endpoint_id, T & value);
-  template <typename T>
-  int write(libusb_device_handle * odrive_handle, short endpoint_id, const T & value);
-  int call(libusb_device_handle * odrive_handle, short endpoint_id);
+protected:
+  int transfer(Transaction & transaction) override;
 
-  int endpointOperation(
-    libusb_device_handle * odrive_handle, short endpoint_id, short response_size,
-    bytes request_payload, bytes & response_payload, bool MSB);
+private:
+  struct Device;
+
+  // Requests in flight are tracked in slots and matched to responses by sequence number
+  struct Slot
+  {
+    Device * device;
+    libusb_transfer * transfer;
+    unsigned char buffer[ODRIVE_MAX_PACKET_SIZE];
+    Transaction * transaction;
+    short sequence_number;
+    bool sending;
+    bool waiting;
+    // A response still awaited past this is given up on once an IN transfer times out
+    std::chrono::steady_clock::time_point timeout;
+  };
+
+  // Every ODrive has its own sequence space, pipeline and queue of pending transactions
+  struct Device
+  {
+    libusb_device_handle * handle;
+    libusb_device * usb_device;
+    std::string port_path;
+    bool connected;
+    uint32_t connections;
+    EndpointTable endpoints;
+    short sequence_number;
+    std::vector<Slot> slots;
+    std::vector<libusb_transfer *> in_transfers;
+    std::vector<libusb_transfer *> idle_in_transfers;
+    std::vector<unsigned char> in_buffers;
+    std::vector<Transaction *> queue;
+    size_t next;
+    size_t awaited_responses;
+    size_t outstanding;
+    // Set when the IN endpoint stalled or overflowed, so its halt is cleared before the next IN
+    // transfer is posted
+    bool in_halted;
+  };
+
+  libusb_context * libusb_context_;
 
-  bytes encodePacket(
-    short sequence_number, short endpoint_id, short response_size, const bytes & request_payload);
-  bytes decodePacket(bytes & response_packet);
+  std::map<int64_t, Device *> odrive_map_;
+  std::vector<Device *> devices_;
+  std::vector<std::string> port_paths_;
+  std::map<int64_t, std::string> known_ports_;
+
+  size_t pipeline_depth_;
+  unsigned int transaction_timeout_;
+  std::vector<Device *> active_devices_;
+
+  bool hotplug_registered_;
+  libusb_hotplug_callback_handle hotplug_handle_;
+  std::vector<libusb_device *> arrived_devices_;
+
+  Device * device(int64_t serial_number);
+  // Opens and claims an ODrive, skipping it early when its USB serial string is not one of
+  // serial_numbers. An empty list accepts every board.
+  Device * openDevice(libusb_device * usb_device, const std::vector<int64_t> & serial_numbers);
+  void closeDevice(Device * device);
+  void claim(
+    const std::vector<libusb_device *> & candidates, const std::vector<int64_t> & serial_numbers,
+    bool keep_all);
+  int identify(Device * device, uint64_t & serial_number);
+  void attachArrivedDevices();
+  static int hotplugCallback(
+    libusb_context * context, libusb_device * usb_device, libusb_hotplug_event event,
+    void * user_data);
+
+  int transfer(Device * device, Transaction & transaction);
+
+  void enqueue(Device * device, Transaction & transaction);
+  void run(std::chrono::steady_clock::time_point deadline);
+  void cancel(Device & device);
+  void dispatch(Device & device);
+  static void finish(Device & device, Slot & slot, int status);
+  static void abandon(Device & device, int status);
+  static void expire(Device & device, std::chrono::steady_clock::time_point now);
+  static void outCallback(libusb_transfer * transfer);
+  static void inCallback(libusb_transfer * transfer);
+  static int transferError(libusb_transfer_status status);
 };
 }  // namespace odrive
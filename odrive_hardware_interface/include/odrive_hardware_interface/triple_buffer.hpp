@@ -0,0 +1,62 @@
+// Copyright 2021 Factor Robotics
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace odrive
+{
+// Wait-free single-producer single-consumer exchange of the latest value. The producer fills
+// writeBuffer() and publishes it, the consumer picks up the newest published value with update().
+// Neither side ever blocks, and intermediate values may be skipped.
+template <typename T>
+class TripleBuffer
+{
+public:
+  TripleBuffer() : state_(1), write_(0), read_(2) {}
+
+  void init(const T & value)
+  {
+    for (T & buffer : buffers_) {
+      buffer = value;
+    }
+  }
+
+  T & writeBuffer() { return buffers_[write_]; }
+
+  void publish() { write_ = state_.exchange(write_ | DIRTY, std::memory_order_acq_rel) & INDEX; }
+
+  bool update()
+  {
+    if (!(state_.load(std::memory_order_acquire) & DIRTY)) {
+      return false;
+    }
+    read_ = state_.exchange(read_, std::memory_order_acq_rel) & INDEX;
+    return true;
+  }
+
+  const T & readBuffer() const { return buffers_[read_]; }
+
+private:
+  static constexpr uint8_t INDEX = 0x3;
+  static constexpr uint8_t DIRTY = 0x4;
+
+  T buffers_[3];
+  std::atomic<uint8_t> state_;
+  uint8_t write_;
+  uint8_t read_;
+};
+}  // namespace odrive
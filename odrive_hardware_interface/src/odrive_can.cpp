@@ -0,0 +1,672 @@
+// Copyright 2021 Factor Robotics
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "odrive_hardware_interface/odrive_can.hpp"
+#include "odrive_hardware_interface/odrive_can_planner.hpp"
+
+#include <linux/can/raw.h>
+#include <net/if.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <thread>
+
+#define ODRIVE_CAN_INPUT_TORQUE 0x1
+#define ODRIVE_CAN_INPUT_VEL 0x2
+#define ODRIVE_CAN_INPUT_POS 0x4
+
+namespace odrive
+{
+const CanSignal * findCanSignal(short endpoint)
+{
+  for (const CanSignal & signal : can_signals) {
+    if (signal.endpoint == endpoint) {
+      return &signal;
+    }
+  }
+  return NULL;
+}
+
+int openCanSocket(const std::string & interface, const std::vector<uint8_t> & node_ids)
+{
+  int fd = socket(PF_CAN, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, CAN_RAW);
+  if (fd < 0) {
+    return errnoStatus(errno);
+  }
+
+  ifreq request = {};
+  interface.copy(request.ifr_name, IFNAMSIZ - 1);
+  if (ioctl(fd, SIOCGIFINDEX, &request) < 0) {
+    int error = errno;
+    close(fd);
+    return error == ENODEV ? LIBUSB_ERROR_NOT_FOUND : errnoStatus(error);
+  }
+
+  // Standard frames whose upper 6 id bits are one of the nodes, data and remote alike
+  std::vector<can_filter> filters;
+  for (uint8_t node_id : node_ids) {
+    filters.push_back({canId(node_id, 0), CAN_EFF_FLAG | (CAN_SFF_MASK & ~0x1F)});
+  }
+  if (setsockopt(
+        fd, SOL_CAN_RAW, CAN_RAW_FILTER, filters.data(), filters.size() * sizeof(can_filter))) {
+    int error = errno;
+    close(fd);
+    return errnoStatus(error);
+  }
+
+  sockaddr_can address = {};
+  address.can_family = AF_CAN;
+  address.can_ifindex = request.ifr_ifindex;
+  if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address))) {
+    int error = errno;
+    close(fd);
+    return errnoStatus(error);
+  }
+
+  return fd;
+}
+
+CanReceiver::CanReceiver()
+{
+  for (int i = 0; i < ODRIVE_CAN_RECEIVE_BATCH; i++) {
+    vectors_[i] = {&frames_[i], sizeof(can_frame)};
+    messages_[i] = {};
+    messages_[i].msg_hdr.msg_iov = &vectors_[i];
+    messages_[i].msg_hdr.msg_iovlen = 1;
+  }
+}
+
+int CanReceiver::receive(int socket)
+{
+  int count = recvmmsg(socket, messages_, ODRIVE_CAN_RECEIVE_BATCH, MSG_DONTWAIT, NULL);
+  if (count < 0) {
+    return errno == EAGAIN ? 0 : errnoStatus(errno);
+  }
+  return count;
+}
+
+void CanSender::queue(
+  uint8_t node_id, uint8_t command, const void * payload, uint8_t size, bool rtr)
+{
+  frames_.emplace_back();
+  can_frame & frame = frames_.back();
+  frame = {};
+  frame.can_id = canId(node_id, command) | (rtr ? CAN_RTR_FLAG : 0);
+  frame.can_dlc = size;
+  if (!rtr && size) {
+    std::memcpy(frame.data, payload, size);
+  }
+}
+
+int CanSender::send(int socket, std::chrono::steady_clock::time_point deadline)
+{
+  vectors_.resize(frames_.size());
+  messages_.resize(frames_.size());
+  for (size_t i = 0; i < frames_.size(); i++) {
+    vectors_[i] = {&frames_[i], sizeof(can_frame)};
+    messages_[i] = {};
+    messages_[i].msg_hdr.msg_iov = &vectors_[i];
+    messages_[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  int ret = LIBUSB_SUCCESS;
+  size_t sent = 0;
+  while (sent < frames_.size()) {
+    int count = sendmmsg(socket, &messages_[sent], frames_.size() - sent, MSG_DONTWAIT);
+    if (count >= 0) {
+      uint64_t bits = 0;
+      for (int i = 0; i < count; i++) {
+        bits += canFrameBits(frames_[sent + i]);
+      }
+      bits_.fetch_add(bits, std::memory_order_relaxed);
+      sent += count;
+      continue;
+    }
+    if (errno != EAGAIN && errno != ENOBUFS && errno != EINTR) {
+      ret = errnoStatus(errno);
+      break;
+    }
+    // The transmit queue is full until the bus takes the next frames
+    if (std::chrono::steady_clock::now() >= deadline) {
+      ret = LIBUSB_ERROR_TIMEOUT;
+      break;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+
+  frames_.clear();
+  return ret;
+}
+
+ODriveCAN::ODriveCAN(const std::string & interface, std::chrono::milliseconds heartbeat_timeout)
+: interface_(interface),
+  heartbeat_timeout_(heartbeat_timeout),
+  transaction_timeout_(ODRIVE_DEFAULT_TRANSACTION_TIMEOUT),
+  socket_(-1),
+  baud_rate_(0),
+  poll_period_(0),
+  received_bits_(0),
+  utilization_bits_(0)
+{
+  std::fill(node_map_, node_map_ + ODRIVE_CAN_NODE_COUNT, -1);
+}
+
+ODriveCAN::~ODriveCAN()
+{
+  if (socket_ >= 0) {
+    close(socket_);
+  }
+}
+
+int ODriveCAN::addNode(int64_t serial_number, uint8_t axis, uint8_t node_id)
+{
+  if (axis >= ODRIVE_AXIS_COUNT || node_id >= ODRIVE_CAN_NODE_COUNT || node_map_[node_id] >= 0) {
+    return LIBUSB_ERROR_INVALID_PARAM;
+  }
+
+  auto it = board_map_.find(serial_number);
+  if (it == board_map_.end()) {
+    it = board_map_.insert(std::pair<int64_t, size_t>(serial_number, boards_.size())).first;
+    boards_.emplace_back();
+    Board & board = boards_.back();
+    board = {};
+    board.serial_number = serial_number;
+    for (Node & node : board.nodes) {
+      node.node_id = -1;
+      node.input_mode = INPUT_MODE_PASSTHROUGH;
+    }
+  }
+
+  Board & board = boards_[it->second];
+  if (board.nodes[axis].node_id >= 0) {
+    return LIBUSB_ERROR_INVALID_PARAM;
+  }
+  board.nodes[axis].node_id = node_id;
+  node_map_[node_id] = it->second * ODRIVE_AXIS_COUNT + axis;
+
+  return LIBUSB_SUCCESS;
+}
+
+void ODriveCAN::schedule(uint32_t baud_rate, std::chrono::nanoseconds poll_period)
+{
+  baud_rate_ = baud_rate;
+  poll_period_ = poll_period;
+}
+
+double ODriveCAN::utilization()
+{
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  uint64_t bits = sender_.bits() + received_bits_.load(std::memory_order_relaxed);
+  double elapsed = std::chrono::duration<double>(now - utilization_time_).count();
+
+  double utilization = 0;
+  if (baud_rate_ && elapsed > 0) {
+    utilization = (bits - utilization_bits_) / (elapsed * baud_rate_);
+  }
+  utilization_bits_ = bits;
+  utilization_time_ = now;
+  return utilization;
+}
+
+int ODriveCAN::init(
+  const std::vector<std::vector<int64_t>> & serial_numbers, size_t,
+  unsigned int transaction_timeout)
+{
+  transaction_timeout_ = std::chrono::milliseconds(transaction_timeout);
+
+  for (const std::vector<int64_t> & group : serial_numbers) {
+    for (int64_t serial_number : group) {
+      if (!board_map_.count(serial_number)) {
+        std::cerr << "ODrive " << std::hex << serial_number << std::dec << " has no CAN node"
+                  << std::endl;
+        return LIBUSB_ERROR_NOT_FOUND;
+      }
+    }
+  }
+
+  std::vector<uint8_t> node_ids;
+  for (uint8_t node_id = 0; node_id < ODRIVE_CAN_NODE_COUNT; node_id++) {
+    if (node_map_[node_id] >= 0) {
+      node_ids.emplace_back(node_id);
+    }
+  }
+  int ret = openCanSocket(interface_, node_ids);
+  if (ret < 0) {
+    return ret;
+  }
+  socket_ = ret;
+
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::time_point timeout = now + heartbeat_timeout_;
+  size_t connected_boards = 0;
+  while (connected_boards < boards_.size() && now < timeout) {
+    pollfd descriptor = {socket_, POLLIN, 0};
+    poll(
+      &descriptor, 1,
+      std::chrono::duration_cast<std::chrono::milliseconds>(timeout - now).count() + 1);
+    now = std::chrono::steady_clock::now();
+    receive(now);
+
+    connected_boards = 0;
+    for (const Board & board : boards_) {
+      connected_boards += board.connected;
+    }
+  }
+
+  // Spread the polls of the nodes evenly over the poll period
+  std::vector<Node *> nodes;
+  for (Board & board : boards_) {
+    for (Node & node : board.nodes) {
+      if (node.node_id >= 0) {
+        nodes.emplace_back(&node);
+      }
+    }
+  }
+  for (size_t i = 0; i < nodes.size(); i++) {
+    nodes[i]->poll_time = now + poll_period_ * i / nodes.size();
+  }
+  utilization_bits_ = sender_.bits() + received_bits_.load(std::memory_order_relaxed);
+  utilization_time_ = now;
+
+  for (const Board & board : boards_) {
+    if (!board.connected) {
+      std::cerr << "ODrive " << std::hex << board.serial_number << std::dec
+                << " sends no heartbeat on " << interface_ << std::endl;
+      return LIBUSB_ERROR_NO_DEVICE;
+    }
+    std::cout << "Connected to ODrive " << std::hex << board.serial_number << std::dec << " on "
+              << interface_ << std::endl;
+  }
+
+  return LIBUSB_SUCCESS;
+}
+
+int ODriveCAN::transfer(
+  std::vector<Transaction> & transactions, std::chrono::steady_clock::time_point deadline)
+{
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  receive(now);
+  for (Board & board : boards_) {
+    expire(board, now);
+  }
+
+  waiting_.clear();
+  for (Transaction & transaction : transactions) {
+    Board * can_board = board(transaction);
+    if (!can_board || !can_board->connected) {
+      transaction.status = LIBUSB_ERROR_NO_DEVICE;
+      continue;
+    }
+    transaction.status = serve(*can_board, transaction, now);
+  }
+  for (Node * node : active_nodes_) {
+    finish(*node);
+  }
+  active_nodes_.clear();
+
+  std::chrono::steady_clock::time_point timeout = std::min(deadline, now + transaction_timeout_);
+  int ret = sender_.send(socket_, timeout);
+  if (ret != LIBUSB_SUCCESS) {
+    for (Transaction & transaction : transactions) {
+      if (!transaction.response && transaction.status == LIBUSB_SUCCESS) {
+        transaction.status = ret;
+      }
+    }
+  }
+
+  while (!waiting_.empty() && now < timeout) {
+    int64_t remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout - now).count();
+    timespec wait = {remaining / 1000000000, remaining % 1000000000};
+    pollfd descriptor = {socket_, POLLIN, 0};
+    ppoll(&descriptor, 1, &wait, NULL);
+    now = std::chrono::steady_clock::now();
+    receive(now);
+
+    for (size_t i = 0; i < waiting_.size();) {
+      const Waiting & waiting = waiting_[i];
+      const CanSignal & signal = *waiting.signal;
+      Node & node = *waiting.node;
+      if (node.received & (1u << signal.command)) {
+        waiting.transaction->status = copyValue(
+          *waiting.transaction, &node.messages[signal.command][signal.offset], signal.size);
+        waiting_[i] = waiting_.back();
+        waiting_.pop_back();
+      } else {
+        i++;
+      }
+    }
+  }
+
+  return batchStatus(transactions);
+}
+
+int ODriveCAN::transfer(Transaction & transaction)
+{
+  std::vector<Transaction> transactions(1, transaction);
+  int ret = transfer(transactions);
+  transaction = transactions[0];
+  return ret;
+}
+
+int ODriveCAN::resolve(int64_t serial_number)
+{
+  auto it = board_map_.find(serial_number);
+  return it == board_map_.end() ? (int)LIBUSB_ERROR_NO_DEVICE : (int)it->second;
+}
+
+bool ODriveCAN::connected(int64_t serial_number)
+{
+  auto it = board_map_.find(serial_number);
+  if (it == board_map_.end()) {
+    return false;
+  }
+  Board & board = boards_[it->second];
+  expire(board, std::chrono::steady_clock::now());
+  return board.connected;
+}
+
+uint32_t ODriveCAN::connections(int64_t serial_number)
+{
+  auto it = board_map_.find(serial_number);
+  return it == board_map_.end() ? 0 : boards_[it->second].connections;
+}
+
+ODriveCAN::Board * ODriveCAN::board(const Transaction & transaction)
+{
+  if ((size_t)transaction.device < boards_.size()) {
+    return &boards_[transaction.device];
+  }
+  auto it = board_map_.find(transaction.serial_number);
+  return it == board_map_.end() ? NULL : &boards_[it->second];
+}
+
+void ODriveCAN::receive(std::chrono::steady_clock::time_point now)
+{
+  int count;
+  do {
+    count = receiver_.receive(socket_);
+    for (int i = 0; i < count; i++) {
+      const can_frame & frame = receiver_.frame(i);
+      received_bits_.fetch_add(canFrameBits(frame), std::memory_order_relaxed);
+      if (frame.can_id & (CAN_EFF_FLAG | CAN_RTR_FLAG | CAN_ERR_FLAG)) {
+        continue;
+      }
+      int index = node_map_[(frame.can_id >> 5) & 0x3F];
+      if (index < 0) {
+        continue;
+      }
+      Board & board = boards_[index / ODRIVE_AXIS_COUNT];
+      Node & node = board.nodes[index % ODRIVE_AXIS_COUNT];
+      uint8_t command = frame.can_id & 0x1F;
+
+      if (command == CAN_HEARTBEAT) {
+        expire(board, now);
+        if (!board.connected) {
+          // Nothing received before the board went away is current any more
+          for (Node & board_node : board.nodes) {
+            board_node.received = 0;
+            board_node.requested = 0;
+          }
+          board.connected = true;
+          board.connections++;
+          board.connect_time = now;
+        }
+        board.heartbeat_time = now;
+      }
+
+      std::memset(node.messages[command], 0, CAN_MAX_DLEN);
+      std::memcpy(node.messages[command], frame.data, std::min<int>(frame.can_dlc, CAN_MAX_DLEN));
+      node.received |= 1u << command;
+      node.requested &= ~(1u << command);
+    }
+  } while (count == ODRIVE_CAN_RECEIVE_BATCH);
+}
+
+void ODriveCAN::expire(Board & board, std::chrono::steady_clock::time_point now)
+{
+  if (board.connected && now - board.heartbeat_time > heartbeat_timeout_) {
+    board.connected = false;
+  }
+}
+
+int ODriveCAN::serve(
+  Board & board, Transaction & transaction, std::chrono::steady_clock::time_point now)
+{
+  short endpoint = transaction.endpoint_id;
+  Node * node = NULL;
+  int offset = endpoint - first_axis_endpoint;
+  if (offset >= 0 && offset < ODRIVE_AXIS_COUNT * per_axis_offset) {
+    node = &board.nodes[offset / per_axis_offset];
+    endpoint -= offset / per_axis_offset * per_axis_offset;
+  } else {
+    for (Node & board_node : board.nodes) {
+      if (board_node.node_id >= 0) {
+        node = &board_node;
+        break;
+      }
+    }
+  }
+  if (!node || node->node_id < 0) {
+    return LIBUSB_ERROR_NOT_FOUND;
+  }
+
+  if (endpoint == CLEAR_ERRORS) {
+    for (Node & board_node : board.nodes) {
+      if (board_node.node_id >= 0) {
+        flushInputs(board_node);
+        sender_.queue(board_node.node_id, CAN_CLEAR_ERRORS, NULL, 0, false);
+        board_node.sent = true;
+        activate(board_node);
+      }
+    }
+    return LIBUSB_SUCCESS;
+  }
+  if (!transaction.response) {
+    return serveWrite(*node, endpoint, transaction);
+  }
+
+  // What CANSimple cannot read back is answered from what was sent
+  uint32_t uptime;
+  float temperature = std::numeric_limits<float>::quiet_NaN();
+  switch (endpoint) {
+    case AXIS__CONTROLLER__INPUT_POS:
+      return copyValue(transaction, &node->input_pos, sizeof(node->input_pos));
+    case AXIS__CONTROLLER__INPUT_VEL:
+      return copyValue(transaction, &node->input_vel, sizeof(node->input_vel));
+    case AXIS__CONTROLLER__INPUT_TORQUE:
+      return copyValue(transaction, &node->input_torque, sizeof(node->input_torque));
+    case AXIS__CONTROLLER__CONFIG__CONTROL_MODE:
+      return copyValue(transaction, &node->control_mode, sizeof(node->control_mode));
+    case AXIS__CONTROLLER__CONFIG__INPUT_MODE:
+      return copyValue(transaction, &node->input_mode, sizeof(node->input_mode));
+    case AXIS__MOTOR__FET_THERMISTOR__TEMPERATURE:
+    case AXIS__MOTOR__MOTOR_THERMISTOR__TEMPERATURE:
+      return copyValue(transaction, &temperature, sizeof(temperature));
+    case SYSTEM_STATS__UPTIME:
+      // Counts from the first heartbeat, so a reboot still shows as a drop
+      uptime =
+        std::chrono::duration_cast<std::chrono::milliseconds>(now - board.connect_time).count();
+      return copyValue(transaction, &uptime, sizeof(uptime));
+  }
+
+  const CanSignal * signal = findCanSignal(endpoint);
+  if (!signal) {
+    return LIBUSB_ERROR_NOT_SUPPORTED;
+  }
+  int ret = serveRead(*node, transaction, *signal, now);
+  if (ret == LIBUSB_ERROR_TIMEOUT) {
+    waiting_.push_back({&transaction, node, signal});
+  }
+  return ret;
+}
+
+int ODriveCAN::serveRead(
+  Node & node, Transaction & transaction, const CanSignal & signal,
+  std::chrono::steady_clock::time_point now)
+{
+  // Error messages are only asked for while the heartbeat flags an error
+  int flag = signal.command == CAN_GET_MOTOR_ERROR        ? ODRIVE_CAN_MOTOR_ERROR_FLAG
+             : signal.command == CAN_GET_ENCODER_ERROR    ? ODRIVE_CAN_ENCODER_ERROR_FLAG
+             : signal.command == CAN_GET_CONTROLLER_ERROR ? ODRIVE_CAN_CONTROLLER_ERROR_FLAG
+                                                          : -1;
+  if (flag >= 0 && !(node.messages[CAN_HEARTBEAT][flag] & 0x1)) {
+    uint64_t no_error = 0;
+    return copyValue(transaction, &no_error, sizeof(no_error));
+  }
+
+  uint32_t bit = 1u << signal.command;
+  if (node.requested & bit && now - node.request_time > transaction_timeout_) {
+    node.requested &= ~bit;
+  }
+  // Until the first reply is in, a read waits for it rather than for the node's turn
+  if (signal.polled && !(node.requested & bit) && (!(node.received & bit) || pollDue(node, now))) {
+    sender_.queue(node.node_id, signal.command, NULL, CAN_MAX_DLEN, true);
+    node.requested |= bit;
+    node.request_time = now;
+    node.sent = true;
+    activate(node);
+  }
+
+  if (!(node.received & bit)) {
+    return LIBUSB_ERROR_TIMEOUT;
+  }
+  return copyValue(transaction, &node.messages[signal.command][signal.offset], signal.size);
+}
+
+int ODriveCAN::serveWrite(Node & node, short endpoint, const Transaction & transaction)
+{
+  int32_t value = 0;
+  if (transaction.request_size) {
+    std::memcpy(&value, transaction.request, std::min<size_t>(transaction.request_size, 4));
+  }
+
+  switch (endpoint) {
+    case AXIS__CONTROLLER__INPUT_POS:
+      std::memcpy(&node.input_pos, &value, sizeof(node.input_pos));
+      node.pending_inputs |= ODRIVE_CAN_INPUT_POS;
+      break;
+    case AXIS__CONTROLLER__INPUT_VEL:
+      std::memcpy(&node.input_vel, &value, sizeof(node.input_vel));
+      node.pending_inputs |= ODRIVE_CAN_INPUT_VEL;
+      break;
+    case AXIS__CONTROLLER__INPUT_TORQUE:
+      std::memcpy(&node.input_torque, &value, sizeof(node.input_torque));
+      node.pending_inputs |= ODRIVE_CAN_INPUT_TORQUE;
+      break;
+    case AXIS__CONTROLLER__CONFIG__CONTROL_MODE:
+    case AXIS__CONTROLLER__CONFIG__INPUT_MODE: {
+      (endpoint == AXIS__CONTROLLER__CONFIG__CONTROL_MODE ? node.control_mode : node.input_mode) =
+        value;
+      int32_t modes[2] = {node.control_mode, node.input_mode};
+      flushInputs(node);
+      sender_.queue(node.node_id, CAN_SET_CONTROLLER_MODES, modes, sizeof(modes), false);
+      node.sent = true;
+      break;
+    }
+    case AXIS__REQUESTED_STATE:
+      flushInputs(node);
+      sender_.queue(node.node_id, CAN_SET_AXIS_REQUESTED_STATE, &value, sizeof(value), false);
+      node.sent = true;
+      break;
+    case AXIS__WATCHDOG_FEED:
+      node.fed = true;
+      break;
+    default:
+      return LIBUSB_ERROR_NOT_SUPPORTED;
+  }
+
+  activate(node);
+  return LIBUSB_SUCCESS;
+}
+
+bool ODriveCAN::pollDue(Node & node, std::chrono::steady_clock::time_point now)
+{
+  if (!node.polling && now >= node.poll_time) {
+    node.polling = true;
+    activate(node);
+    if (poll_period_.count() > 0) {
+      // Skip turns that were missed, keeping the node's phase
+      node.poll_time += ((now - node.poll_time) / poll_period_ + 1) * poll_period_;
+    }
+  }
+  return node.polling;
+}
+
+void ODriveCAN::activate(Node & node)
+{
+  if (!node.active) {
+    node.active = true;
+    active_nodes_.emplace_back(&node);
+  }
+}
+
+// Set_Input_Pos carries the velocity and torque feedforward in units of 0.001 and Set_Input_Vel
+// the torque feedforward, so one frame covers all inputs written to an axis
+void ODriveCAN::flushInputs(Node & node)
+{
+  unsigned char payload[CAN_MAX_DLEN];
+  if (node.pending_inputs & ODRIVE_CAN_INPUT_POS) {
+    int16_t feedforward[2] = {scaledFeedforward(node.input_vel),
+                              scaledFeedforward(node.input_torque)};
+    std::memcpy(&payload[0], &node.input_pos, sizeof(node.input_pos));
+    std::memcpy(&payload[4], feedforward, sizeof(feedforward));
+    sender_.queue(node.node_id, CAN_SET_INPUT_POS, payload, 8, false);
+  } else if (node.pending_inputs & ODRIVE_CAN_INPUT_VEL) {
+    std::memcpy(&payload[0], &node.input_vel, sizeof(node.input_vel));
+    std::memcpy(&payload[4], &node.input_torque, sizeof(node.input_torque));
+    sender_.queue(node.node_id, CAN_SET_INPUT_VEL, payload, 8, false);
+  } else if (node.pending_inputs & ODRIVE_CAN_INPUT_TORQUE) {
+    sender_.queue(
+      node.node_id, CAN_SET_INPUT_TORQUE, &node.input_torque, sizeof(node.input_torque), false);
+  }
+  node.sent |= node.pending_inputs != 0;
+  node.pending_inputs = 0;
+}
+
+void ODriveCAN::finish(Node & node)
+{
+  flushInputs(node);
+
+  // Every message to an axis feeds its watchdog, so a feed only costs a frame on its own
+  if (node.fed && !node.sent) {
+    sender_.queue(node.node_id, CAN_HEARTBEAT, NULL, CAN_MAX_DLEN, true);
+  }
+  node.fed = false;
+  node.sent = false;
+  node.polling = false;
+  node.active = false;
+}
+
+int ODriveCAN::copyValue(Transaction & transaction, const void * value, size_t size)
+{
+  std::memset(transaction.response, 0, transaction.response_size);
+  std::memcpy(transaction.response, value, std::min<size_t>(size, transaction.response_size));
+  return LIBUSB_SUCCESS;
+}
+
+int16_t ODriveCAN::scaledFeedforward(float value)
+{
+  float scaled = std::round(value * 1e3f);
+  if (!(scaled > std::numeric_limits<int16_t>::min())) {
+    return std::isnan(scaled) ? 0 : std::numeric_limits<int16_t>::min();
+  }
+  return scaled < std::numeric_limits<int16_t>::max() ? (int16_t)scaled
+                                                      : std::numeric_limits<int16_t>::max();
+}
+}  // namespace odrive
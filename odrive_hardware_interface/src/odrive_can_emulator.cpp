@@ -0,0 +1,264 @@
+// Copyright 2021 Factor Robotics
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "odrive_hardware_interface/odrive_can_emulator.hpp"
+
+#include <poll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+
+namespace odrive
+{
+ODriveCANEmulator::ODriveCANEmulator(ODriveTransport & boards)
+: boards_(boards), socket_(-1), running_(false)
+{
+  std::fill(node_map_, node_map_ + ODRIVE_CAN_NODE_COUNT, -1);
+}
+
+ODriveCANEmulator::~ODriveCANEmulator()
+{
+  stop();
+  if (socket_ >= 0) {
+    close(socket_);
+  }
+}
+
+int ODriveCANEmulator::start(
+  const std::string & interface, const std::vector<int64_t> & serial_numbers)
+{
+  std::vector<uint8_t> node_ids;
+  for (int64_t serial_number : serial_numbers) {
+    for (uint8_t axis = 0; axis < ODRIVE_AXIS_COUNT; axis++) {
+      uint32_t node_id;
+      uint32_t heartbeat_rate;
+      uint32_t encoder_rate;
+      transactions_ = {
+        Transaction::read<AXIS__CONFIG__CAN__NODE_ID>(serial_number, axis, node_id),
+        Transaction::read<AXIS__CONFIG__CAN__HEARTBEAT_RATE_MS>(
+          serial_number, axis, heartbeat_rate),
+        Transaction::read<AXIS__CONFIG__CAN__ENCODER_RATE_MS>(serial_number, axis, encoder_rate)};
+      int ret = boards_.transfer(transactions_);
+      if (ret != LIBUSB_SUCCESS) {
+        return ret;
+      }
+      if (node_id >= ODRIVE_CAN_NODE_COUNT) {
+        continue;
+      }
+      if (node_map_[node_id] >= 0) {
+        std::cerr << "ODrive " << std::hex << serial_number << std::dec << " axis" << (int)axis
+                  << " has node id " << node_id << " which is taken" << std::endl;
+        return LIBUSB_ERROR_INVALID_PARAM;
+      }
+
+      node_map_[node_id] = nodes_.size();
+      nodes_.push_back(
+        {serial_number, axis, (uint8_t)node_id, std::chrono::milliseconds(heartbeat_rate),
+         std::chrono::milliseconds(encoder_rate), {}, {}});
+      node_ids.emplace_back(node_id);
+      std::cout << "Emulating ODrive " << std::hex << serial_number << std::dec << " axis"
+                << (int)axis << " as CAN node " << node_id << " on " << interface << std::endl;
+    }
+  }
+
+  int ret = openCanSocket(interface, node_ids);
+  if (ret < 0) {
+    return ret;
+  }
+  socket_ = ret;
+
+  running_ = true;
+  thread_ = std::thread(&ODriveCANEmulator::run, this);
+  return LIBUSB_SUCCESS;
+}
+
+void ODriveCANEmulator::stop()
+{
+  if (thread_.joinable()) {
+    running_ = false;
+    thread_.join();
+  }
+}
+
+void ODriveCANEmulator::run()
+{
+  while (running_) {
+    // Wake up for the next broadcast, or every 10 ms to notice stop()
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point wakeup = now + std::chrono::milliseconds(10);
+    for (Node & node : nodes_) {
+      broadcast(node, CAN_HEARTBEAT, node.heartbeat_period, node.next_heartbeat, now);
+      broadcast(node, CAN_GET_ENCODER_ESTIMATES, node.encoder_period, node.next_encoder, now);
+      if (node.heartbeat_period.count()) {
+        wakeup = std::min(wakeup, node.next_heartbeat);
+      }
+      if (node.encoder_period.count()) {
+        wakeup = std::min(wakeup, node.next_encoder);
+      }
+    }
+    sender_.send(socket_, now + std::chrono::milliseconds(10));
+
+    int64_t remaining =
+      std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             wakeup - std::chrono::steady_clock::now())
+                             .count());
+    timespec wait = {remaining / 1000000000, remaining % 1000000000};
+    pollfd descriptor = {socket_, POLLIN, 0};
+    ppoll(&descriptor, 1, &wait, NULL);
+
+    int count;
+    do {
+      count = receiver_.receive(socket_);
+      for (int i = 0; i < count; i++) {
+        handle(receiver_.frame(i));
+      }
+    } while (count == ODRIVE_CAN_RECEIVE_BATCH);
+    sender_.send(socket_, std::chrono::steady_clock::now() + std::chrono::milliseconds(10));
+  }
+}
+
+void ODriveCANEmulator::broadcast(
+  const Node & node, uint8_t command, std::chrono::milliseconds period,
+  std::chrono::steady_clock::time_point & next, std::chrono::steady_clock::time_point now)
+{
+  if (!period.count() || now < next) {
+    return;
+  }
+  reply(node, command);
+  next = std::max(next + period, now);
+}
+
+void ODriveCANEmulator::handle(const can_frame & frame)
+{
+  if (frame.can_id & (CAN_EFF_FLAG | CAN_ERR_FLAG)) {
+    return;
+  }
+  int index = node_map_[(frame.can_id >> 5) & 0x3F];
+  if (index < 0) {
+    return;
+  }
+  const Node & node = nodes_[index];
+  uint8_t command = frame.can_id & 0x1F;
+
+  float input_pos;
+  float input_vel;
+  float input_torque;
+  int16_t feedforward[2];
+  int32_t modes[2];
+  endpoint_type_t<AXIS__CONTROLLER__CONFIG__CONTROL_MODE> control_mode;
+  endpoint_type_t<AXIS__CONTROLLER__CONFIG__INPUT_MODE> input_mode;
+  endpoint_type_t<AXIS__REQUESTED_STATE> requested_state;
+
+  transactions_.clear();
+  if (!(frame.can_id & CAN_RTR_FLAG)) {
+    switch (command) {
+      case CAN_SET_INPUT_POS:
+        std::memcpy(&input_pos, &frame.data[0], sizeof(input_pos));
+        std::memcpy(feedforward, &frame.data[4], sizeof(feedforward));
+        input_vel = feedforward[0] * 1e-3f;
+        input_torque = feedforward[1] * 1e-3f;
+        transactions_.emplace_back(Transaction::write<AXIS__CONTROLLER__INPUT_POS>(
+          node.serial_number, node.axis, input_pos));
+        transactions_.emplace_back(Transaction::write<AXIS__CONTROLLER__INPUT_VEL>(
+          node.serial_number, node.axis, input_vel));
+        transactions_.emplace_back(Transaction::write<AXIS__CONTROLLER__INPUT_TORQUE>(
+          node.serial_number, node.axis, input_torque));
+        break;
+      case CAN_SET_INPUT_VEL:
+        std::memcpy(&input_vel, &frame.data[0], sizeof(input_vel));
+        std::memcpy(&input_torque, &frame.data[4], sizeof(input_torque));
+        transactions_.emplace_back(Transaction::write<AXIS__CONTROLLER__INPUT_VEL>(
+          node.serial_number, node.axis, input_vel));
+        transactions_.emplace_back(Transaction::write<AXIS__CONTROLLER__INPUT_TORQUE>(
+          node.serial_number, node.axis, input_torque));
+        break;
+      case CAN_SET_INPUT_TORQUE:
+        std::memcpy(&input_torque, &frame.data[0], sizeof(input_torque));
+        transactions_.emplace_back(Transaction::write<AXIS__CONTROLLER__INPUT_TORQUE>(
+          node.serial_number, node.axis, input_torque));
+        break;
+      case CAN_SET_CONTROLLER_MODES:
+        std::memcpy(modes, frame.data, sizeof(modes));
+        control_mode = modes[0];
+        input_mode = modes[1];
+        transactions_.emplace_back(Transaction::write<AXIS__CONTROLLER__CONFIG__CONTROL_MODE>(
+          node.serial_number, node.axis, control_mode));
+        transactions_.emplace_back(Transaction::write<AXIS__CONTROLLER__CONFIG__INPUT_MODE>(
+          node.serial_number, node.axis, input_mode));
+        break;
+      case CAN_CLEAR_ERRORS:
+        transactions_.emplace_back(Transaction::call<CLEAR_ERRORS>(node.serial_number));
+        break;
+      case CAN_SET_AXIS_REQUESTED_STATE:
+        requested_state = frame.data[0];
+        transactions_.emplace_back(Transaction::write<AXIS__REQUESTED_STATE>(
+          node.serial_number, node.axis, requested_state));
+        break;
+    }
+  }
+  transactions_.emplace_back(
+    Transaction::call<AXIS__WATCHDOG_FEED>(node.serial_number, node.axis));
+  boards_.transfer(transactions_);
+
+  if (frame.can_id & CAN_RTR_FLAG) {
+    reply(node, command);
+  }
+}
+
+// Messages are filled from the endpoints their signals come from, which also makes the board
+// update its state first
+void ODriveCANEmulator::reply(const Node & node, uint8_t command)
+{
+  unsigned char payload[CAN_MAX_DLEN] = {};
+  endpoint_type_t<AXIS__MOTOR__ERROR> motor_error = 0;
+  endpoint_type_t<AXIS__ENCODER__ERROR> encoder_error = 0;
+  endpoint_type_t<AXIS__CONTROLLER__ERROR> controller_error = 0;
+
+  transactions_.clear();
+  for (const CanSignal & signal : can_signals) {
+    if (signal.command != command) {
+      continue;
+    }
+    short endpoint_id = signal.endpoint >= first_axis_endpoint
+                          ? signal.endpoint + node.axis * per_axis_offset
+                          : signal.endpoint;
+    transactions_.push_back(
+      {node.serial_number, endpoint_id, NULL, 0, &payload[signal.offset], signal.size, true, NULL,
+       -1, LIBUSB_SUCCESS});
+  }
+  if (transactions_.empty()) {
+    return;
+  }
+  if (command == CAN_HEARTBEAT) {
+    transactions_.emplace_back(
+      Transaction::read<AXIS__MOTOR__ERROR>(node.serial_number, node.axis, motor_error));
+    transactions_.emplace_back(
+      Transaction::read<AXIS__ENCODER__ERROR>(node.serial_number, node.axis, encoder_error));
+    transactions_.emplace_back(
+      Transaction::read<AXIS__CONTROLLER__ERROR>(node.serial_number, node.axis, controller_error));
+  }
+
+  // A board that does not answer stays silent on the bus as well
+  if (boards_.transfer(transactions_) != LIBUSB_SUCCESS) {
+    return;
+  }
+  if (command == CAN_HEARTBEAT) {
+    payload[ODRIVE_CAN_MOTOR_ERROR_FLAG] = motor_error != 0;
+    payload[ODRIVE_CAN_ENCODER_ERROR_FLAG] = encoder_error != 0;
+    payload[ODRIVE_CAN_CONTROLLER_ERROR_FLAG] = controller_error != 0;
+  }
+  sender_.queue(node.node_id, command, payload, CAN_MAX_DLEN, false);
+}
+}  // namespace odrive
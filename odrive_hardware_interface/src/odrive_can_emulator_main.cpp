@@ -0,0 +1,127 @@
+// Copyright 2021 Factor Robotics
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Serves emulated ODrives on a CAN interface, e.g. for the can transport on a vcan interface:
+//
+//   ip link add dev vcan0 type vcan && ip link set up vcan0
+//   ros2 run odrive_hardware_interface odrive_can_emulator vcan0 2000:0:0 2000:1:1
+//
+// Every node is given as serial number (hex), axis and node id. --simulator emulates the boards
+// with motor dynamics, --heartbeat_rate and --encoder_rate set the broadcast periods in ms.
+
+#include <signal.h>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "odrive_hardware_interface/odrive_can_emulator.hpp"
+#include "odrive_hardware_interface/odrive_simulator.hpp"
+
+using namespace odrive;
+
+struct NodeOption
+{
+  int64_t serial_number;
+  uint8_t axis;
+  uint32_t node_id;
+};
+
+int main(int argc, char ** argv)
+{
+  std::string interface;
+  std::vector<NodeOption> nodes;
+  bool simulator = false;
+  uint32_t heartbeat_rate = 100;
+  uint32_t encoder_rate = 1;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--simulator") {
+      simulator = true;
+    } else if (arg == "--heartbeat_rate" && i + 1 < argc) {
+      heartbeat_rate = std::stoul(argv[++i]);
+    } else if (arg == "--encoder_rate" && i + 1 < argc) {
+      encoder_rate = std::stoul(argv[++i]);
+    } else if (interface.empty() && arg.find(':') == std::string::npos) {
+      interface = arg;
+    } else {
+      size_t first = arg.find(':');
+      size_t second = arg.find(':', first + 1);
+      if (first == std::string::npos || second == std::string::npos) {
+        std::cerr << "Unknown argument " << arg << std::endl;
+        return 1;
+      }
+      nodes.push_back(
+        {(int64_t)std::stoull(arg.substr(0, first), 0, 16),
+         (uint8_t)std::stoul(arg.substr(first + 1, second - first - 1)),
+         (uint32_t)std::stoul(arg.substr(second + 1))});
+    }
+  }
+  if (interface.empty() || nodes.empty()) {
+    std::cerr << "Usage: odrive_can_emulator <interface> <serial>:<axis>:<node id>... "
+                 "[--simulator] [--heartbeat_rate ms] [--encoder_rate ms]"
+              << std::endl;
+    return 1;
+  }
+
+  std::unique_ptr<ODriveEmulator> boards;
+  if (simulator) {
+    boards.reset(new ODriveSimulator(AxisDynamics{1e-4, 1e-4, 1e-3}));
+  } else {
+    boards.reset(new ODriveEmulator());
+  }
+
+  std::vector<int64_t> serial_numbers;
+  for (const NodeOption & node : nodes) {
+    if (std::find(serial_numbers.begin(), serial_numbers.end(), node.serial_number) ==
+        serial_numbers.end()) {
+      serial_numbers.emplace_back(node.serial_number);
+    }
+  }
+  boards->init({serial_numbers, {}});
+
+  // Axes without a node get an id outside the CANSimple range and stay off the bus
+  uint32_t spare_node_id = ODRIVE_CAN_NODE_COUNT;
+  for (int64_t serial_number : serial_numbers) {
+    for (uint8_t axis = 0; axis < ODRIVE_AXIS_COUNT; axis++) {
+      boards->set<AXIS__CONFIG__CAN__NODE_ID>(serial_number, axis, spare_node_id++);
+      boards->set<AXIS__CONFIG__CAN__HEARTBEAT_RATE_MS>(serial_number, axis, heartbeat_rate);
+      boards->set<AXIS__CONFIG__CAN__ENCODER_RATE_MS>(serial_number, axis, encoder_rate);
+    }
+  }
+  for (const NodeOption & node : nodes) {
+    boards->set<AXIS__CONFIG__CAN__NODE_ID>(node.serial_number, node.axis, node.node_id);
+  }
+
+  // Handle SIGINT and SIGTERM in main() only, after the emulator thread inherited the mask
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+  ODriveCANEmulator emulator(*boards);
+  int ret = emulator.start(interface, serial_numbers);
+  if (ret != LIBUSB_SUCCESS) {
+    std::cerr << "Failed to start: " << libusb_error_name(ret) << std::endl;
+    return 1;
+  }
+
+  int signal_number;
+  sigwait(&signals, &signal_number);
+  emulator.stop();
+  return 0;
+}
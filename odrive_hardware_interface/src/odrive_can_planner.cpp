@@ -0,0 +1,183 @@
+// Copyright 2021 Factor Robotics
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "odrive_hardware_interface/odrive_can_planner.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "odrive_hardware_interface/odrive_can.hpp"
+
+namespace odrive
+{
+int canFrameBits(const can_frame & frame)
+{
+  bool rtr = frame.can_id & CAN_RTR_FLAG;
+  int size = rtr ? 0 : std::min<int>(frame.can_dlc, CAN_MAX_DLEN);
+
+  // Start of frame, identifier, RTR, IDE, r0, DLC and data as they go on the wire, then the CRC
+  uint8_t bits[34 + 8 * CAN_MAX_DLEN];
+  int length = 0;
+  bits[length++] = 0;
+  for (int i = 10; i >= 0; i--) {
+    bits[length++] = (frame.can_id >> i) & 0x1;
+  }
+  bits[length++] = rtr;
+  bits[length++] = 0;
+  bits[length++] = 0;
+  for (int i = 3; i >= 0; i--) {
+    bits[length++] = (frame.can_dlc >> i) & 0x1;
+  }
+  for (int byte = 0; byte < size; byte++) {
+    for (int i = 7; i >= 0; i--) {
+      bits[length++] = (frame.data[byte] >> i) & 0x1;
+    }
+  }
+
+  uint16_t crc = 0;
+  for (int i = 0; i < length; i++) {
+    bool next = bits[i] ^ ((crc >> 14) & 0x1);
+    crc = (crc << 1) & 0x7FFF;
+    if (next) {
+      crc ^= 0x4599;
+    }
+  }
+  for (int i = 14; i >= 0; i--) {
+    bits[length++] = (crc >> i) & 0x1;
+  }
+
+  // Five equal bits in a row get an opposite stuff bit, which starts the next run
+  int stuff_bits = 0;
+  int run = 0;
+  int last = -1;
+  for (int i = 0; i < length; i++) {
+    run = bits[i] == last ? run + 1 : 1;
+    last = bits[i];
+    if (run == 5) {
+      stuff_bits++;
+      last = !last;
+      run = 1;
+    }
+  }
+
+  // CRC delimiter, ACK slot and delimiter, end of frame and interframe space
+  return length + stuff_bits + 13;
+}
+
+namespace
+{
+struct Stream
+{
+  // Arbitration order, lower wins. Remote frames lose against data frames with the same id.
+  uint32_t priority;
+  double bits;
+  double period;
+  bool setpoint;
+  bool telemetry;
+};
+
+// Worst-case response time of every stream, or infinity if one can miss its period
+void analyse(
+  const std::vector<Stream> & streams, uint32_t baud_rate, double & setpoint_latency,
+  double & telemetry_latency)
+{
+  setpoint_latency = 0;
+  telemetry_latency = 0;
+  double bit_time = 1.0 / baud_rate;
+
+  for (const Stream & stream : streams) {
+    // A frame that already started cannot be preempted
+    double blocking = 0;
+    for (const Stream & other : streams) {
+      if (other.priority > stream.priority) {
+        blocking = std::max(blocking, other.bits * bit_time);
+      }
+    }
+
+    double transmission = stream.bits * bit_time;
+    double queueing = blocking;
+    double latency = std::numeric_limits<double>::infinity();
+    while (queueing + transmission <= stream.period) {
+      double interference = blocking;
+      for (const Stream & other : streams) {
+        if (other.priority < stream.priority) {
+          interference +=
+            std::ceil((queueing + bit_time) / other.period) * other.bits * bit_time;
+        }
+      }
+      if (interference <= queueing) {
+        latency = queueing + transmission;
+        break;
+      }
+      queueing = interference;
+    }
+
+    if (stream.setpoint) {
+      setpoint_latency = std::max(setpoint_latency, latency);
+    }
+    if (stream.telemetry) {
+      telemetry_latency = std::max(telemetry_latency, latency);
+    }
+  }
+}
+}  // namespace
+
+CanPlan planCanTraffic(
+  const std::vector<CanAxisTraffic> & axes, uint32_t baud_rate, double update_period,
+  double max_utilization, double poll_period)
+{
+  CanPlan plan = {};
+  for (int multiple = 1; multiple <= 64; multiple *= 2) {
+    plan.poll_period = poll_period > 0 ? poll_period : multiple * update_period;
+
+    std::vector<Stream> streams;
+    for (const CanAxisTraffic & axis : axes) {
+      auto stream = [&axis](uint8_t command, bool rtr, double period) -> Stream {
+        return {
+          (canId(axis.node_id, command) << 1) | rtr, (double)canWorstCaseBits(rtr ? 0 : 8),
+          period, command == CAN_SET_INPUT_POS, command == CAN_GET_ENCODER_ESTIMATES};
+      };
+
+      streams.emplace_back(stream(CAN_SET_INPUT_POS, false, update_period));
+      if (axis.encoder_period > 0) {
+        streams.emplace_back(stream(CAN_GET_ENCODER_ESTIMATES, false, axis.encoder_period));
+      }
+      if (axis.heartbeat_period > 0) {
+        streams.emplace_back(stream(CAN_HEARTBEAT, false, axis.heartbeat_period));
+      }
+      streams.emplace_back(stream(CAN_GET_IQ, true, plan.poll_period));
+      streams.emplace_back(stream(CAN_GET_IQ, false, plan.poll_period));
+      if (axis.polls_vbus) {
+        streams.emplace_back(stream(CAN_GET_VBUS_VOLTAGE, true, plan.poll_period));
+        streams.emplace_back(stream(CAN_GET_VBUS_VOLTAGE, false, plan.poll_period));
+      }
+    }
+
+    plan.utilization = 0;
+    for (const Stream & stream : streams) {
+      plan.utilization += stream.bits / stream.period / baud_rate;
+    }
+    analyse(streams, baud_rate, plan.setpoint_latency, plan.telemetry_latency);
+    plan.feasible = plan.utilization <= max_utilization && std::isfinite(plan.setpoint_latency) &&
+                    std::isfinite(plan.telemetry_latency);
+
+    if (plan.feasible || poll_period > 0) {
+      break;
+    }
+  }
+
+  return plan;
+}
+}  // namespace odrive
@@ -0,0 +1,389 @@
+// Copyright 2021 Factor Robotics
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "odrive_hardware_interface/odrive_emulator.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "odrive_hardware_interface/odrive_endpoint_names.hpp"
+
+namespace odrive
+{
+// A descriptor with every endpoint of odrive_endpoints.hpp under its own id, padded so that its
+// CRC comes out as json_crc
+static std::string emulatedDescriptor()
+{
+  std::ostringstream members;
+  members << "[";
+  for (const EndpointName & name : endpoint_names) {
+    bool per_axis =
+      name.id >= first_axis_endpoint && name.id < first_axis_endpoint + per_axis_offset;
+    for (int axis = 0; axis < (per_axis ? ODRIVE_EMULATOR_AXIS_COUNT : 1); axis++) {
+      std::string path = name.path;
+      if (per_axis) {
+        path.replace(4, 1, std::to_string(axis));
+      }
+      members << "{\"name\":\"" << path << "\",\"id\":" << name.id + axis * per_axis_offset
+              << ",\"type\":\"" << name.type << "\"},";
+    }
+  }
+  members << "{\"name\":\"";
+
+  const std::string prefix = members.str();
+  const std::string suffix = "\",\"id\":0,\"type\":\"json\"}]";
+
+  uint16_t crc = descriptorCrc(prefix.data(), prefix.size());
+  char padding[4];
+  for (uint32_t i = 0; i < 26 * 26 * 26 * 26; i++) {
+    for (uint32_t j = 0, letters = i; j < sizeof(padding); j++, letters /= 26) {
+      padding[j] = 'a' + letters % 26;
+    }
+    uint16_t padded_crc = descriptorCrc(padding, sizeof(padding), crc);
+    if (descriptorCrc(suffix.data(), suffix.size(), padded_crc) == json_crc) {
+      return prefix + std::string(padding, sizeof(padding)) + suffix;
+    }
+  }
+  return prefix + suffix;
+}
+
+ODriveEmulator::ODriveEmulator(std::chrono::nanoseconds latency, std::chrono::nanoseconds jitter)
+: latency_(latency), jitter_(jitter), random_(std::random_device()())
+{
+  static const std::string descriptor = emulatedDescriptor();
+  setDescriptor(descriptor);
+  pipeline_depth_ = ODRIVE_DEFAULT_PIPELINE_DEPTH;
+  transaction_timeout_ = std::chrono::milliseconds(ODRIVE_DEFAULT_TRANSACTION_TIMEOUT);
+}
+
+ODriveEmulator::~ODriveEmulator() {}
+
+int ODriveEmulator::init(
+  const std::vector<std::vector<int64_t>> & serial_numbers, size_t pipeline_depth,
+  unsigned int transaction_timeout)
+{
+  pipeline_depth_ = pipeline_depth ? pipeline_depth : 1;
+  transaction_timeout_ = std::chrono::milliseconds(transaction_timeout);
+
+  for (const std::vector<int64_t> & group : serial_numbers) {
+    for (int64_t serial_number : group) {
+      if (board_map_.count(serial_number)) {
+        continue;
+      }
+      board_map_.insert(std::pair<int64_t, size_t>(serial_number, boards_.size()));
+      boards_.emplace_back();
+
+      Board & emulated_board = boards_.back();
+      emulated_board.serial_number = serial_number;
+      emulated_board.slots.resize(pipeline_depth_);
+      reset(emulated_board);
+      std::cout << "Emulating ODrive " << std::hex << serial_number << std::dec << std::endl;
+    }
+  }
+
+  return boards_.empty() ? LIBUSB_ERROR_NO_DEVICE : LIBUSB_SUCCESS;
+}
+
+int ODriveEmulator::transfer(
+  std::vector<Transaction> & transactions, std::chrono::steady_clock::time_point deadline)
+{
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  for (Board & emulated_board : boards_) {
+    update(emulated_board, now);
+    std::fill(emulated_board.slots.begin(), emulated_board.slots.end(), now);
+  }
+
+  // Boards work in parallel, and each keeps up to pipeline_depth_ transactions in flight
+  std::chrono::steady_clock::time_point done = now;
+  for (Transaction & transaction : transactions) {
+    Board * emulated_board = (size_t)transaction.device < boards_.size()
+                               ? &boards_[transaction.device]
+                               : board(transaction.serial_number);
+    if (!emulated_board) {
+      transaction.status = LIBUSB_ERROR_NO_DEVICE;
+      continue;
+    }
+
+    auto slot = std::min_element(emulated_board->slots.begin(), emulated_board->slots.end());
+    std::chrono::steady_clock::time_point completion = *slot + sampleLatency();
+    if (completion > deadline || completion - now > transaction_timeout_) {
+      transaction.status = LIBUSB_ERROR_TIMEOUT;
+      continue;
+    }
+    *slot = completion;
+    done = std::max(done, completion);
+
+    received_ = completion;
+    transaction.status = exchange(*emulated_board, transaction);
+  }
+
+  if (done > now) {
+    std::this_thread::sleep_until(done);
+  }
+
+  return batchStatus(transactions);
+}
+
+int ODriveEmulator::transfer(Transaction & transaction)
+{
+  Board * emulated_board = board(transaction.serial_number);
+  if (!emulated_board) {
+    return LIBUSB_ERROR_NO_DEVICE;
+  }
+
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  update(*emulated_board, now);
+  received_ = now + sampleLatency();
+  std::this_thread::sleep_until(received_);
+
+  transaction.status = exchange(*emulated_board, transaction);
+  return transaction.status;
+}
+
+void ODriveEmulator::setEndpointTable(int64_t serial_number, const EndpointTable & table)
+{
+  Board * emulated_board = board(serial_number);
+  if (emulated_board) {
+    emulated_board->endpoints = table;
+  }
+}
+
+// The emulated firmware numbers its endpoints as the descriptor says, so a descriptor with other
+// ids emulates other firmware. Its CRC is what requests have to carry.
+void ODriveEmulator::setDescriptor(const std::string & descriptor)
+{
+  descriptor_ = descriptor;
+
+  EndpointTable layout;
+  parseDescriptor(descriptor, layout);
+  descriptor_crc_ = layout.crc;
+  compiled_ids_.assign(layout.ids.empty() ? 0 : 1, -1);
+  for (size_t id = 0; id < layout.ids.size(); id++) {
+    if (layout.ids[id] < 0) {
+      continue;
+    }
+    if ((size_t)layout.ids[id] >= compiled_ids_.size()) {
+      compiled_ids_.resize(layout.ids[id] + 1, -1);
+    }
+    compiled_ids_[layout.ids[id]] = id;
+  }
+}
+
+int ODriveEmulator::resolve(int64_t serial_number)
+{
+  auto it = board_map_.find(serial_number);
+  if (it == board_map_.end()) {
+    return serial_number || boards_.empty() ? LIBUSB_ERROR_NO_DEVICE : 0;
+  }
+  return it->second;
+}
+
+bool ODriveEmulator::connected(int64_t serial_number) { return board(serial_number); }
+
+uint32_t ODriveEmulator::connections(int64_t serial_number) { return board(serial_number) ? 1 : 0; }
+
+void ODriveEmulator::reset(Board & board)
+{
+  board.sequence_number = 0;
+  board.boot_time = std::chrono::steady_clock::now();
+  board.values.assign(ODRIVE_EMULATOR_ENDPOINT_COUNT, 0);
+
+  store(board, SERIAL_NUMBER, (endpoint_type_t<SERIAL_NUMBER>)board.serial_number);
+  store(board, VBUS_VOLTAGE, 24.0f);
+  for (uint8_t axis = 0; axis < ODRIVE_EMULATOR_AXIS_COUNT; axis++) {
+    store(board, Endpoint<AXIS__CURRENT_STATE>::id(axis), (uint8_t)AXIS_STATE_IDLE);
+    store(board, Endpoint<AXIS__MOTOR__CONFIG__TORQUE_CONSTANT>::id(axis), 8.27f / 270);
+  }
+}
+
+void ODriveEmulator::update(Board & board, std::chrono::steady_clock::time_point now)
+{
+  store(
+    board, SYSTEM_STATS__UPTIME,
+    (endpoint_type_t<SYSTEM_STATS__UPTIME>)std::chrono::duration_cast<std::chrono::milliseconds>(
+      now - board.boot_time)
+      .count());
+}
+
+void ODriveEmulator::written(Board & board, short endpoint_id)
+{
+  short endpoint;
+  uint8_t axis;
+
+  if (endpoint_id == CLEAR_ERRORS) {
+    store(board, ERROR, (endpoint_type_t<ERROR>)0);
+    for (axis = 0; axis < ODRIVE_EMULATOR_AXIS_COUNT; axis++) {
+      store(board, Endpoint<AXIS__ERROR>::id(axis), (endpoint_type_t<AXIS__ERROR>)0);
+      store(board, Endpoint<AXIS__MOTOR__ERROR>::id(axis), (endpoint_type_t<AXIS__MOTOR__ERROR>)0);
+      store(
+        board, Endpoint<AXIS__ENCODER__ERROR>::id(axis), (endpoint_type_t<AXIS__ENCODER__ERROR>)0);
+      store(
+        board, Endpoint<AXIS__CONTROLLER__ERROR>::id(axis),
+        (endpoint_type_t<AXIS__CONTROLLER__ERROR>)0);
+    }
+  } else if (axisEndpoint(endpoint_id, endpoint, axis) && endpoint == AXIS__REQUESTED_STATE) {
+    // The firmware takes over a requested state right away and clears the request
+    store(
+      board, Endpoint<AXIS__CURRENT_STATE>::id(axis),
+      load<endpoint_type_t<AXIS__REQUESTED_STATE>>(board, endpoint_id));
+    store(board, endpoint_id, (endpoint_type_t<AXIS__REQUESTED_STATE>)0);
+  }
+}
+
+ODriveEmulator::Board * ODriveEmulator::board(int64_t serial_number)
+{
+  if (!serial_number) {
+    return boards_.empty() ? NULL : &boards_[0];
+  }
+
+  auto it = board_map_.find(serial_number);
+  return it != board_map_.end() ? &boards_[it->second] : NULL;
+}
+
+bool ODriveEmulator::axisEndpoint(short endpoint_id, short & endpoint, uint8_t & axis)
+{
+  int offset = endpoint_id - first_axis_endpoint;
+  if (offset < 0 || offset >= ODRIVE_EMULATOR_AXIS_COUNT * per_axis_offset) {
+    return false;
+  }
+
+  axis = offset / per_axis_offset;
+  endpoint = endpoint_id - axis * per_axis_offset;
+  return true;
+}
+
+// Runs a transaction through the same packet codec as the USB transport
+int ODriveEmulator::exchange(Board & board, Transaction & transaction)
+{
+  unsigned char request_packet[ODRIVE_MAX_PACKET_SIZE];
+  unsigned char response_packet[ODRIVE_MAX_RESPONSE_PACKET_SIZE];
+
+  short endpoint_id = board.endpoints.id(transaction.endpoint_id);
+  if (endpoint_id < 0) {
+    return LIBUSB_ERROR_NOT_SUPPORTED;
+  }
+  if (transaction.ack) {
+    endpoint_id |= 0x8000;
+  }
+  short sequence_number = ((board.sequence_number + 1) & 0x7fff) | LIBUSB_ENDPOINT_IN;
+
+  int length = transaction.packet
+                 ? encodePacket(
+                     request_packet, sequence_number, endpoint_id, *transaction.packet,
+                     transaction.request, board.endpoints.crc)
+                 : encodePacket(
+                     request_packet, sequence_number, endpoint_id,
+                     transaction.ack ? transaction.response_size : 0, transaction.request,
+                     transaction.request_size, board.endpoints.crc);
+  if (length < 0) {
+    return length;
+  }
+
+  length = serve(board, request_packet, length, response_packet);
+  if (length < 0 || !transaction.ack) {
+    return length < 0 ? length : LIBUSB_SUCCESS;
+  }
+
+  short response_sequence_number = response_packet[0] | (response_packet[1] << 8);
+  if (length < 2 || response_sequence_number != (sequence_number | (short)0x8000)) {
+    return LIBUSB_ERROR_IO;
+  }
+  length = decodePacket(response_packet, length, transaction.response, transaction.response_size);
+  if (transaction.endpoint_id == 0) {
+    transaction.response_size = length;
+  }
+
+  return length == transaction.response_size ? LIBUSB_SUCCESS : LIBUSB_ERROR_IO;
+}
+
+// The board side: applies the request to the value store and builds the response, if one was
+// asked for. Returns the response length.
+int ODriveEmulator::serve(
+  Board & board, const unsigned char * request_packet, int length,
+  unsigned char * response_packet)
+{
+  Request request;
+  int ret = decodeRequest(request_packet, length, request, descriptor_crc_);
+  if (ret != LIBUSB_SUCCESS) {
+    return ret;
+  }
+  board.sequence_number = request.sequence_number;
+
+  short endpoint_id = request.endpoint_id & 0x7fff;
+  if (endpoint_id == 0) {
+    return serveDescriptor(request, response_packet);
+  }
+  if (!compiled_ids_.empty()) {
+    endpoint_id = (size_t)endpoint_id < compiled_ids_.size() ? compiled_ids_[endpoint_id] : -1;
+  }
+  if (
+    endpoint_id < 0 || endpoint_id >= ODRIVE_EMULATOR_ENDPOINT_COUNT || request.payload_size > 8 ||
+    request.response_size > 8) {
+    return LIBUSB_ERROR_IO;
+  }
+
+  if (request.payload_size) {
+    std::memcpy(&board.values[endpoint_id], request.payload, request.payload_size);
+    written(board, endpoint_id);
+  } else if (!request.response_size) {
+    written(board, endpoint_id);
+  }
+
+  if (!(request.endpoint_id & 0x8000)) {
+    return 0;
+  }
+  return encodeResponse(
+    response_packet, request.sequence_number, &board.values[endpoint_id], request.response_size);
+}
+
+// Endpoint 0 answers with the part of the descriptor at the requested offset, or with the
+// descriptor's version id, the CRC over it in the upper half like Fibre computes it
+int ODriveEmulator::serveDescriptor(const Request & request, unsigned char * response_packet)
+{
+  uint32_t offset;
+  if (request.payload_size != sizeof(offset)) {
+    return LIBUSB_ERROR_IO;
+  }
+  std::memcpy(&offset, request.payload, sizeof(offset));
+
+  if (!(request.endpoint_id & 0x8000)) {
+    return 0;
+  }
+  if (offset == ODRIVE_DESCRIPTOR_VERSION_OFFSET) {
+    uint32_t version = (uint32_t)descriptor_crc_ << 16 |
+                       descriptorCrc(descriptor_.data(), descriptor_.size(), 0);
+    return encodeResponse(
+      response_packet, request.sequence_number, &version,
+      std::min<short>(sizeof(version), request.response_size));
+  }
+  size_t start = std::min<size_t>(offset, descriptor_.size());
+  size_t size = std::min<size_t>(descriptor_.size() - start, request.response_size);
+  size = std::min<size_t>(size, ODRIVE_DESCRIPTOR_CHUNK_SIZE);
+  return encodeResponse(
+    response_packet, request.sequence_number, descriptor_.data() + start, size);
+}
+
+std::chrono::nanoseconds ODriveEmulator::sampleLatency()
+{
+  if (jitter_.count() <= 0) {
+    return latency_;
+  }
+
+  std::uniform_int_distribution<int64_t> jitter(-jitter_.count(), jitter_.count());
+  return std::max(
+    std::chrono::nanoseconds(0), latency_ + std::chrono::nanoseconds(jitter(random_)));
+}
+}  // namespace odrive
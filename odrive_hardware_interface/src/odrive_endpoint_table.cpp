@@ -0,0 +1,253 @@
+// Copyright 2021 Factor Robotics
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "odrive_hardware_interface/odrive_endpoint_table.hpp"
+
+#include <cctype>
+#include <cstdlib>
+#include <map>
+#include <utility>
+
+#include "odrive_hardware_interface/odrive_endpoint_names.hpp"
+#include "odrive_hardware_interface/odrive_protocol.hpp"
+
+namespace odrive
+{
+namespace
+{
+// Just enough JSON to flatten a Fibre descriptor into dotted paths. Members are objects with a
+// name, a type and either an id or, for type "object", nested members.
+class DescriptorParser
+{
+public:
+  DescriptorParser(
+    const std::string & json, std::map<std::string, std::pair<short, std::string>> & endpoints)
+  : json_(json), endpoints_(endpoints), position_(0)
+  {
+  }
+
+  bool parse()
+  {
+    if (!parseMembers("")) {
+      return false;
+    }
+    skipSpace();
+    return position_ == json_.size();
+  }
+
+private:
+  const std::string & json_;
+  std::map<std::string, std::pair<short, std::string>> & endpoints_;
+  size_t position_;
+
+  void skipSpace()
+  {
+    while (position_ < json_.size() && std::isspace((unsigned char)json_[position_])) {
+      position_++;
+    }
+  }
+
+  bool consume(char c)
+  {
+    skipSpace();
+    if (position_ < json_.size() && json_[position_] == c) {
+      position_++;
+      return true;
+    }
+    return false;
+  }
+
+  bool parseMembers(const std::string & prefix)
+  {
+    if (!consume('[')) {
+      return false;
+    }
+    if (consume(']')) {
+      return true;
+    }
+    do {
+      if (!parseMember(prefix)) {
+        return false;
+      }
+    } while (consume(','));
+    return consume(']');
+  }
+
+  bool parseMember(const std::string & prefix)
+  {
+    std::string name;
+    std::string type;
+    long id = -1;
+    size_t members = std::string::npos;
+
+    if (!consume('{')) {
+      return false;
+    }
+    if (!consume('}')) {
+      do {
+        std::string key;
+        if (!parseString(key) || !consume(':')) {
+          return false;
+        }
+        bool ok;
+        if (key == "name") {
+          ok = parseString(name);
+        } else if (key == "type") {
+          ok = parseString(type);
+        } else if (key == "id") {
+          skipSpace();
+          ok = parseNumber(id);
+        } else {
+          if (key == "members") {
+            skipSpace();
+            members = position_;
+          }
+          ok = skipValue();
+        }
+        if (!ok) {
+          return false;
+        }
+      } while (consume(','));
+      if (!consume('}')) {
+        return false;
+      }
+    }
+
+    std::string path = prefix.empty() ? name : prefix + "." + name;
+    if (type == "object" && members != std::string::npos) {
+      // The name may come after the members, so they are parsed again once it is known
+      size_t end = position_;
+      position_ = members;
+      bool ok = parseMembers(path);
+      position_ = end;
+      return ok;
+    }
+    if (id > 0 && id < 0x8000) {
+      endpoints_[path] = std::make_pair((short)id, type);
+    }
+    return true;
+  }
+
+  bool parseString(std::string & value)
+  {
+    if (!consume('"')) {
+      return false;
+    }
+    value.clear();
+    while (position_ < json_.size() && json_[position_] != '"') {
+      if (json_[position_] == '\\') {
+        position_++;
+      }
+      if (position_ < json_.size()) {
+        value += json_[position_++];
+      }
+    }
+    return consume('"');
+  }
+
+  bool parseNumber(long & value)
+  {
+    const char * start = json_.c_str() + position_;
+    char * end;
+    value = std::strtol(start, &end, 10);
+    position_ += end - start;
+    return end != start;
+  }
+
+  bool skipValue()
+  {
+    skipSpace();
+    if (position_ >= json_.size()) {
+      return false;
+    }
+
+    char c = json_[position_];
+    if (c == '"') {
+      std::string value;
+      return parseString(value);
+    }
+    if (c == '[' || c == '{') {
+      char close = c == '[' ? ']' : '}';
+      position_++;
+      if (consume(close)) {
+        return true;
+      }
+      do {
+        if (c == '{') {
+          std::string key;
+          if (!parseString(key) || !consume(':')) {
+            return false;
+          }
+        }
+        if (!skipValue()) {
+          return false;
+        }
+      } while (consume(','));
+      return consume(close);
+    }
+
+    // Numbers, true, false and null
+    size_t start = position_;
+    while (position_ < json_.size() && json_[position_] != ',' && json_[position_] != ']' &&
+           json_[position_] != '}' && !std::isspace((unsigned char)json_[position_])) {
+      position_++;
+    }
+    return position_ != start;
+  }
+};
+}  // namespace
+
+int parseDescriptor(const std::string & descriptor, EndpointTable & table)
+{
+  table.crc = descriptorCrc(descriptor.data(), descriptor.size());
+  table.ids.clear();
+
+  std::map<std::string, std::pair<short, std::string>> endpoints;
+  DescriptorParser parser(descriptor, endpoints);
+  if (!parser.parse()) {
+    return -1;
+  }
+
+  int missing = 0;
+  table.ids.assign(first_axis_endpoint + ODRIVE_AXIS_COUNT * per_axis_offset, -1);
+  for (const EndpointName & name : endpoint_names) {
+    bool per_axis =
+      name.id >= first_axis_endpoint && name.id < first_axis_endpoint + per_axis_offset;
+    for (int axis = 0; axis < (per_axis ? ODRIVE_AXIS_COUNT : 1); axis++) {
+      std::string path = name.path;
+      if (per_axis) {
+        path.replace(4, 1, std::to_string(axis));
+      }
+      short id = name.id + axis * per_axis_offset;
+      if ((size_t)id >= table.ids.size()) {
+        table.ids.resize(id + 1, -1);
+      }
+
+      auto it = endpoints.find(path);
+      if (it != endpoints.end() && it->second.second == name.type) {
+        table.ids[id] = it->second.first;
+      } else {
+        missing++;
+      }
+    }
+  }
+
+  // The build odrive_endpoints.hpp was generated for needs no translation
+  if (table.crc == json_crc) {
+    table.ids.clear();
+  }
+
+  return missing;
+}
+}  // namespace odrive
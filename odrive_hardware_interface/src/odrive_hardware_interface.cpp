@@ -14,10 +14,101 @@
 
 #include "odrive_hardware_interface/odrive_hardware_interface.hpp"
 
+#include <sys/stat.h>
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+
 #include "pluginlib/class_list_macros.hpp"
 
 namespace odrive_hardware_interface
 {
+// Caches and registries live in $ROS_HOME, or else ~/.ros, unless a parameter says otherwise
+static std::string defaultCachePath(const std::string & name)
+{
+  if (std::getenv("ROS_HOME")) {
+    return std::string(std::getenv("ROS_HOME")) + "/" + name;
+  } else if (std::getenv("HOME")) {
+    return std::string(std::getenv("HOME")) + "/.ros/" + name;
+  }
+  return "";
+}
+
+static bool makeDirectories(const std::string & path)
+{
+  for (size_t i = 1; i <= path.size(); i++) {
+    if (i == path.size() || path[i] == '/') {
+      if (mkdir(path.substr(0, i).c_str(), 0755) && errno != EEXIST) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Writes to a temporary file that is renamed over path, so readers never see a partial file
+static bool writeFileAtomically(const std::string & path, const std::string & contents)
+{
+  std::string temporary = path + ".tmp";
+  bool stored = false;
+  size_t directory = path.rfind('/');
+  if (directory == std::string::npos || makeDirectories(path.substr(0, directory))) {
+    std::ofstream file(temporary, std::ios::binary);
+    file.write(contents.data(), contents.size());
+    file.close();
+    stored = file && !std::rename(temporary.c_str(), path.c_str());
+  }
+  if (!stored) {
+    RCLCPP_WARN(
+      rclcpp::get_logger("ODriveHardwareInterface"), "Failed to write %s", path.c_str());
+    std::remove(temporary.c_str());
+  }
+  return stored;
+}
+
+// Every line of the registry is a serial number in hex and the port it was last found at. Lines
+// that do not parse are skipped, so a corrupt registry only costs a full enumeration.
+static std::map<int64_t, std::string> readDeviceRegistry(const std::string & path)
+{
+  std::map<int64_t, std::string> known_ports;
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    std::string serial_number, port_path;
+    if (!(fields >> serial_number >> port_path)) {
+      continue;
+    }
+    try {
+      known_ports[std::stoull(serial_number, 0, 16)] = port_path;
+    } catch (const std::logic_error &) {
+      continue;
+    }
+  }
+  return known_ports;
+}
+
+ODriveHardwareInterface::ODriveHardwareInterface() : odrive(NULL), can_(NULL), usb_(NULL) {}
+
+ODriveHardwareInterface::ODriveHardwareInterface(ODriveTransport * transport)
+: odrive(transport), can_(NULL), usb_(NULL)
+{
+}
+
+// The I/O thread is the last user of the transport
+ODriveHardwareInterface::~ODriveHardwareInterface()
+{
+  stopIoThread();
+  owned_transport_.reset();
+}
+
 CallbackReturn ODriveHardwareInterface::on_init(const hardware_interface::HardwareInfo & info)
 {
   if (hardware_interface::SystemInterface::on_init(info) != CallbackReturn::SUCCESS) {
@@ -27,6 +118,9 @@ CallbackReturn ODriveHardwareInterface::on_init(const hardware_interface::Hardwa
   serial_numbers_.resize(2);
 
   hw_vbus_voltages_.resize(info_.sensors.size(), std::numeric_limits<double>::quiet_NaN());
+  hw_deadline_misses_.resize(info_.sensors.size(), 0);
+  hw_stalenesses_.resize(POLL_TIERS * info_.sensors.size(), 0);
+  hw_bus_utilizations_.resize(info_.sensors.size(), std::numeric_limits<double>::quiet_NaN());
 
   hw_positions_.resize(info_.joints.size(), std::numeric_limits<double>::quiet_NaN());
   hw_velocities_.resize(info_.joints.size(), std::numeric_limits<double>::quiet_NaN());
@@ -42,48 +136,702 @@ CallbackReturn ODriveHardwareInterface::on_init(const hardware_interface::Hardwa
   hw_fet_temperatures_.resize(info_.joints.size(), std::numeric_limits<double>::quiet_NaN());
   hw_motor_temperatures_.resize(info_.joints.size(), std::numeric_limits<double>::quiet_NaN());
 
+  // A component bound by usb_port alone gets the serial number of the board found there
+  auto parse_serial_number = [](const hardware_interface::ComponentInfo & component) {
+    return component.parameters.count("serial_number")
+             ? std::stoull(component.parameters.at("serial_number"), 0, 16)
+             : 0;
+  };
+
   for (const hardware_interface::ComponentInfo & sensor : info_.sensors) {
-    serial_numbers_[0].emplace_back(std::stoull(sensor.parameters.at("serial_number"), 0, 16));
+    serial_numbers_[0].emplace_back(parse_serial_number(sensor));
   }
 
   for (const hardware_interface::ComponentInfo & joint : info_.joints) {
-    serial_numbers_[1].emplace_back(std::stoull(joint.parameters.at("serial_number"), 0, 16));
+    serial_numbers_[1].emplace_back(parse_serial_number(joint));
     axes_.emplace_back(std::stoi(joint.parameters.at("axis")));
-    enable_watchdogs_.emplace_back(std::stoi(joint.parameters.at("enable_watchdog")));
+    AxisConfig config;
+    config.enable_watchdog = std::stoi(joint.parameters.at("enable_watchdog"));
+    for (int field = 0; field < AXIS_CONFIG_FIELDS; field++) {
+      const AxisConfigEndpoint & endpoint = axis_config_endpoints[field];
+      if (joint.parameters.count(endpoint.name)) {
+        config.values[field].value = std::stof(joint.parameters.at(endpoint.name));
+        config.values[field].flag = config.values[field].value;
+      }
+    }
+    if (!config.enable_watchdog) {
+      config.values[CONFIG_WATCHDOG_TIMEOUT] = ConfigValue();
+    }
+    axis_configs_.emplace_back(config);
   }
 
-  odrive = new ODriveUSB();
-  CHECK_TS(odrive->init(serial_numbers_));
+  size_t pipeline_depth = ODRIVE_DEFAULT_PIPELINE_DEPTH;
+  if (info_.hardware_parameters.count("pipeline_depth")) {
+    pipeline_depth = std::stoul(info_.hardware_parameters.at("pipeline_depth"));
+  }
 
-  for (size_t i = 0; i < info_.joints.size(); i++) {
-    float torque_constant;
-    CHECK_TS(odrive->read(
-      serial_numbers_[1][i], AXIS__MOTOR__CONFIG__TORQUE_CONSTANT + per_axis_offset * axes_[i],
-      torque_constant));
-    torque_constants_.emplace_back(torque_constant);
+  unsigned int transaction_timeout = ODRIVE_DEFAULT_TRANSACTION_TIMEOUT;
+  if (info_.hardware_parameters.count("transaction_timeout")) {
+    transaction_timeout =
+      std::ceil(std::stod(info_.hardware_parameters.at("transaction_timeout")) * 1e3);
+  }
 
-    if (enable_watchdogs_[i]) {
-      CHECK_TS(odrive->write(
-        serial_numbers_[1][i], AXIS__CONFIG__WATCHDOG_TIMEOUT + per_axis_offset * axes_[i],
-        std::stof(info_.joints[i].parameters.at("watchdog_timeout"))));
+  deadline_ratio_ = 0.4;
+  if (info_.hardware_parameters.count("deadline_ratio")) {
+    deadline_ratio_ = std::stod(info_.hardware_parameters.at("deadline_ratio"));
+  }
+
+  cycle_transaction_budget_ = 0;
+  cycle_time_budget_ = 0;
+  if (info_.hardware_parameters.count("cycle_transaction_budget")) {
+    cycle_transaction_budget_ =
+      std::stoul(info_.hardware_parameters.at("cycle_transaction_budget"));
+  }
+  if (info_.hardware_parameters.count("cycle_time_budget")) {
+    cycle_time_budget_ = std::stod(info_.hardware_parameters.at("cycle_time_budget"));
+  }
+  transaction_cost_ = 0;
+  written_transactions_ = 0;
+
+  acknowledge_setpoints_ = true;
+  setpoint_verify_period_ = 100;
+  setpoint_cycles_ = 0;
+  if (info_.hardware_parameters.count("acknowledge_setpoints")) {
+    acknowledge_setpoints_ = std::stoi(info_.hardware_parameters.at("acknowledge_setpoints"));
+  }
+  if (info_.hardware_parameters.count("setpoint_verify_period")) {
+    setpoint_verify_period_ = std::stoul(info_.hardware_parameters.at("setpoint_verify_period"));
+  }
+
+  setpoint_refresh_period_ = 100;
+  if (info_.hardware_parameters.count("setpoint_refresh_period")) {
+    setpoint_refresh_period_ = std::stoul(info_.hardware_parameters.at("setpoint_refresh_period"));
+  }
+  // Deadbands are given in joint units and compared in turns like the inputs
+  for (const hardware_interface::ComponentInfo & joint : info_.joints) {
+    double scales[3] = {2 * M_PI, 2 * M_PI, 1};
+    const char * names[3] = {"input_pos_deadband", "input_vel_deadband", "input_torque_deadband"};
+    for (int j = 0; j < 3; j++) {
+      setpoint_deadbands_.emplace_back(
+        joint.parameters.count(names[j]) ? std::stod(joint.parameters.at(names[j])) / scales[j]
+                                         : 0);
+    }
+  }
+
+  load_endpoint_tables_ = true;
+  descriptor_cache_ = defaultCachePath("odrive_descriptors");
+  if (info_.hardware_parameters.count("verify_descriptor")) {
+    load_endpoint_tables_ = std::stoi(info_.hardware_parameters.at("verify_descriptor"));
+  }
+  if (info_.hardware_parameters.count("descriptor_cache")) {
+    descriptor_cache_ = info_.hardware_parameters.at("descriptor_cache");
+  }
+
+  config_cache_ = defaultCachePath("odrive_configs");
+  if (info_.hardware_parameters.count("config_cache")) {
+    config_cache_ = info_.hardware_parameters.at("config_cache");
+  }
+
+  device_registry_ = defaultCachePath("odrive_devices");
+  if (info_.hardware_parameters.count("device_registry")) {
+    device_registry_ = info_.hardware_parameters.at("device_registry");
+  }
+
+  io_thread_enabled_ = false;
+  io_thread_period_ = std::chrono::milliseconds(1);
+  io_thread_priority_ = 0;
+  io_thread_cpu_ = -1;
+  if (info_.hardware_parameters.count("io_thread")) {
+    io_thread_enabled_ = std::stoi(info_.hardware_parameters.at("io_thread"));
+  }
+  if (info_.hardware_parameters.count("io_thread_period")) {
+    io_thread_period_ = std::chrono::nanoseconds(
+      (int64_t)(std::stod(info_.hardware_parameters.at("io_thread_period")) * 1e9));
+  }
+  if (info_.hardware_parameters.count("io_thread_priority")) {
+    io_thread_priority_ = std::stoi(info_.hardware_parameters.at("io_thread_priority"));
+  }
+  if (info_.hardware_parameters.count("io_thread_cpu")) {
+    io_thread_cpu_ = std::stoi(info_.hardware_parameters.at("io_thread_cpu"));
+  }
+
+  if (!odrive) {
+    owned_transport_.reset(createTransport());
+    odrive = owned_transport_.get();
+    if (!odrive) {
+      return CallbackReturn::ERROR;
+    }
+  }
+  CHECK_TS(odrive->init(serial_numbers_, pipeline_depth, transaction_timeout));
+  if (usb_) {
+    if (!bindUsbPorts()) {
+      return CallbackReturn::ERROR;
+    }
+    storeDeviceRegistry();
+  }
+
+  if (load_endpoint_tables_ && odrive->fullAccess()) {
+    std::vector<int64_t> loaded;
+    for (const std::vector<int64_t> & group : serial_numbers_) {
+      for (int64_t serial_number : group) {
+        if (std::find(loaded.begin(), loaded.end(), serial_number) == loaded.end()) {
+          CHECK_TS(loadEndpointTable(serial_number));
+          loaded.emplace_back(serial_number);
+        }
+      }
     }
-    CHECK_TS(odrive->write(
-      serial_numbers_[1][i], AXIS__CONFIG__ENABLE_WATCHDOG + per_axis_offset * axes_[i],
-      (bool)enable_watchdogs_[i]));
   }
 
   control_level_.resize(info_.joints.size(), integration_level_t::UNDEFINED);
+
+  auto board = [this](int64_t serial_number) -> Board & {
+    for (Board & board : boards_) {
+      if (board.serial_number == serial_number) {
+        return board;
+      }
+    }
+    boards_.emplace_back(Board{serial_number, {}, {}});
+    return boards_.back();
+  };
+  for (size_t i = 0; i < info_.sensors.size(); i++) {
+    board(serial_numbers_[0][i]).sensors.emplace_back(i);
+  }
+  for (size_t i = 0; i < info_.joints.size(); i++) {
+    board(serial_numbers_[1][i]).joints.emplace_back(i);
+  }
+
+  feedback_.vbus_voltages.resize(info_.sensors.size());
+  feedback_.axes.resize(info_.joints.size());
+  feedback_.deadline_misses.resize(boards_.size(), 0);
+  feedback_.stalenesses.resize(POLL_TIERS * boards_.size(), 0);
+  feedback_.uptimes.resize(boards_.size(), 0);
+  feedback_.available.resize(boards_.size(), true);
+  feedback_.status = LIBUSB_SUCCESS;
+  command_.axes.resize(info_.joints.size());
+  for (AxisSetpoint & setpoint : command_.axes) {
+    setpoint.requested_state = AXIS_STATE_IDLE;
+  }
+  command_.mode_switches = 0;
+
+  for (size_t i = 0; i < boards_.size(); i++) {
+    board_connections_.emplace_back(odrive->connections(boards_[i].serial_number));
+    board_available_.emplace_back(true);
+  }
+  board_uptimes_.resize(boards_.size(), 0);
+
+  compilePlan(feedback_, command_);
+
+  CHECK_TS(pushConfiguration());
+
+  return CallbackReturn::SUCCESS;
+}
+
+bool ODriveHardwareInterface::planCanBus(ODriveCAN & can)
+{
+  uint32_t baud_rate = 1000000;
+  double max_utilization = 0.8;
+  double poll_period = 0;
+  if (info_.hardware_parameters.count("can_baud_rate")) {
+    baud_rate = std::stoul(info_.hardware_parameters.at("can_baud_rate"));
+  }
+  double update_period = 0.01;
+  if (io_thread_enabled_) {
+    update_period = std::chrono::duration<double>(io_thread_period_).count();
+  } else if (info_.hardware_parameters.count("can_update_rate")) {
+    update_period = 1 / std::stod(info_.hardware_parameters.at("can_update_rate"));
+  }
+  if (info_.hardware_parameters.count("can_max_utilization")) {
+    max_utilization = std::stod(info_.hardware_parameters.at("can_max_utilization"));
+  }
+  if (info_.hardware_parameters.count("can_poll_period")) {
+    poll_period = std::stod(info_.hardware_parameters.at("can_poll_period"));
+  }
+
+  std::vector<CanAxisTraffic> axes;
+  for (size_t i = 0; i < info_.joints.size(); i++) {
+    const auto & parameters = info_.joints[i].parameters;
+    CanAxisTraffic axis = {};
+    axis.node_id = std::stoi(parameters.at("node_id"));
+    axis.encoder_period = 0.01;
+    axis.heartbeat_period = 0.1;
+    if (parameters.count("can_encoder_rate_ms")) {
+      axis.encoder_period = std::stod(parameters.at("can_encoder_rate_ms")) * 1e-3;
+    }
+    if (parameters.count("can_heartbeat_rate_ms")) {
+      axis.heartbeat_period = std::stod(parameters.at("can_heartbeat_rate_ms")) * 1e-3;
+    }
+
+    // Bus voltage goes through the lowest axis of a board with a sensor
+    bool first = true;
+    for (size_t j = 0; j < info_.joints.size(); j++) {
+      first &= serial_numbers_[1][j] != serial_numbers_[1][i] || axes_[j] >= axes_[i];
+    }
+    axis.polls_vbus =
+      first && std::find(serial_numbers_[0].begin(), serial_numbers_[0].end(),
+                         serial_numbers_[1][i]) != serial_numbers_[0].end();
+    axes.emplace_back(axis);
+  }
+
+  CanPlan plan = planCanTraffic(axes, baud_rate, update_period, max_utilization, poll_period);
+  if (!plan.feasible) {
+    RCLCPP_ERROR(
+      rclcpp::get_logger("ODriveHardwareInterface"),
+      "CAN bus cannot carry %zu axes at %u bit/s: worst-case utilization %.0f%% (limit %.0f%%), "
+      "setpoint latency %.3f ms, encoder latency %.3f ms",
+      axes.size(), baud_rate, plan.utilization * 100, max_utilization * 100,
+      plan.setpoint_latency * 1e3, plan.telemetry_latency * 1e3);
+    return false;
+  }
+  RCLCPP_INFO(
+    rclcpp::get_logger("ODriveHardwareInterface"),
+    "CAN bus worst-case utilization %.0f%%, setpoint latency %.3f ms, encoder latency %.3f ms, "
+    "polling every %.3f ms",
+    plan.utilization * 100, plan.setpoint_latency * 1e3, plan.telemetry_latency * 1e3,
+    plan.poll_period * 1e3);
+
+  can.schedule(baud_rate, std::chrono::nanoseconds((int64_t)(plan.poll_period * 1e9)));
+  return true;
+}
+
+ODriveTransport * ODriveHardwareInterface::createTransport()
+{
+  std::string transport = "usb";
+  if (info_.hardware_parameters.count("transport")) {
+    transport = info_.hardware_parameters.at("transport");
+  }
+  if (transport == "usb") {
+    // Boards given a usb_port with any of their joints or sensors are looked for only there
+    std::vector<std::string> port_paths;
+    for (const std::vector<hardware_interface::ComponentInfo> * components :
+         {&info_.sensors, &info_.joints}) {
+      for (const hardware_interface::ComponentInfo & component : *components) {
+        if (!component.parameters.count("usb_port")) {
+          continue;
+        }
+        const std::string & path = component.parameters.at("usb_port");
+        if (std::find(port_paths.begin(), port_paths.end(), path) == port_paths.end()) {
+          port_paths.emplace_back(path);
+        }
+      }
+    }
+
+    std::map<int64_t, std::string> known_ports;
+    if (!device_registry_.empty()) {
+      known_ports = readDeviceRegistry(device_registry_);
+    }
+
+    ODriveUSB * usb = new ODriveUSB();
+    usb->setPortPaths(port_paths);
+    usb->setKnownPorts(known_ports);
+    usb_ = usb;
+    return usb;
+  } else if (transport == "can") {
+    std::string interface = "can0";
+    double heartbeat_timeout = ODRIVE_CAN_DEFAULT_HEARTBEAT_TIMEOUT * 1e-3;
+    if (info_.hardware_parameters.count("can_interface")) {
+      interface = info_.hardware_parameters.at("can_interface");
+    }
+    if (info_.hardware_parameters.count("can_heartbeat_timeout")) {
+      heartbeat_timeout = std::stod(info_.hardware_parameters.at("can_heartbeat_timeout"));
+    }
+
+    ODriveCAN * can = new ODriveCAN(
+      interface, std::chrono::milliseconds((int64_t)std::ceil(heartbeat_timeout * 1e3)));
+    for (size_t i = 0; i < info_.joints.size(); i++) {
+      int node_id = std::stoi(info_.joints[i].parameters.at("node_id"));
+      if (node_id < 0 || can->addNode(serial_numbers_[1][i], axes_[i], node_id) != LIBUSB_SUCCESS) {
+        RCLCPP_ERROR(
+          rclcpp::get_logger("ODriveHardwareInterface"), "Invalid node id %d of joint %s", node_id,
+          info_.joints[i].name.c_str());
+        delete can;
+        return NULL;
+      }
+    }
+
+    if (!planCanBus(*can)) {
+      delete can;
+      return NULL;
+    }
+    can_ = can;
+    return can;
+  } else if (transport == "serial") {
+    unsigned int baud_rate = ODRIVE_SERIAL_DEFAULT_BAUD_RATE;
+    if (info_.hardware_parameters.count("serial_baud_rate")) {
+      baud_rate = std::stoul(info_.hardware_parameters.at("serial_baud_rate"));
+    }
+
+    // Every board needs its port, given with any of its joints or sensors
+    std::vector<std::string> paths;
+    for (const std::vector<hardware_interface::ComponentInfo> * components :
+         {&info_.sensors, &info_.joints}) {
+      for (const hardware_interface::ComponentInfo & component : *components) {
+        if (!component.parameters.count("serial_port")) {
+          continue;
+        }
+        const std::string & path = component.parameters.at("serial_port");
+        if (std::find(paths.begin(), paths.end(), path) == paths.end()) {
+          paths.emplace_back(path);
+        }
+      }
+    }
+    if (paths.empty()) {
+      RCLCPP_ERROR(
+        rclcpp::get_logger("ODriveHardwareInterface"),
+        "The serial transport needs the serial_port of every ODrive");
+      return NULL;
+    }
+
+    ODriveSerial * serial = new ODriveSerial(baud_rate);
+    for (const std::string & path : paths) {
+      serial->addPort(path);
+    }
+    return serial;
+  } else if (transport == "emulator" || transport == "simulator") {
+    double latency = 0;
+    double jitter = 0;
+    if (info_.hardware_parameters.count("emulator_latency")) {
+      latency = std::stod(info_.hardware_parameters.at("emulator_latency"));
+    }
+    if (info_.hardware_parameters.count("emulator_jitter")) {
+      jitter = std::stod(info_.hardware_parameters.at("emulator_jitter"));
+    }
+
+    if (transport == "emulator") {
+      return new ODriveEmulator(
+        std::chrono::nanoseconds((int64_t)(latency * 1e9)),
+        std::chrono::nanoseconds((int64_t)(jitter * 1e9)));
+    } else {
+      AxisDynamics dynamics = {1e-4, 1e-4, 1e-3};
+      if (info_.hardware_parameters.count("simulator_inertia")) {
+        dynamics.inertia = std::stod(info_.hardware_parameters.at("simulator_inertia"));
+      }
+      if (info_.hardware_parameters.count("simulator_viscous_friction")) {
+        dynamics.viscous_friction =
+          std::stod(info_.hardware_parameters.at("simulator_viscous_friction"));
+      }
+      if (info_.hardware_parameters.count("simulator_coulomb_friction")) {
+        dynamics.coulomb_friction =
+          std::stod(info_.hardware_parameters.at("simulator_coulomb_friction"));
+      }
+      return new ODriveSimulator(
+        dynamics, std::chrono::nanoseconds((int64_t)(latency * 1e9)),
+        std::chrono::nanoseconds((int64_t)(jitter * 1e9)));
+    }
+  } else {
+    RCLCPP_ERROR(
+      rclcpp::get_logger("ODriveHardwareInterface"), "Unknown transport %s", transport.c_str());
+    return NULL;
+  }
+}
+
+bool ODriveHardwareInterface::bindUsbPorts()
+{
+  for (size_t group = 0; group < serial_numbers_.size(); group++) {
+    const std::vector<hardware_interface::ComponentInfo> & components =
+      group ? info_.joints : info_.sensors;
+    for (size_t i = 0; i < components.size(); i++) {
+      if (!serial_numbers_[group][i] && components[i].parameters.count("usb_port")) {
+        const std::string & port_path = components[i].parameters.at("usb_port");
+        serial_numbers_[group][i] = usb_->serialNumber(port_path);
+        if (!serial_numbers_[group][i]) {
+          RCLCPP_ERROR(
+            rclcpp::get_logger("ODriveHardwareInterface"), "No ODrive at USB port %s of %s",
+            port_path.c_str(), components[i].name.c_str());
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+// Entries of boards this system did not use are kept, so several systems on one host share the
+// registry
+void ODriveHardwareInterface::storeDeviceRegistry()
+{
+  if (device_registry_.empty()) {
+    return;
+  }
+
+  std::map<int64_t, std::string> known_ports = readDeviceRegistry(device_registry_);
+  bool changed = false;
+  for (const std::vector<int64_t> & group : serial_numbers_) {
+    for (int64_t serial_number : group) {
+      std::string port_path = usb_->portPath(serial_number);
+      if (serial_number && !port_path.empty() && known_ports[serial_number] != port_path) {
+        known_ports[serial_number] = port_path;
+        changed = true;
+      }
+    }
+  }
+  if (!changed) {
+    return;
+  }
+
+  std::ostringstream file;
+  for (auto it = known_ports.begin(); it != known_ports.end(); it++) {
+    file << std::hex << it->first << std::dec << " " << it->second << "\n";
+  }
+  writeFileAtomically(device_registry_, file.str());
+}
+
+// Endpoint 0 does not depend on json_crc, so the version id of a board's descriptor tells without
+// a single CRC-bearing request whether it runs the firmware odrive_endpoints.hpp was generated
+// for. Other boards get an endpoint table parsed from their descriptor, resolved here once so the
+// cyclic path keeps using integer ids. Descriptors are cached by version id, and a cached one is
+// only used if its CRC still matches the upper half.
+int ODriveHardwareInterface::loadEndpointTable(int64_t serial_number)
+{
+  uint32_t version = 0;
+  int ret = odrive->readDescriptorVersion(serial_number, version);
+  if (ret != LIBUSB_SUCCESS) {
+    return ret;
+  }
+  if (version >> 16 == json_crc) {
+    return LIBUSB_SUCCESS;
+  }
+
+  std::string descriptor;
+  std::string path;
+  if (version && !descriptor_cache_.empty()) {
+    std::ostringstream name;
+    name << descriptor_cache_ << "/" << std::hex << std::setfill('0') << std::setw(8) << version
+         << ".json";
+    path = name.str();
+
+    std::ifstream file(path, std::ios::binary);
+    descriptor.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    if (
+      !descriptor.empty() &&
+      descriptorCrc(descriptor.data(), descriptor.size()) == version >> 16) {
+      path.clear();
+    } else {
+      descriptor.clear();
+    }
+  }
+  if (descriptor.empty()) {
+    ret = odrive->readDescriptor(serial_number, descriptor);
+    if (ret != LIBUSB_SUCCESS) {
+      return ret;
+    }
+  }
+
+  EndpointTable table;
+  int missing = parseDescriptor(descriptor, table);
+  if (missing < 0) {
+    RCLCPP_ERROR(
+      rclcpp::get_logger("ODriveHardwareInterface"), "ODrive %llx has a malformed descriptor",
+      (unsigned long long)serial_number);
+    return LIBUSB_ERROR_NOT_SUPPORTED;
+  }
+  // Firmware that does not report a version id may still match
+  if (table.crc == json_crc) {
+    return LIBUSB_SUCCESS;
+  }
+  odrive->setEndpointTable(serial_number, table);
+
+  endpoint_type_t<FW_VERSION_MAJOR> major = 0;
+  endpoint_type_t<FW_VERSION_MINOR> minor = 0;
+  endpoint_type_t<FW_VERSION_REVISION> revision = 0;
+  endpoint_type_t<FW_VERSION_UNRELEASED> unreleased = 0;
+  std::vector<Transaction> transactions = {
+    Transaction::read<FW_VERSION_MAJOR>(serial_number, major),
+    Transaction::read<FW_VERSION_MINOR>(serial_number, minor),
+    Transaction::read<FW_VERSION_REVISION>(serial_number, revision),
+    Transaction::read<FW_VERSION_UNRELEASED>(serial_number, unreleased)};
+  ret = odrive->transfer(transactions);
+  if (ret != LIBUSB_SUCCESS) {
+    RCLCPP_ERROR(
+      rclcpp::get_logger("ODriveHardwareInterface"),
+      "ODrive %llx does not answer with the endpoint table from its descriptor (CRC 0x%04x)",
+      (unsigned long long)serial_number, table.crc);
+    return ret;
+  }
+  RCLCPP_INFO(
+    rclcpp::get_logger("ODriveHardwareInterface"),
+    "ODrive %llx runs firmware %d.%d.%d%s with descriptor CRC 0x%04x, %d endpoints missing",
+    (unsigned long long)serial_number, (int)major, (int)minor, (int)revision,
+    unreleased ? "-dev" : "", table.crc, missing);
+
+  if (!path.empty()) {
+    writeFileAtomically(path, descriptor);
+  }
+
+  return LIBUSB_SUCCESS;
+}
+
+// Reads what the boards hold in one batch, skipping settings the cache still knows, and writes
+// only the configured settings that differ. Without full access nothing but the torque constant
+// can be read, and the configuration has to be stored on the board beforehand.
+int ODriveHardwareInterface::pushConfiguration()
+{
+  std::vector<AxisConfig> current(info_.joints.size());
+  bool cached = odrive->fullAccess() && !config_cache_.empty();
+
+  std::vector<uint32_t> uptimes(boards_.size(), 0);
+  int64_t now = 0;
+  if (cached) {
+    transactions_.clear();
+    for (size_t i = 0; i < boards_.size(); i++) {
+      transactions_.emplace_back(
+        Transaction::read<SYSTEM_STATS__UPTIME>(boards_[i].serial_number, uptimes[i]));
+    }
+    int ret = odrive->transfer(transactions_);
+    if (ret != LIBUSB_SUCCESS) {
+      return ret;
+    }
+    now = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    for (size_t i = 0; i < boards_.size(); i++) {
+      loadConfigCache(i, now - uptimes[i], uptimes[i], current);
+    }
+  }
+
+  transactions_.clear();
+  for (size_t i = 0; i < info_.joints.size(); i++) {
+    for (int field = 0; field < AXIS_CONFIG_FIELDS; field++) {
+      const AxisConfigEndpoint & endpoint = axis_config_endpoints[field];
+      bool needed = field == CONFIG_TORQUE_CONSTANT
+                      ? std::isnan(axis_configs_[i].values[field].value)
+                      : odrive->fullAccess() && !std::isnan(axis_configs_[i].values[field].value);
+      if (needed && std::isnan(current[i].values[field].value)) {
+        transactions_.emplace_back(
+          endpoint.read(serial_numbers_[1][i], axes_[i], current[i].values[field]));
+      }
+    }
+  }
+  size_t reads = transactions_.size();
+  int ret = odrive->transfer(transactions_);
+  if (ret != LIBUSB_SUCCESS) {
+    return ret;
+  }
+
+  transactions_.clear();
+  for (size_t i = 0; i < info_.joints.size(); i++) {
+    for (int field = 0; field < AXIS_CONFIG_FIELDS; field++) {
+      const AxisConfigEndpoint & endpoint = axis_config_endpoints[field];
+      ConfigValue & value = current[i].values[field];
+      if (endpoint.flag && std::isnan(value.value)) {
+        value.value = value.flag;
+      }
+
+      const ConfigValue & desired = axis_configs_[i].values[field];
+      if (endpoint.write && odrive->fullAccess() && !std::isnan(desired.value)) {
+        if (desired.value != value.value) {
+          transactions_.emplace_back(
+            endpoint.write(serial_numbers_[1][i], axes_[i], axis_configs_[i].values[field]));
+        }
+        value = desired;
+      }
+    }
+
+    const ConfigValue & torque_constant = axis_configs_[i].values[CONFIG_TORQUE_CONSTANT];
+    torque_constants_.emplace_back(
+      std::isnan(torque_constant.value) ? current[i].values[CONFIG_TORQUE_CONSTANT].value
+                                        : torque_constant.value);
+  }
+  size_t writes = transactions_.size();
+  ret = odrive->transfer(transactions_);
+  if (ret != LIBUSB_SUCCESS) {
+    return ret;
+  }
+
+  RCLCPP_INFO(
+    rclcpp::get_logger("ODriveHardwareInterface"),
+    "Configured %zu axes with %zu reads and %zu writes", info_.joints.size(), reads, writes);
+
+  if (cached) {
+    for (size_t i = 0; i < boards_.size(); i++) {
+      storeConfigCache(i, now - uptimes[i], uptimes[i], current);
+    }
+  }
+  return LIBUSB_SUCCESS;
+}
+
+// A cache file starts with the boot time of the board, wall clock minus uptime in milliseconds,
+// and the uptime it was written at, followed by one setting per line. A board that rebooted after
+// the cache was written has booted later by at least the cached uptime, so the cache is trusted
+// only if the boot time matches within a tolerance for clock drift that is shorter than that.
+void ODriveHardwareInterface::loadConfigCache(
+  size_t board, int64_t boot_time, uint32_t uptime, std::vector<AxisConfig> & current)
+{
+  std::ostringstream path;
+  path << config_cache_ << "/" << std::hex << boards_[board].serial_number;
+  std::ifstream file(path.str());
+
+  int64_t cached_boot_time;
+  uint32_t cached_uptime;
+  if (!(file >> cached_boot_time >> cached_uptime) || uptime < cached_uptime) {
+    return;
+  }
+  int64_t tolerance = 1000 + (uptime - cached_uptime) / 1000;
+  if (std::abs(boot_time - cached_boot_time) > tolerance || cached_uptime <= tolerance) {
+    return;
+  }
+
+  int axis;
+  std::string name;
+  float value;
+  while (file >> axis >> name >> value) {
+    for (size_t i : boards_[board].joints) {
+      if (axes_[i] != axis) {
+        continue;
+      }
+      for (int field = 0; field < AXIS_CONFIG_FIELDS; field++) {
+        if (name == axis_config_endpoints[field].name) {
+          current[i].values[field].value = value;
+          current[i].values[field].flag = value;
+        }
+      }
+    }
+  }
+}
+
+void ODriveHardwareInterface::storeConfigCache(
+  size_t board, int64_t boot_time, uint32_t uptime, const std::vector<AxisConfig> & current)
+{
+  std::ostringstream path;
+  path << config_cache_ << "/" << std::hex << boards_[board].serial_number;
+
+  std::ostringstream file;
+  file << boot_time << " " << uptime << "\n";
+  file.precision(std::numeric_limits<float>::max_digits10);
+  for (size_t i : boards_[board].joints) {
+    for (int field = 0; field < AXIS_CONFIG_FIELDS; field++) {
+      if (!std::isnan(current[i].values[field].value)) {
+        file << axes_[i] << " " << axis_config_endpoints[field].name << " "
+             << current[i].values[field].value << "\n";
+      }
+    }
+  }
+  writeFileAtomically(path.str(), file.str());
+}
+
+// read() and write() must not allocate, so everything they fill is sized for a full cycle here
+CallbackReturn ODriveHardwareInterface::on_configure(const rclcpp_lifecycle::State &)
+{
+  transactions_.reserve(boards_.size() + info_.sensors.size() + 9 * info_.joints.size());
+  polled_reads_.reserve(plan_.reads.size());
+  written_setpoints_.reserve(plan_.setpoints.size());
+
   return CallbackReturn::SUCCESS;
 }
 
 CallbackReturn ODriveHardwareInterface::on_activate(const rclcpp_lifecycle::State &)
 {
   for (size_t i = 0; i < info_.joints.size(); i++) {
-    if (enable_watchdogs_[i]) {
-      CHECK_TS(
-        odrive->call(serial_numbers_[1][i], AXIS__WATCHDOG_FEED + per_axis_offset * axes_[i]));
+    if (axis_configs_[i].enable_watchdog) {
+      CHECK_TS(odrive->call<AXIS__WATCHDOG_FEED>(serial_numbers_[1][i], axes_[i]));
     }
-    CHECK_TS(odrive->call(serial_numbers_[1][i], CLEAR_ERRORS));
+    CHECK_TS(odrive->call<CLEAR_ERRORS>(serial_numbers_[1][i]));
+  }
+
+  if (io_thread_enabled_) {
+    CHECK_TS(readDevices(
+      std::chrono::steady_clock::time_point::max(),
+      std::chrono::duration<double>(io_thread_period_).count()));
+    startIoThread();
   }
 
   return CallbackReturn::SUCCESS;
@@ -91,10 +839,12 @@ CallbackReturn ODriveHardwareInterface::on_activate(const rclcpp_lifecycle::Stat
 
 CallbackReturn ODriveHardwareInterface::on_deactivate(const rclcpp_lifecycle::State &)
 {
-  int32_t requested_state = AXIS_STATE_IDLE;
+  stopIoThread();
+
+  endpoint_type_t<AXIS__REQUESTED_STATE> requested_state = AXIS_STATE_IDLE;
   for (size_t i = 0; i < info_.joints.size(); i++) {
-    CHECK_TS(odrive->write(
-      serial_numbers_[1][i], AXIS__REQUESTED_STATE + per_axis_offset * axes_[i], requested_state));
+    CHECK_TS(
+      odrive->write<AXIS__REQUESTED_STATE>(serial_numbers_[1][i], axes_[i], requested_state));
   }
 
   return CallbackReturn::SUCCESS;
@@ -106,6 +856,20 @@ std::vector<hardware_interface::StateInterface> ODriveHardwareInterface::export_
   for (size_t i = 0; i < info_.sensors.size(); i++) {
     state_interfaces.emplace_back(hardware_interface::StateInterface(
       info_.sensors[i].name, "vbus_voltage", &hw_vbus_voltages_[i]));
+    state_interfaces.emplace_back(hardware_interface::StateInterface(
+      info_.sensors[i].name, "deadline_misses", &hw_deadline_misses_[i]));
+    state_interfaces.emplace_back(hardware_interface::StateInterface(
+      info_.sensors[i].name, "critical_staleness", &hw_stalenesses_[POLL_TIERS * i + CRITICAL]));
+    state_interfaces.emplace_back(hardware_interface::StateInterface(
+      info_.sensors[i].name, "important_staleness",
+      &hw_stalenesses_[POLL_TIERS * i + IMPORTANT]));
+    state_interfaces.emplace_back(hardware_interface::StateInterface(
+      info_.sensors[i].name, "background_staleness",
+      &hw_stalenesses_[POLL_TIERS * i + BACKGROUND]));
+    if (can_) {
+      state_interfaces.emplace_back(hardware_interface::StateInterface(
+        info_.sensors[i].name, "bus_utilization", &hw_bus_utilizations_[i]));
+    }
   }
 
   for (size_t i = 0; i < info_.joints.size(); i++) {
@@ -191,180 +955,791 @@ return_type ODriveHardwareInterface::perform_command_mode_switch(
   const std::vector<std::string> &, const std::vector<std::string> &)
 {
   for (size_t i = 0; i < info_.joints.size(); i++) {
-    float input_torque, input_vel, input_pos;
-    int32_t requested_state;
+    AxisSetpoint & setpoint = command_.axes[i];
 
     switch (control_level_[i]) {
       case integration_level_t::UNDEFINED:
-        requested_state = AXIS_STATE_IDLE;
-        CHECK_RW(odrive->write(
-          serial_numbers_[1][i], AXIS__REQUESTED_STATE + per_axis_offset * axes_[i],
-          requested_state));
         break;
 
       case integration_level_t::EFFORT:
         hw_commands_efforts_[i] = hw_efforts_[i];
-        CHECK_RW(odrive->write(
-          serial_numbers_[1][i],
-          AXIS__CONTROLLER__CONFIG__CONTROL_MODE + per_axis_offset * axes_[i],
-          (int32_t)control_level_[i]));
-        input_torque = hw_commands_efforts_[i];
-        CHECK_RW(odrive->write(
-          serial_numbers_[1][i], AXIS__CONTROLLER__INPUT_TORQUE + per_axis_offset * axes_[i],
-          input_torque));
-        requested_state = AXIS_STATE_CLOSED_LOOP_CONTROL;
-        CHECK_RW(odrive->write(
-          serial_numbers_[1][i], AXIS__REQUESTED_STATE + per_axis_offset * axes_[i],
-          requested_state));
         break;
 
       case integration_level_t::VELOCITY:
         hw_commands_velocities_[i] = hw_velocities_[i];
         hw_commands_efforts_[i] = 0;
-        CHECK_RW(odrive->write(
-          serial_numbers_[1][i],
-          AXIS__CONTROLLER__CONFIG__CONTROL_MODE + per_axis_offset * axes_[i],
-          (int32_t)control_level_[i]));
-        input_vel = hw_commands_velocities_[i] / 2 / M_PI;
-        CHECK_RW(odrive->write(
-          serial_numbers_[1][i], AXIS__CONTROLLER__INPUT_VEL + per_axis_offset * axes_[i],
-          input_vel));
-        input_torque = hw_commands_efforts_[i];
-        CHECK_RW(odrive->write(
-          serial_numbers_[1][i], AXIS__CONTROLLER__INPUT_TORQUE + per_axis_offset * axes_[i],
-          input_torque));
-        requested_state = AXIS_STATE_CLOSED_LOOP_CONTROL;
-        CHECK_RW(odrive->write(
-          serial_numbers_[1][i], AXIS__REQUESTED_STATE + per_axis_offset * axes_[i],
-          requested_state));
         break;
 
       case integration_level_t::POSITION:
         hw_commands_positions_[i] = hw_positions_[i];
         hw_commands_velocities_[i] = 0;
         hw_commands_efforts_[i] = 0;
-        CHECK_RW(odrive->write(
-          serial_numbers_[1][i],
-          AXIS__CONTROLLER__CONFIG__CONTROL_MODE + per_axis_offset * axes_[i],
-          (int32_t)control_level_[i]));
-        input_pos = hw_commands_positions_[i] / 2 / M_PI;
-        CHECK_RW(odrive->write(
-          serial_numbers_[1][i], AXIS__CONTROLLER__INPUT_POS + per_axis_offset * axes_[i],
-          input_pos));
-        input_vel = hw_commands_velocities_[i] / 2 / M_PI;
-        CHECK_RW(odrive->write(
-          serial_numbers_[1][i], AXIS__CONTROLLER__INPUT_VEL + per_axis_offset * axes_[i],
-          input_vel));
-        input_torque = hw_commands_efforts_[i];
-        CHECK_RW(odrive->write(
-          serial_numbers_[1][i], AXIS__CONTROLLER__INPUT_TORQUE + per_axis_offset * axes_[i],
-          input_torque));
-        requested_state = AXIS_STATE_CLOSED_LOOP_CONTROL;
-        CHECK_RW(odrive->write(
-          serial_numbers_[1][i], AXIS__REQUESTED_STATE + per_axis_offset * axes_[i],
-          requested_state));
         break;
     }
+
+    setpoint.control_level = control_level_[i];
+    setpoint.control_mode = (uint8_t)control_level_[i];
+    setpoint.requested_state = control_level_[i] == integration_level_t::UNDEFINED
+                                 ? AXIS_STATE_IDLE
+                                 : AXIS_STATE_CLOSED_LOOP_CONTROL;
+    setpoint.input_pos = hw_commands_positions_[i] / 2 / M_PI;
+    setpoint.input_vel = hw_commands_velocities_[i] / 2 / M_PI;
+    setpoint.input_torque = hw_commands_efforts_[i];
+  }
+  command_.mode_switches++;
+
+  if (io_thread_.joinable()) {
+    command_buffer_.writeBuffer() = command_;
+    command_buffer_.publish();
+  } else {
+    int status = switchDevices(command_);
+    if (!transient(status)) {
+      CHECK_RW(status);
+    }
   }
 
   return return_type::OK;
 }
 
-return_type ODriveHardwareInterface::read(const rclcpp::Time &, const rclcpp::Duration &)
+return_type ODriveHardwareInterface::read(
+  const rclcpp::Time &, const rclcpp::Duration & period)
 {
+  const Feedback * feedback = &feedback_;
+  if (io_thread_.joinable()) {
+    feedback_buffer_.update();
+    feedback = &feedback_buffer_.readBuffer();
+  } else {
+    feedback_.status =
+      readDevices(deadline(std::chrono::nanoseconds(period.nanoseconds())), period.seconds());
+    countDeadlineMisses(feedback_.deadline_misses);
+    int ret = recoverDevices(feedback_, command_);
+    if (ret != LIBUSB_SUCCESS && !transient(ret)) {
+      feedback_.status = ret;
+    }
+  }
+  if (!transient(feedback->status)) {
+    CHECK_RW(feedback->status);
+  }
+
+  for (size_t i = 0; i < boards_.size(); i++) {
+    for (size_t j : boards_[i].sensors) {
+      hw_deadline_misses_[j] = feedback->deadline_misses[i];
+      for (size_t k = 0; k < POLL_TIERS; k++) {
+        hw_stalenesses_[POLL_TIERS * j + k] = feedback->stalenesses[POLL_TIERS * i + k];
+      }
+    }
+  }
+  if (!io_thread_.joinable()) {
+    std::fill(feedback_.deadline_misses.begin(), feedback_.deadline_misses.end(), 0);
+  }
+
   for (size_t i = 0; i < info_.sensors.size(); i++) {
-    float vbus_voltage;
+    hw_vbus_voltages_[i] = feedback->vbus_voltages[i];
+  }
+  if (can_) {
+    std::fill(hw_bus_utilizations_.begin(), hw_bus_utilizations_.end(), can_->utilization());
+  }
+
+  for (size_t i = 0; i < info_.joints.size(); i++) {
+    const AxisFeedback & axis = feedback->axes[i];
+
+    hw_efforts_[i] = axis.Iq_measured * torque_constants_[i];
+    hw_velocities_[i] = axis.vel_estimate * 2 * M_PI;
+    hw_positions_[i] = axis.pos_estimate * 2 * M_PI;
+    hw_axis_errors_[i] = axis.axis_error;
+    hw_motor_errors_[i] = axis.motor_error;
+    hw_encoder_errors_[i] = axis.encoder_error;
+    hw_controller_errors_[i] = axis.controller_error;
+    hw_fet_temperatures_[i] = axis.fet_temperature;
+    hw_motor_temperatures_[i] = axis.motor_temperature;
+  }
 
-    CHECK_RW(odrive->read(serial_numbers_[0][i], VBUS_VOLTAGE, vbus_voltage));
-    hw_vbus_voltages_[i] = vbus_voltage;
+  for (size_t i = 0; i < boards_.size(); i++) {
+    if (feedback->available[i]) {
+      continue;
+    }
+    for (size_t j : boards_[i].sensors) {
+      hw_vbus_voltages_[j] = std::numeric_limits<double>::quiet_NaN();
+    }
+    for (size_t j : boards_[i].joints) {
+      hw_efforts_[j] = std::numeric_limits<double>::quiet_NaN();
+      hw_velocities_[j] = std::numeric_limits<double>::quiet_NaN();
+      hw_positions_[j] = std::numeric_limits<double>::quiet_NaN();
+    }
   }
 
+  return return_type::OK;
+}
+
+return_type ODriveHardwareInterface::write(
+  const rclcpp::Time &, const rclcpp::Duration & period)
+{
   for (size_t i = 0; i < info_.joints.size(); i++) {
-    float Iq_measured, vel_estimate, pos_estimate, fet_temperature, motor_temperature;
-    uint8_t controller_error;
-    uint16_t encoder_error;
-    uint32_t axis_error;
-    uint64_t motor_error;
-
-    CHECK_RW(odrive->read(
-      serial_numbers_[1][i], AXIS__MOTOR__CURRENT_CONTROL__IQ_MEASURED + per_axis_offset * axes_[i],
-      Iq_measured));
-    hw_efforts_[i] = Iq_measured * torque_constants_[i];
-
-    CHECK_RW(odrive->read(
-      serial_numbers_[1][i], AXIS__ENCODER__VEL_ESTIMATE + per_axis_offset * axes_[i],
-      vel_estimate));
-    hw_velocities_[i] = vel_estimate * 2 * M_PI;
-
-    CHECK_RW(odrive->read(
-      serial_numbers_[1][i], AXIS__ENCODER__POS_ESTIMATE + per_axis_offset * axes_[i],
-      pos_estimate));
-    hw_positions_[i] = pos_estimate * 2 * M_PI;
-
-    CHECK_RW(
-      odrive->read(serial_numbers_[1][i], AXIS__ERROR + per_axis_offset * axes_[i], axis_error));
-    hw_axis_errors_[i] = axis_error;
-
-    CHECK_RW(odrive->read(
-      serial_numbers_[1][i], AXIS__MOTOR__ERROR + per_axis_offset * axes_[i], motor_error));
-    hw_motor_errors_[i] = motor_error;
-
-    CHECK_RW(odrive->read(
-      serial_numbers_[1][i], AXIS__ENCODER__ERROR + per_axis_offset * axes_[i], encoder_error));
-    hw_encoder_errors_[i] = encoder_error;
-
-    CHECK_RW(odrive->read(
-      serial_numbers_[1][i], AXIS__CONTROLLER__ERROR + per_axis_offset * axes_[i],
-      controller_error));
-    hw_controller_errors_[i] = controller_error;
-
-    CHECK_RW(odrive->read(
-      serial_numbers_[1][i], AXIS__MOTOR__FET_THERMISTOR__TEMPERATURE + per_axis_offset * axes_[i],
-      fet_temperature));
-    hw_fet_temperatures_[i] = fet_temperature;
-
-    CHECK_RW(odrive->read(
-      serial_numbers_[1][i],
-      AXIS__MOTOR__MOTOR_THERMISTOR__TEMPERATURE + per_axis_offset * axes_[i], motor_temperature));
-    hw_motor_temperatures_[i] = motor_temperature;
+    AxisSetpoint & setpoint = command_.axes[i];
+
+    setpoint.input_pos = hw_commands_positions_[i] / 2 / M_PI;
+    setpoint.input_vel = hw_commands_velocities_[i] / 2 / M_PI;
+    setpoint.input_torque = hw_commands_efforts_[i];
+  }
+
+  if (io_thread_.joinable()) {
+    command_buffer_.writeBuffer() = command_;
+    command_buffer_.publish();
+  } else {
+    int status = writeDevices(deadline(std::chrono::nanoseconds(period.nanoseconds())));
+    countDeadlineMisses(feedback_.deadline_misses);
+    if (!transient(status)) {
+      CHECK_RW(status);
+    }
   }
 
   return return_type::OK;
 }
 
-return_type ODriveHardwareInterface::write(const rclcpp::Time &, const rclcpp::Duration &)
+std::chrono::steady_clock::time_point ODriveHardwareInterface::deadline(
+  std::chrono::nanoseconds period)
+{
+  if (period.count() <= 0) {
+    return std::chrono::steady_clock::time_point::max();
+  }
+  return std::chrono::steady_clock::now() +
+         std::chrono::duration_cast<std::chrono::nanoseconds>(period * deadline_ratio_);
+}
+
+void ODriveHardwareInterface::countDeadlineMisses(std::vector<uint32_t> & deadline_misses)
 {
+  for (const Transaction & transaction : transactions_) {
+    if (transaction.status != LIBUSB_ERROR_TIMEOUT) {
+      continue;
+    }
+    for (size_t i = 0; i < boards_.size(); i++) {
+      if (boards_[i].serial_number == transaction.serial_number) {
+        deadline_misses[i]++;
+        break;
+      }
+    }
+  }
+}
+
+// An interface is polled every <interface>_poll_divisor cycles, or at <interface>_poll_rate Hz
+uint32_t ODriveHardwareInterface::pollDivisor(
+  const hardware_interface::ComponentInfo & component, const std::string & interface)
+{
+  if (component.parameters.count(interface + "_poll_divisor")) {
+    return std::max(1, std::stoi(component.parameters.at(interface + "_poll_divisor")));
+  }
+  return 1;
+}
+
+// Rates are kept in Hz and measured against the period of every read, so they follow whatever
+// rate the controller manager or the I/O thread runs at. A divisor takes precedence.
+double ODriveHardwareInterface::pollRate(
+  const hardware_interface::ComponentInfo & component, const std::string & interface)
+{
+  if (
+    !component.parameters.count(interface + "_poll_divisor") &&
+    component.parameters.count(interface + "_poll_rate")) {
+    return std::max(0.0, std::stod(component.parameters.at(interface + "_poll_rate")));
+  }
+  return 0;
+}
+
+// Gives every read the cycle within its divisor it is polled in, choosing the one that is least
+// loaded so far, so that slow reads share out evenly over the cycles
+std::vector<uint32_t> ODriveHardwareInterface::spreadPolls(const std::vector<uint32_t> & divisors)
+{
+  std::vector<size_t> order(divisors.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&divisors](size_t a, size_t b) {
+    return divisors[a] < divisors[b];
+  });
+
+  uint32_t horizon = divisors.empty() ? 1 : *std::max_element(divisors.begin(), divisors.end());
+  std::vector<uint32_t> load(horizon, 0);
+  std::vector<uint32_t> phases(divisors.size(), 0);
+  for (size_t i : order) {
+    uint32_t best = 0;
+    uint32_t best_load = std::numeric_limits<uint32_t>::max();
+    for (uint32_t phase = 0; phase < divisors[i]; phase++) {
+      uint32_t peak = 0;
+      for (uint32_t cycle = phase; cycle < horizon; cycle += divisors[i]) {
+        peak = std::max(peak, load[cycle]);
+      }
+      if (peak < best_load) {
+        best = phase;
+        best_load = peak;
+      }
+    }
+    for (uint32_t cycle = best; cycle < horizon; cycle += divisors[i]) {
+      load[cycle]++;
+    }
+    phases[i] = best;
+  }
+  return phases;
+}
+
+void ODriveHardwareInterface::compilePlan(Feedback & feedback, const Command & command)
+{
+  plan_.feedback = &feedback;
+  plan_.command = &command;
+
+  plan_.reads.clear();
+  plan_.read_divisors.clear();
+  plan_.read_rates.clear();
+  plan_.read_tiers.clear();
+  plan_.read_boards.clear();
+  size_t board_index = 0;
+  auto poll = [this, &board_index](
+                const Transaction & transaction,
+                const hardware_interface::ComponentInfo & component, const std::string & interface,
+                PollTier tier) {
+    plan_.reads.emplace_back(transaction);
+    plan_.read_divisors.emplace_back(pollDivisor(component, interface));
+    plan_.read_rates.emplace_back(pollRate(component, interface));
+    plan_.read_tiers.emplace_back(tier);
+    plan_.read_boards.emplace_back(board_index);
+  };
+
+  for (size_t b = 0; b < boards_.size(); b++) {
+    const Board & board = boards_[b];
+    board_index = b;
+
+    // Reboots are detected through the uptime, so it is read every cycle
+    plan_.reads.emplace_back(
+      Transaction::read<SYSTEM_STATS__UPTIME>(board.serial_number, feedback.uptimes[b]));
+    plan_.read_divisors.emplace_back(1);
+    plan_.read_rates.emplace_back(0);
+    plan_.read_tiers.emplace_back(CRITICAL);
+    plan_.read_boards.emplace_back(b);
+
+    for (size_t i : board.sensors) {
+      poll(
+        Transaction::read<VBUS_VOLTAGE>(serial_numbers_[0][i], feedback.vbus_voltages[i]),
+        info_.sensors[i], "vbus_voltage", BACKGROUND);
+    }
+
+    for (size_t i : board.joints) {
+      int64_t serial_number = serial_numbers_[1][i];
+      uint8_t axis_id = axes_[i];
+      AxisFeedback & axis = feedback.axes[i];
+      const hardware_interface::ComponentInfo & joint = info_.joints[i];
+
+      poll(
+        Transaction::read<AXIS__MOTOR__CURRENT_CONTROL__IQ_MEASURED>(
+          serial_number, axis_id, axis.Iq_measured),
+        joint, hardware_interface::HW_IF_EFFORT, IMPORTANT);
+      poll(
+        Transaction::read<AXIS__ENCODER__VEL_ESTIMATE>(serial_number, axis_id, axis.vel_estimate),
+        joint, hardware_interface::HW_IF_VELOCITY, CRITICAL);
+      poll(
+        Transaction::read<AXIS__ENCODER__POS_ESTIMATE>(serial_number, axis_id, axis.pos_estimate),
+        joint, hardware_interface::HW_IF_POSITION, CRITICAL);
+      poll(
+        Transaction::read<AXIS__ERROR>(serial_number, axis_id, axis.axis_error), joint,
+        "axis_error", IMPORTANT);
+      poll(
+        Transaction::read<AXIS__MOTOR__ERROR>(serial_number, axis_id, axis.motor_error), joint,
+        "motor_error", BACKGROUND);
+      poll(
+        Transaction::read<AXIS__ENCODER__ERROR>(serial_number, axis_id, axis.encoder_error), joint,
+        "encoder_error", BACKGROUND);
+      poll(
+        Transaction::read<AXIS__CONTROLLER__ERROR>(serial_number, axis_id, axis.controller_error),
+        joint, "controller_error", BACKGROUND);
+      poll(
+        Transaction::read<AXIS__MOTOR__FET_THERMISTOR__TEMPERATURE>(
+          serial_number, axis_id, axis.fet_temperature),
+        joint, "fet_temperature", BACKGROUND);
+      poll(
+        Transaction::read<AXIS__MOTOR__MOTOR_THERMISTOR__TEMPERATURE>(
+          serial_number, axis_id, axis.motor_temperature),
+        joint, "motor_temperature", BACKGROUND);
+    }
+  }
+  plan_.read_phases = spreadPolls(plan_.read_divisors);
+  read_cycles_ = 0;
+  // Reads with a rate start out with credits spread over [0, 1) by the golden ratio, so that
+  // their polls fall into different cycles whatever the period turns out to be
+  poll_credits_.assign(plan_.reads.size(), 0);
+  double credit = 0;
+  for (size_t i = 0; i < plan_.reads.size(); i++) {
+    if (plan_.read_rates[i] > 0) {
+      poll_credits_[i] = credit;
+      credit = std::fmod(credit + 0.6180339887498949, 1.0);
+    }
+  }
+  reads_due_.assign(plan_.reads.size(), false);
+  read_cycles_done_.assign(plan_.reads.size(), 0);
+  std::fill(std::begin(poll_cursors_), std::end(poll_cursors_), 0);
+
+  plan_.setpoints.clear();
   for (size_t i = 0; i < info_.joints.size(); i++) {
-    float input_torque, input_vel, input_pos;
+    int64_t serial_number = serial_numbers_[1][i];
+    uint8_t axis_id = axes_[i];
+    const AxisSetpoint & setpoint = command.axes[i];
 
-    switch (control_level_[i]) {
-      case integration_level_t::POSITION:
-        input_pos = hw_commands_positions_[i] / 2 / M_PI;
-        CHECK_RW(odrive->write(
-          serial_numbers_[1][i], AXIS__CONTROLLER__INPUT_POS + per_axis_offset * axes_[i],
-          input_pos));
+    plan_.setpoints.emplace_back(Transaction::write<AXIS__CONTROLLER__INPUT_POS>(
+      serial_number, axis_id, setpoint.input_pos));
+    plan_.setpoints.emplace_back(Transaction::write<AXIS__CONTROLLER__INPUT_VEL>(
+      serial_number, axis_id, setpoint.input_vel));
+    plan_.setpoints.emplace_back(Transaction::write<AXIS__CONTROLLER__INPUT_TORQUE>(
+      serial_number, axis_id, setpoint.input_torque));
+    plan_.setpoints.emplace_back(Transaction::call<AXIS__WATCHDOG_FEED>(serial_number, axis_id));
+  }
 
-      case integration_level_t::VELOCITY:
-        input_vel = hw_commands_velocities_[i] / 2 / M_PI;
-        CHECK_RW(odrive->write(
-          serial_numbers_[1][i], AXIS__CONTROLLER__INPUT_VEL + per_axis_offset * axes_[i],
-          input_vel));
+  sent_setpoints_.assign(3 * info_.joints.size(), std::numeric_limits<float>::quiet_NaN());
 
-      case integration_level_t::EFFORT:
-        input_torque = hw_commands_efforts_[i];
-        CHECK_RW(odrive->write(
-          serial_numbers_[1][i], AXIS__CONTROLLER__INPUT_TORQUE + per_axis_offset * axes_[i],
-          input_torque));
+  plan_.readbacks.assign(3 * info_.joints.size(), 0);
+  plan_.verifications.clear();
+  for (size_t i = 0; i < info_.joints.size(); i++) {
+    int64_t serial_number = serial_numbers_[1][i];
+    uint8_t axis_id = axes_[i];
 
-      case integration_level_t::UNDEFINED:
-        if (enable_watchdogs_[i]) {
-          CHECK_RW(
-            odrive->call(serial_numbers_[1][i], AXIS__WATCHDOG_FEED + per_axis_offset * axes_[i]));
-        }
+    plan_.verifications.emplace_back(Transaction::read<AXIS__CONTROLLER__INPUT_POS>(
+      serial_number, axis_id, plan_.readbacks[3 * i]));
+    plan_.verifications.emplace_back(Transaction::read<AXIS__CONTROLLER__INPUT_VEL>(
+      serial_number, axis_id, plan_.readbacks[3 * i + 1]));
+    plan_.verifications.emplace_back(Transaction::read<AXIS__CONTROLLER__INPUT_TORQUE>(
+      serial_number, axis_id, plan_.readbacks[3 * i + 2]));
+  }
+
+  for (Transaction & transaction : plan_.reads) {
+    transaction.device = odrive->resolve(transaction.serial_number);
+  }
+  for (Transaction & transaction : plan_.setpoints) {
+    transaction.device = odrive->resolve(transaction.serial_number);
+    transaction.ack = acknowledge_setpoints_;
+  }
+  for (Transaction & transaction : plan_.verifications) {
+    transaction.device = odrive->resolve(transaction.serial_number);
+  }
+}
+
+// How many important and background reads fit into this cycle next to the last write and the
+// critical reads
+size_t ODriveHardwareInterface::readBudget(size_t critical) const
+{
+  size_t budget = std::numeric_limits<size_t>::max();
+  if (cycle_transaction_budget_) {
+    budget = cycle_transaction_budget_;
+  }
+  if (cycle_time_budget_ > 0 && transaction_cost_ > 0) {
+    budget = std::min(budget, (size_t)(cycle_time_budget_ / transaction_cost_));
+  }
+  size_t spent = written_transactions_ + critical;
+  return budget > spent ? budget - spent : 0;
+}
+
+// How many cycles of the given period lie between two polls of a read
+uint32_t ODriveHardwareInterface::pollInterval(size_t read, double period) const
+{
+  double rate = plan_.read_rates[read];
+  if (rate > 0 && period > 0) {
+    return (uint32_t)std::min(std::ceil(1 / (rate * period)), 4294967295.0);
+  }
+  return plan_.read_divisors[read];
+}
+
+void ODriveHardwareInterface::measureStaleness(Feedback & feedback, double period) const
+{
+  std::fill(feedback.stalenesses.begin(), feedback.stalenesses.end(), 0);
+  for (size_t i = 0; i < plan_.reads.size(); i++) {
+    uint64_t age = read_cycles_ - read_cycles_done_[i];
+    uint32_t interval = pollInterval(i, period);
+    if (age > interval) {
+      uint32_t & staleness =
+        feedback.stalenesses[POLL_TIERS * plan_.read_boards[i] + plan_.read_tiers[i]];
+      staleness = std::max<uint64_t>(staleness, age - interval);
+    }
+  }
+}
+
+// The first cycle after compiling the plan reads everything, so held values start out current.
+// period is the time in seconds since the previous cycle.
+int ODriveHardwareInterface::readDevices(
+  std::chrono::steady_clock::time_point deadline, double period)
+{
+  bool first = !read_cycles_;
+  size_t critical = 0;
+  for (size_t i = 0; i < plan_.reads.size(); i++) {
+    bool due = first;
+    if (plan_.read_rates[i] > 0) {
+      // Credit beyond the next poll is dropped, so a long cycle does not make polls bunch up
+      poll_credits_[i] += plan_.read_rates[i] * std::max(0.0, period);
+      if (poll_credits_[i] >= 1) {
+        poll_credits_[i] -= std::floor(poll_credits_[i]);
+        due = true;
+      }
+    } else if (read_cycles_ % plan_.read_divisors[i] == plan_.read_phases[i]) {
+      due = true;
+    }
+    if (due) {
+      reads_due_[i] = true;
     }
+    critical += reads_due_[i] && plan_.read_tiers[i] == CRITICAL;
   }
+  read_cycles_++;
 
-  return return_type::OK;
+  transactions_.clear();
+  polled_reads_.clear();
+  for (size_t i = 0; i < plan_.reads.size(); i++) {
+    if (reads_due_[i] && plan_.read_tiers[i] == CRITICAL) {
+      transactions_.emplace_back(plan_.reads[i]);
+      polled_reads_.emplace_back(i);
+    }
+  }
+  // Background reads that missed a whole poll period move up, so they are not starved
+  auto tier = [this, period](size_t i) {
+    uint8_t tier = plan_.read_tiers[i];
+    if (tier == BACKGROUND && read_cycles_ - read_cycles_done_[i] > 2 * pollInterval(i, period)) {
+      return (uint8_t)IMPORTANT;
+    }
+    return tier;
+  };
+  size_t budget = first ? std::numeric_limits<size_t>::max() : readBudget(critical);
+  for (uint8_t t = IMPORTANT; t < POLL_TIERS; t++) {
+    size_t & cursor = poll_cursors_[t];
+    size_t polled = polled_reads_.size();
+    for (size_t k = 0; k < plan_.reads.size() && budget; k++) {
+      size_t i = (cursor + k) % plan_.reads.size();
+      if (reads_due_[i] && tier(i) == t) {
+        transactions_.emplace_back(plan_.reads[i]);
+        polled_reads_.emplace_back(i);
+        budget--;
+      }
+    }
+    if (polled_reads_.size() > polled) {
+      cursor = polled_reads_.back() + 1;
+    }
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  int ret = odrive->transfer(transactions_, deadline);
+  if (!transactions_.empty()) {
+    double cost = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() /
+                  transactions_.size();
+    transaction_cost_ = transaction_cost_ > 0 ? 0.9 * transaction_cost_ + 0.1 * cost : cost;
+  }
+
+  // Reads that failed or were cancelled stay due
+  for (size_t k = 0; k < polled_reads_.size(); k++) {
+    if (transactions_[k].status == LIBUSB_SUCCESS) {
+      reads_due_[polled_reads_[k]] = false;
+      read_cycles_done_[polled_reads_[k]] = read_cycles_;
+    }
+  }
+  measureStaleness(*plan_.feedback, period);
+
+  return ret;
+}
+
+int ODriveHardwareInterface::writeDevices(std::chrono::steady_clock::time_point deadline)
+{
+  setpoint_cycles_++;
+  bool verify = !acknowledge_setpoints_ && setpoint_verify_period_ &&
+                setpoint_cycles_ % setpoint_verify_period_ == 0;
+
+  transactions_.clear();
+  written_setpoints_.clear();
+  for (size_t i = 0; i < info_.joints.size(); i++) {
+    // Position control also sends the velocity and torque feedforward, velocity control the
+    // torque feedforward, and the watchdog is fed in every mode
+    const AxisSetpoint & setpoint = plan_.command->axes[i];
+    float values[3] = {setpoint.input_pos, setpoint.input_vel, setpoint.input_torque};
+    auto setpoints = plan_.setpoints.begin() + 4 * i;
+    int first = 3 - (int)setpoint.control_level;
+    bool refresh =
+      setpoint_refresh_period_ <= 1 || (setpoint_cycles_ + i) % setpoint_refresh_period_ == 0;
+    for (int j = first; j < 3; j++) {
+      float & sent = sent_setpoints_[3 * i + j];
+      if (refresh || !(std::abs(values[j] - sent) <= setpoint_deadbands_[3 * i + j])) {
+        sent = values[j];
+        transactions_.emplace_back(setpoints[j]);
+        written_setpoints_.emplace_back(3 * i + j);
+      }
+    }
+    // Watchdog feeds are marked past the end of sent_setpoints_
+    if (axis_configs_[i].enable_watchdog) {
+      transactions_.emplace_back(setpoints[3]);
+      written_setpoints_.emplace_back(sent_setpoints_.size());
+    }
+  }
+
+  // Each board handles its packets in order, so the read-back sees this cycle's writes
+  size_t verifications = transactions_.size();
+  if (verify) {
+    for (size_t i = 0; i < info_.joints.size(); i++) {
+      auto readbacks = plan_.verifications.begin() + 3 * i;
+      int first = 3 - (int)plan_.command->axes[i].control_level;
+      transactions_.insert(transactions_.end(), readbacks + first, readbacks + 3);
+    }
+  }
+
+  written_transactions_ = transactions_.size();
+  int ret = odrive->transfer(transactions_, deadline);
+  for (size_t k = 0; k < written_setpoints_.size(); k++) {
+    size_t written = written_setpoints_[k];
+    if (transactions_[k].status != LIBUSB_SUCCESS && written < sent_setpoints_.size()) {
+      sent_setpoints_[written] = std::numeric_limits<float>::quiet_NaN();
+    }
+  }
+  if (verify) {
+    verifySetpoints(verifications);
+  }
+
+  return ret;
+}
+
+void ODriveHardwareInterface::verifySetpoints(size_t verifications)
+{
+  for (size_t i = 0; i < info_.joints.size(); i++) {
+    int first = 3 - (int)plan_.command->axes[i].control_level;
+    bool lost = false;
+    bool verified = first < 3;
+
+    for (int j = first; j < 3; j++) {
+      const Transaction & readback = transactions_[verifications++];
+      // Skipped inputs still hold what was sent last
+      const float & sent = sent_setpoints_[3 * i + j];
+      if (readback.status != LIBUSB_SUCCESS) {
+        verified = false;
+      } else if (std::memcmp(readback.response, &sent, sizeof(sent))) {
+        lost = true;
+      }
+    }
+
+    bool ack = plan_.setpoints[4 * i].ack;
+    if (lost && !ack) {
+      RCLCPP_WARN(
+        rclcpp::get_logger("ODriveHardwareInterface"),
+        "Setpoint of joint %s was lost, acknowledging its writes", info_.joints[i].name.c_str());
+    }
+    if (lost || (verified && ack)) {
+      for (size_t j = 0; j < 4; j++) {
+        plan_.setpoints[4 * i + j].ack = lost;
+      }
+    }
+  }
+}
+
+void ODriveHardwareInterface::resendSetpoints(size_t joint)
+{
+  std::fill_n(sent_setpoints_.begin() + 3 * joint, 3, std::numeric_limits<float>::quiet_NaN());
+}
+
+int ODriveHardwareInterface::switchDevices(const Command & command)
+{
+  transactions_.clear();
+  for (const Board & board : boards_) {
+    for (size_t i : board.joints) {
+      appendModeSwitch(i, command.axes[i]);
+      resendSetpoints(i);
+    }
+  }
+
+  return odrive->transfer(transactions_);
+}
+
+int ODriveHardwareInterface::recoverDevices(Feedback & feedback, const Command & command)
+{
+  int ret = LIBUSB_SUCCESS;
+
+  for (size_t i = 0; i < boards_.size(); i++) {
+    int64_t serial_number = boards_[i].serial_number;
+
+    feedback.available[i] = odrive->connected(serial_number);
+    if (!feedback.available[i]) {
+      if (board_available_[i]) {
+        RCLCPP_WARN(
+          rclcpp::get_logger("ODriveHardwareInterface"), "Lost ODrive %lx",
+          (unsigned long)serial_number);
+      }
+      board_available_[i] = false;
+      continue;
+    }
+
+    uint32_t connections = odrive->connections(serial_number);
+    bool rebooted = feedback.uptimes[i] < board_uptimes_[i];
+    board_uptimes_[i] = feedback.uptimes[i];
+    if (connections == board_connections_[i] && !rebooted) {
+      board_available_[i] = true;
+      continue;
+    }
+
+    RCLCPP_WARN(
+      rclcpp::get_logger("ODriveHardwareInterface"), "Reconfiguring ODrive %lx",
+      (unsigned long)serial_number);
+    int status = configureBoard(i, command);
+    if (status != LIBUSB_SUCCESS) {
+      feedback.available[i] = false;
+      if (ret == LIBUSB_SUCCESS || transient(ret)) {
+        ret = status;
+      }
+      continue;
+    }
+    board_connections_[i] = connections;
+    board_available_[i] = true;
+
+    // The values read this cycle may predate the reboot
+    feedback.available[i] = false;
+  }
+
+  return ret;
+}
+
+int ODriveHardwareInterface::configureBoard(size_t board, const Command & command)
+{
+  transactions_.clear();
+  for (size_t i : boards_[board].joints) {
+    appendConfiguration(i);
+    if (axis_configs_[i].enable_watchdog) {
+      transactions_.emplace_back(
+        Transaction::call<AXIS__WATCHDOG_FEED>(serial_numbers_[1][i], axes_[i]));
+    }
+  }
+  for (size_t i : boards_[board].joints) {
+    appendModeSwitch(i, command.axes[i]);
+    resendSetpoints(i);
+  }
+
+  return odrive->transfer(transactions_);
+}
+
+void ODriveHardwareInterface::appendConfiguration(size_t joint)
+{
+  // Without full access the configuration has to be stored on the board beforehand
+  if (!odrive->fullAccess()) {
+    return;
+  }
+
+  int64_t serial_number = serial_numbers_[1][joint];
+  uint8_t axis_id = axes_[joint];
+  AxisConfig & config = axis_configs_[joint];
+
+  for (int field = 0; field < AXIS_CONFIG_FIELDS; field++) {
+    const AxisConfigEndpoint & endpoint = axis_config_endpoints[field];
+    if (endpoint.write && !std::isnan(config.values[field].value)) {
+      transactions_.emplace_back(endpoint.write(serial_number, axis_id, config.values[field]));
+    }
+  }
+}
+
+void ODriveHardwareInterface::appendModeSwitch(size_t joint, const AxisSetpoint & setpoint)
+{
+  int64_t serial_number = serial_numbers_[1][joint];
+  uint8_t axis_id = axes_[joint];
+
+  if (setpoint.control_level != integration_level_t::UNDEFINED) {
+    transactions_.emplace_back(Transaction::write<AXIS__CONTROLLER__CONFIG__CONTROL_MODE>(
+      serial_number, axis_id, setpoint.control_mode));
+  }
+
+  switch (setpoint.control_level) {
+    case integration_level_t::POSITION:
+      transactions_.emplace_back(Transaction::write<AXIS__CONTROLLER__INPUT_POS>(
+        serial_number, axis_id, setpoint.input_pos));
+
+    case integration_level_t::VELOCITY:
+      transactions_.emplace_back(Transaction::write<AXIS__CONTROLLER__INPUT_VEL>(
+        serial_number, axis_id, setpoint.input_vel));
+
+    case integration_level_t::EFFORT:
+      transactions_.emplace_back(Transaction::write<AXIS__CONTROLLER__INPUT_TORQUE>(
+        serial_number, axis_id, setpoint.input_torque));
+
+    case integration_level_t::UNDEFINED:
+      break;
+  }
+
+  transactions_.emplace_back(
+    Transaction::write<AXIS__REQUESTED_STATE>(serial_number, axis_id, setpoint.requested_state));
+}
+
+bool ODriveHardwareInterface::transient(int status)
+{
+  return status == LIBUSB_ERROR_TIMEOUT || status == LIBUSB_ERROR_NO_DEVICE;
+}
+
+void ODriveHardwareInterface::startIoThread()
+{
+  feedback_buffer_.init(feedback_);
+  command_buffer_.init(command_);
+
+  // From here on feedback_ and io_command_ belong to the I/O thread
+  io_command_ = command_;
+  compilePlan(feedback_, io_command_);
+
+  io_thread_running_ = true;
+  io_thread_ = std::thread(&ODriveHardwareInterface::ioLoop, this);
+
+  if (io_thread_priority_ > 0) {
+    sched_param param;
+    param.sched_priority = io_thread_priority_;
+    if (pthread_setschedparam(io_thread_.native_handle(), SCHED_FIFO, &param)) {
+      RCLCPP_WARN(
+        rclcpp::get_logger("ODriveHardwareInterface"), "Failed to set I/O thread priority");
+    }
+  }
+
+  if (io_thread_cpu_ >= 0) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(io_thread_cpu_, &cpu_set);
+    if (pthread_setaffinity_np(io_thread_.native_handle(), sizeof(cpu_set), &cpu_set)) {
+      RCLCPP_WARN(
+        rclcpp::get_logger("ODriveHardwareInterface"), "Failed to set I/O thread affinity");
+    }
+  }
+}
+
+void ODriveHardwareInterface::stopIoThread()
+{
+  if (io_thread_.joinable()) {
+    io_thread_running_ = false;
+    io_thread_.join();
+    compilePlan(feedback_, command_);
+  }
+}
+
+void ODriveHardwareInterface::ioLoop()
+{
+  uint32_t mode_switches = command_buffer_.readBuffer().mode_switches;
+  std::chrono::steady_clock::time_point wakeup = std::chrono::steady_clock::now();
+
+  while (io_thread_running_) {
+    command_buffer_.update();
+    io_command_ = command_buffer_.readBuffer();
+
+    std::fill(feedback_.deadline_misses.begin(), feedback_.deadline_misses.end(), 0);
+
+    int ret;
+    if (io_command_.mode_switches != mode_switches) {
+      mode_switches = io_command_.mode_switches;
+      ret = switchDevices(io_command_);
+    } else {
+      ret = writeDevices(deadline(io_thread_period_));
+      countDeadlineMisses(feedback_.deadline_misses);
+    }
+    int status = readDevices(
+      deadline(io_thread_period_), std::chrono::duration<double>(io_thread_period_).count());
+    countDeadlineMisses(feedback_.deadline_misses);
+    int recovery = recoverDevices(feedback_, io_command_);
+    if (status == LIBUSB_SUCCESS || transient(status)) {
+      status = recovery != LIBUSB_SUCCESS ? recovery : status;
+    }
+    feedback_.status = ret != LIBUSB_SUCCESS && !transient(ret) ? ret : status;
+    feedback_buffer_.writeBuffer() = feedback_;
+    feedback_buffer_.publish();
+
+    wakeup += io_thread_period_;
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (wakeup < now) {
+      wakeup = now;
+    }
+    std::this_thread::sleep_until(wakeup);
+  }
 }
 }  // namespace odrive_hardware_interface
 
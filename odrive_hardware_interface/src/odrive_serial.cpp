@@ -0,0 +1,609 @@
+// Copyright 2021 Factor Robotics
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "odrive_hardware_interface/odrive_serial.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+
+namespace odrive
+{
+int openSerialPort(const std::string & path, unsigned int baud_rate)
+{
+  speed_t speed;
+  switch (baud_rate) {
+    case 9600:
+      speed = B9600;
+      break;
+    case 19200:
+      speed = B19200;
+      break;
+    case 38400:
+      speed = B38400;
+      break;
+    case 57600:
+      speed = B57600;
+      break;
+    case 115200:
+      speed = B115200;
+      break;
+    case 230400:
+      speed = B230400;
+      break;
+    case 460800:
+      speed = B460800;
+      break;
+    case 921600:
+      speed = B921600;
+      break;
+    case 1000000:
+      speed = B1000000;
+      break;
+    case 2000000:
+      speed = B2000000;
+      break;
+    default:
+      return LIBUSB_ERROR_INVALID_PARAM;
+  }
+
+  int fd = open(path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) {
+    return errnoStatus(errno);
+  }
+
+  termios options;
+  if (tcgetattr(fd, &options)) {
+    int error = errno;
+    close(fd);
+    return errnoStatus(error);
+  }
+  cfmakeraw(&options);
+  options.c_cflag |= CLOCAL | CREAD;
+  options.c_cflag &= ~(CSTOPB | CRTSCTS);
+  options.c_cc[VMIN] = 0;
+  options.c_cc[VTIME] = 0;
+  cfsetispeed(&options, speed);
+  cfsetospeed(&options, speed);
+  if (tcsetattr(fd, TCSANOW, &options)) {
+    int error = errno;
+    close(fd);
+    return errnoStatus(error);
+  }
+
+  // Whatever the board sent before is no answer to us
+  tcflush(fd, TCIOFLUSH);
+  return fd;
+}
+
+ODriveSerial::ODriveSerial(unsigned int baud_rate)
+: baud_rate_(baud_rate),
+  pipeline_depth_(ODRIVE_DEFAULT_PIPELINE_DEPTH),
+  transaction_timeout_(ODRIVE_DEFAULT_TRANSACTION_TIMEOUT)
+{
+}
+
+ODriveSerial::~ODriveSerial()
+{
+  for (Port & port : ports_) {
+    if (port.fd >= 0) {
+      close(port.fd);
+    }
+  }
+}
+
+void ODriveSerial::addPort(const std::string & path)
+{
+  ports_.emplace_back();
+  Port & port = ports_.back();
+  port.path = path;
+  port.fd = -1;
+  port.serial_number = 0;
+  port.connected = false;
+  port.connections = 0;
+  port.probing = false;
+  port.sequence_number = 0;
+  port.written = 0;
+  port.next = 0;
+  port.outstanding = 0;
+}
+
+int ODriveSerial::init(
+  const std::vector<std::vector<int64_t>> & serial_numbers, size_t pipeline_depth,
+  unsigned int transaction_timeout)
+{
+  pipeline_depth_ = pipeline_depth;
+  transaction_timeout_ = std::chrono::milliseconds(transaction_timeout);
+  descriptors_.reserve(ports_.size());
+  polled_ports_.reserve(ports_.size());
+
+  for (size_t i = 0; i < ports_.size(); i++) {
+    Port & port = ports_[i];
+    int ret = openPort(port);
+    if (ret != LIBUSB_SUCCESS) {
+      std::cerr << "Failed to open " << port.path << ": " << libusb_error_name(ret) << std::endl;
+      return ret;
+    }
+
+    uint64_t serial_number;
+    ret = identify(port, serial_number);
+    if (ret != LIBUSB_SUCCESS) {
+      std::cerr << "No ODrive answers on " << port.path << std::endl;
+      return ret;
+    }
+    if (port_map_.count(serial_number)) {
+      std::cerr << "ODrive " << std::hex << serial_number << std::dec << " is on "
+                << ports_[port_map_[serial_number]].path << " and " << port.path << std::endl;
+      return LIBUSB_ERROR_INVALID_PARAM;
+    }
+    port.serial_number = serial_number;
+    port.connections = 1;
+    port_map_[serial_number] = i;
+    std::cout << "Connected to ODrive " << std::hex << serial_number << std::dec << " on "
+              << port.path << std::endl;
+  }
+
+  for (const std::vector<int64_t> & group : serial_numbers) {
+    for (int64_t serial_number : group) {
+      if (serial_number && !port_map_.count(serial_number)) {
+        std::cerr << "ODrive " << std::hex << serial_number << std::dec
+                  << " is on none of the serial ports" << std::endl;
+        return LIBUSB_ERROR_NOT_FOUND;
+      }
+    }
+  }
+
+  return LIBUSB_SUCCESS;
+}
+
+int ODriveSerial::transfer(
+  std::vector<Transaction> & transactions, std::chrono::steady_clock::time_point deadline)
+{
+  reopenPorts(std::chrono::steady_clock::now());
+
+  for (Transaction & transaction : transactions) {
+    Port * serial_port = transaction.device >= 0 && (size_t)transaction.device < ports_.size()
+                           ? &ports_[transaction.device]
+                           : port(transaction.serial_number);
+    if (!serial_port) {
+      transaction.status = LIBUSB_ERROR_NO_DEVICE;
+      continue;
+    }
+    enqueue(*serial_port, transaction);
+  }
+  run(deadline);
+
+  return batchStatus(transactions);
+}
+
+int ODriveSerial::transfer(Transaction & transaction)
+{
+  reopenPorts(std::chrono::steady_clock::now());
+
+  Port * serial_port = port(transaction.serial_number);
+  if (!serial_port) {
+    return LIBUSB_ERROR_NO_DEVICE;
+  }
+  return transfer(*serial_port, transaction);
+}
+
+void ODriveSerial::setEndpointTable(int64_t serial_number, const EndpointTable & table)
+{
+  Port * serial_port = port(serial_number);
+  if (serial_port) {
+    serial_port->endpoints = table;
+  }
+}
+
+int ODriveSerial::resolve(int64_t serial_number)
+{
+  Port * serial_port = port(serial_number);
+  return serial_port ? (int)(serial_port - ports_.data()) : (int)LIBUSB_ERROR_NO_DEVICE;
+}
+
+bool ODriveSerial::connected(int64_t serial_number)
+{
+  Port * serial_port = port(serial_number);
+  return serial_port && serial_port->connected;
+}
+
+uint32_t ODriveSerial::connections(int64_t serial_number)
+{
+  Port * serial_port = port(serial_number);
+  return serial_port ? serial_port->connections : 0;
+}
+
+ODriveSerial::Port * ODriveSerial::port(int64_t serial_number)
+{
+  if (!serial_number) {
+    return port_map_.empty() ? NULL : &ports_[port_map_.begin()->second];
+  }
+
+  auto it = port_map_.find(serial_number);
+  return it != port_map_.end() ? &ports_[it->second] : NULL;
+}
+
+int ODriveSerial::openPort(Port & port)
+{
+  int ret = openSerialPort(port.path, baud_rate_);
+  if (ret < 0) {
+    return ret;
+  }
+
+  port.fd = ret;
+  port.connected = true;
+  port.decoder.reset();
+  port.output.clear();
+  port.written = 0;
+  port.slots.assign(pipeline_depth_, Slot{});
+  port.outstanding = 0;
+  return LIBUSB_SUCCESS;
+}
+
+// Fails everything pending on the port
+void ODriveSerial::closePort(Port & port, int status)
+{
+  if (port.fd >= 0) {
+    close(port.fd);
+    port.fd = -1;
+  }
+  port.connected = false;
+  port.reopen_time =
+    std::chrono::steady_clock::now() + std::chrono::milliseconds(ODRIVE_SERIAL_REOPEN_INTERVAL);
+
+  for (; port.next < port.queue.size(); port.next++) {
+    port.queue[port.next]->status = status;
+  }
+  for (Slot & slot : port.slots) {
+    if (slot.transaction) {
+      slot.sending = false;
+      slot.waiting = false;
+      finish(port, slot, status);
+    }
+  }
+  port.output.clear();
+  port.written = 0;
+}
+
+// UART has no notion of a device going away, so a port that failed is simply tried again. Only
+// the board that was there before is accepted. Its serial number is read along with the batches
+// rather than waited for, as the adapter may well be there while the board is not powered.
+void ODriveSerial::reopenPorts(std::chrono::steady_clock::time_point now)
+{
+  for (Port & port : ports_) {
+    if (port.probing) {
+      checkProbe(port);
+      continue;
+    }
+    if (port.connected || !port.serial_number || now < port.reopen_time) {
+      continue;
+    }
+    port.reopen_time = now + std::chrono::milliseconds(ODRIVE_SERIAL_REOPEN_INTERVAL);
+    if (openPort(port) != LIBUSB_SUCCESS) {
+      continue;
+    }
+
+    port.connected = false;
+    port.probing = true;
+    port.probe = Transaction::read<SERIAL_NUMBER>(0, port.probed_serial_number);
+    active_ports_.emplace_back(&port);
+    port.queue.emplace_back(&port.probe);
+  }
+}
+
+// Nothing but the probe is sent to a port that is not connected
+void ODriveSerial::checkProbe(Port & port)
+{
+  if (port.outstanding) {
+    active_ports_.emplace_back(&port);
+    return;
+  }
+
+  port.probing = false;
+  if (port.probe.status != LIBUSB_SUCCESS ||
+      (int64_t)port.probed_serial_number != port.serial_number) {
+    closePort(port, LIBUSB_ERROR_NO_DEVICE);
+    return;
+  }
+  port.connected = true;
+  port.connections++;
+  std::cout << "Reconnected to ODrive " << std::hex << port.serial_number << std::dec << " on "
+            << port.path << std::endl;
+}
+
+// Same as for USB: a board that ignores the request is asked for its descriptor, which tells
+// how to address it
+int ODriveSerial::identify(Port & port, uint64_t & serial_number)
+{
+  Transaction transaction = Transaction::read<SERIAL_NUMBER>(0, serial_number);
+  if (transfer(port, transaction) == LIBUSB_SUCCESS) {
+    return LIBUSB_SUCCESS;
+  }
+
+  std::string descriptor;
+  int ret = readDescriptor(
+    [this, &port](Transaction & transaction) { return transfer(port, transaction); }, 0,
+    descriptor);
+  if (ret != LIBUSB_SUCCESS) {
+    return ret;
+  }
+  if (parseDescriptor(descriptor, port.endpoints) < 0 || port.endpoints.crc == json_crc) {
+    return LIBUSB_ERROR_NOT_SUPPORTED;
+  }
+
+  transaction = Transaction::read<SERIAL_NUMBER>(0, serial_number);
+  ret = transfer(port, transaction);
+  if (ret == LIBUSB_SUCCESS) {
+    std::cout << "ODrive " << std::hex << serial_number << " has descriptor CRC 0x"
+              << port.endpoints.crc << ", using its endpoint table" << std::dec << std::endl;
+  }
+  return ret;
+}
+
+int ODriveSerial::transfer(Port & port, Transaction & transaction)
+{
+  enqueue(port, transaction);
+  run(std::chrono::steady_clock::time_point::max());
+
+  return transaction.status;
+}
+
+void ODriveSerial::enqueue(Port & port, Transaction & transaction)
+{
+  if (!port.connected) {
+    transaction.status = LIBUSB_ERROR_NO_DEVICE;
+    return;
+  }
+  if (port.queue.empty()) {
+    active_ports_.emplace_back(&port);
+  }
+  port.queue.emplace_back(&transaction);
+}
+
+// Requests are written as the ports take them and responses read as they come in, until every
+// transaction is done, timed out or the deadline passed
+void ODriveSerial::run(std::chrono::steady_clock::time_point deadline)
+{
+  while (true) {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point wakeup = deadline;
+    bool busy = false;
+
+    for (Port * port : active_ports_) {
+      // The probe is not waited for, so its response is picked up whenever the batch passes by
+      if (port->probing && port->fd >= 0) {
+        receive(*port);
+      }
+      expire(*port, now, now >= deadline);
+      dispatch(*port, now);
+      flush(*port);
+      // dispatch() leaves requests queued only while every slot is taken, so waiting is only
+      // ever for requests in flight
+      busy |= port->outstanding > (port->probing ? 1u : 0u);
+      for (const Slot & slot : port->slots) {
+        if (slot.transaction) {
+          wakeup = std::min(wakeup, slot.timeout);
+        }
+      }
+    }
+    if (!busy) {
+      break;
+    }
+
+    descriptors_.clear();
+    polled_ports_.clear();
+    for (Port * port : active_ports_) {
+      if (port->fd >= 0 && port->outstanding) {
+        short events = POLLIN | (port->written < port->output.size() ? POLLOUT : 0);
+        descriptors_.push_back({port->fd, events, 0});
+        polled_ports_.emplace_back(port);
+      }
+    }
+
+    int64_t remaining = std::max<int64_t>(
+      0, std::chrono::duration_cast<std::chrono::nanoseconds>(wakeup - now).count());
+    timespec wait = {remaining / 1000000000, remaining % 1000000000};
+    if (ppoll(descriptors_.data(), descriptors_.size(), &wait, NULL) <= 0) {
+      continue;
+    }
+    for (size_t i = 0; i < descriptors_.size(); i++) {
+      Port & port = *polled_ports_[i];
+      if (descriptors_[i].revents & POLLIN) {
+        receive(port);
+      }
+      // A USB adapter that went away hangs up after the last bytes were read
+      if (port.fd >= 0 && descriptors_[i].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+        closePort(port, LIBUSB_ERROR_NO_DEVICE);
+      }
+    }
+  }
+
+  for (Port * port : active_ports_) {
+    port->queue.clear();
+    port->next = 0;
+  }
+  active_ports_.clear();
+}
+
+// Gives up on requests past their timeout, or on everything but the probe once the deadline
+// passed. A frame that is partly written still goes out whole to keep the stream in sync, while
+// frames nothing was written of yet are dropped.
+void ODriveSerial::expire(Port & port, std::chrono::steady_clock::time_point now, bool cancel)
+{
+  if (cancel) {
+    for (; port.next < port.queue.size(); port.next++) {
+      port.queue[port.next]->status = LIBUSB_ERROR_TIMEOUT;
+    }
+  }
+
+  size_t end = port.written;
+  for (Slot & slot : port.slots) {
+    if (!slot.transaction) {
+      continue;
+    }
+    if (now < slot.timeout && (!cancel || slot.transaction == &port.probe)) {
+      if (slot.sending) {
+        end = std::max(end, slot.end);
+      }
+      continue;
+    }
+    if (slot.sending && slot.start < port.written) {
+      end = std::max(end, slot.end);
+    }
+    slot.sending = false;
+    slot.waiting = false;
+    finish(port, slot, LIBUSB_ERROR_TIMEOUT);
+  }
+  if (cancel) {
+    port.output.resize(std::min(port.output.size(), end));
+  }
+}
+
+void ODriveSerial::dispatch(Port & port, std::chrono::steady_clock::time_point now)
+{
+  // A request that cannot be sent does not use up the slot, the next one is taken instead
+  for (Slot & slot : port.slots) {
+    while (!slot.transaction && port.next < port.queue.size()) {
+      Transaction & transaction = *port.queue[port.next++];
+      transaction.status = LIBUSB_SUCCESS;
+
+      short endpoint_id = port.endpoints.id(transaction.endpoint_id);
+      if (endpoint_id < 0) {
+        transaction.status = LIBUSB_ERROR_NOT_SUPPORTED;
+        continue;
+      }
+      if (transaction.ack) {
+        endpoint_id |= 0x8000;
+      }
+      port.sequence_number = (port.sequence_number + 1) & 0x7fff;
+      port.sequence_number |= LIBUSB_ENDPOINT_IN;
+
+      unsigned char packet[ODRIVE_MAX_PACKET_SIZE];
+      int length = transaction.packet ? encodePacket(
+                                          packet, port.sequence_number, endpoint_id,
+                                          *transaction.packet, transaction.request,
+                                          port.endpoints.crc)
+                                      : encodePacket(
+                                          packet, port.sequence_number, endpoint_id,
+                                          transaction.ack ? transaction.response_size : 0,
+                                          transaction.request, transaction.request_size,
+                                          port.endpoints.crc);
+      if (length < 0) {
+        transaction.status = length;
+        continue;
+      }
+
+      size_t start = port.output.size();
+      port.output.resize(start + ODRIVE_MAX_STREAM_FRAME_SIZE);
+      port.output.resize(start + encodeStreamFrame(&port.output[start], packet, length));
+
+      slot.transaction = &transaction;
+      slot.sequence_number = port.sequence_number;
+      slot.start = start;
+      slot.end = port.output.size();
+      slot.timeout = now + transaction_timeout_;
+      slot.sending = true;
+      slot.waiting = transaction.ack;
+      port.outstanding++;
+    }
+  }
+}
+
+void ODriveSerial::flush(Port & port)
+{
+  while (port.written < port.output.size()) {
+    ssize_t count =
+      ::write(port.fd, &port.output[port.written], port.output.size() - port.written);
+    if (count > 0) {
+      port.written += count;
+    } else if (count < 0 && errno == EAGAIN) {
+      break;
+    } else if (count < 0 && errno != EINTR) {
+      // Terminals fail with EIO once hung up
+      closePort(port, errno == EIO ? LIBUSB_ERROR_NO_DEVICE : errnoStatus(errno));
+      return;
+    }
+  }
+
+  for (Slot & slot : port.slots) {
+    if (slot.transaction && slot.sending && slot.end <= port.written) {
+      slot.sending = false;
+      finish(port, slot, LIBUSB_SUCCESS);
+    }
+  }
+  if (port.written == port.output.size()) {
+    port.output.clear();
+    port.written = 0;
+  }
+}
+
+void ODriveSerial::receive(Port & port)
+{
+  unsigned char buffer[256];
+  while (true) {
+    ssize_t count = ::read(port.fd, buffer, sizeof(buffer));
+    if (count > 0) {
+      port.decoder.decode(buffer, count, [this, &port](const unsigned char * packet, int length) {
+        respond(port, packet, length);
+      });
+    } else if (count == 0 || errno == EAGAIN) {
+      // Without VMIN a terminal returns nothing rather than EAGAIN once it is drained
+      return;
+    } else if (errno != EINTR) {
+      // Terminals fail with EIO once hung up
+      closePort(port, errno == EIO ? LIBUSB_ERROR_NO_DEVICE : errnoStatus(errno));
+      return;
+    }
+  }
+}
+
+// Responses echo the sequence number with the MSB set. Late responses to requests that timed out
+// carry a sequence number no slot is waiting for.
+void ODriveSerial::respond(Port & port, const unsigned char * packet, int length)
+{
+  if (length < 2) {
+    return;
+  }
+
+  short sequence_number = (packet[0] | (packet[1] << 8)) & 0x7fff;
+  for (Slot & slot : port.slots) {
+    if (slot.transaction && slot.waiting && slot.sequence_number == sequence_number) {
+      Transaction & transaction = *slot.transaction;
+      int size =
+        decodePacket(packet, length, transaction.response, transaction.response_size);
+      if (transaction.endpoint_id == 0) {
+        transaction.response_size = size;
+      }
+
+      slot.waiting = false;
+      finish(
+        port, slot, size == transaction.response_size ? LIBUSB_SUCCESS : LIBUSB_ERROR_IO);
+      return;
+    }
+  }
+}
+
+void ODriveSerial::finish(Port & port, Slot & slot, int status)
+{
+  if (status != LIBUSB_SUCCESS && slot.transaction->status == LIBUSB_SUCCESS) {
+    slot.transaction->status = status;
+  }
+  if (!slot.sending && !slot.waiting) {
+    slot.transaction = NULL;
+    port.outstanding--;
+  }
+}
+}  // namespace odrive
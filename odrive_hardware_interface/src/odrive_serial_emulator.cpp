@@ -0,0 +1,162 @@
+// Copyright 2021 Factor Robotics
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "odrive_hardware_interface/odrive_serial_emulator.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+
+namespace odrive
+{
+ODriveSerialEmulator::ODriveSerialEmulator(ODriveTransport & boards)
+: boards_(boards), running_(false)
+{
+}
+
+ODriveSerialEmulator::~ODriveSerialEmulator()
+{
+  stop();
+  for (Port & port : ports_) {
+    close(port.master);
+    close(port.slave);
+  }
+}
+
+int ODriveSerialEmulator::start(
+  const std::vector<int64_t> & serial_numbers, std::vector<std::string> & paths)
+{
+  paths.clear();
+  for (int64_t serial_number : serial_numbers) {
+    // Requests have to carry the CRC of the descriptor the boards serve
+    std::string descriptor;
+    int ret = boards_.readDescriptor(serial_number, descriptor);
+    if (ret != LIBUSB_SUCCESS) {
+      return ret;
+    }
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (master < 0) {
+      return errnoStatus(errno);
+    }
+    const char * path = grantpt(master) || unlockpt(master) ? NULL : ptsname(master);
+    int slave = path ? open(path, O_RDWR | O_NOCTTY | O_CLOEXEC) : -1;
+    if (slave < 0) {
+      int error = errno;
+      close(master);
+      return errnoStatus(error);
+    }
+
+    // No echo or line editing until a client configures the terminal itself
+    termios options;
+    tcgetattr(slave, &options);
+    cfmakeraw(&options);
+    tcsetattr(slave, TCSANOW, &options);
+
+    ports_.emplace_back();
+    Port & port = ports_.back();
+    port.serial_number = serial_number;
+    port.master = master;
+    port.slave = slave;
+    port.crc = descriptorCrc(descriptor.data(), descriptor.size());
+    paths.emplace_back(path);
+    std::cout << "Emulating ODrive " << std::hex << serial_number << std::dec << " on " << path
+              << std::endl;
+  }
+
+  running_ = true;
+  thread_ = std::thread(&ODriveSerialEmulator::run, this);
+  return LIBUSB_SUCCESS;
+}
+
+void ODriveSerialEmulator::stop()
+{
+  if (thread_.joinable()) {
+    running_ = false;
+    thread_.join();
+  }
+}
+
+void ODriveSerialEmulator::run()
+{
+  std::vector<pollfd> descriptors;
+  unsigned char buffer[256];
+
+  while (running_) {
+    // Wake up every 10 ms to notice stop()
+    descriptors.clear();
+    for (const Port & port : ports_) {
+      short events = POLLIN | (port.output.empty() ? 0 : POLLOUT);
+      descriptors.push_back({port.master, events, 0});
+    }
+    poll(descriptors.data(), descriptors.size(), 10);
+
+    for (size_t i = 0; i < ports_.size(); i++) {
+      Port & port = ports_[i];
+      ssize_t count;
+      while ((count = read(port.master, buffer, sizeof(buffer))) > 0) {
+        port.decoder.decode(buffer, count, [this, &port](const unsigned char * packet, int length) {
+          handle(port, packet, length);
+        });
+      }
+      flush(port);
+    }
+  }
+}
+
+// Requests with a bad CRC or to a board that does not answer are dropped, as in firmware
+void ODriveSerialEmulator::handle(Port & port, const unsigned char * packet, int length)
+{
+  Request request;
+  if (decodeRequest(packet, length, request, port.crc) != LIBUSB_SUCCESS) {
+    return;
+  }
+
+  unsigned char payload[ODRIVE_MAX_RESPONSE_PACKET_SIZE - 2];
+  bool ack = request.endpoint_id & 0x8000;
+  short response_size = ack ? std::min<int>(request.response_size, sizeof(payload)) : 0;
+  transactions_.assign(
+    1, {port.serial_number, (short)(request.endpoint_id & 0x7fff), request.payload,
+        request.payload_size, response_size ? payload : NULL, response_size, ack, NULL, -1,
+        LIBUSB_SUCCESS});
+  if (boards_.transfer(transactions_) != LIBUSB_SUCCESS || !ack) {
+    return;
+  }
+
+  unsigned char response[ODRIVE_MAX_RESPONSE_PACKET_SIZE];
+  int response_length =
+    encodeResponse(response, request.sequence_number, payload, transactions_[0].response_size);
+  size_t start = port.output.size();
+  port.output.resize(start + ODRIVE_MAX_STREAM_FRAME_SIZE);
+  port.output.resize(start + encodeStreamFrame(&port.output[start], response, response_length));
+}
+
+void ODriveSerialEmulator::flush(Port & port)
+{
+  size_t written = 0;
+  while (written < port.output.size()) {
+    ssize_t count = write(port.master, &port.output[written], port.output.size() - written);
+    if (count <= 0) {
+      break;
+    }
+    written += count;
+  }
+  port.output.erase(port.output.begin(), port.output.begin() + written);
+}
+}  // namespace odrive
@@ -0,0 +1,81 @@
+// Copyright 2021 Factor Robotics
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Serves emulated ODrives on pseudo terminals, e.g. for the serial transport:
+//
+//   ros2 run odrive_hardware_interface odrive_serial_emulator 2000 2001
+//
+// Every board is given by its serial number (hex) and the terminal to use for it is printed.
+// --simulator emulates the boards with motor dynamics.
+
+#include <signal.h>
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "odrive_hardware_interface/odrive_serial_emulator.hpp"
+#include "odrive_hardware_interface/odrive_simulator.hpp"
+
+using namespace odrive;
+
+int main(int argc, char ** argv)
+{
+  std::vector<int64_t> serial_numbers;
+  bool simulator = false;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--simulator") {
+      simulator = true;
+    } else if (arg.find_first_not_of("0123456789abcdefABCDEF") == std::string::npos) {
+      serial_numbers.emplace_back(std::stoull(arg, 0, 16));
+    } else {
+      std::cerr << "Unknown argument " << arg << std::endl;
+      return 1;
+    }
+  }
+  if (serial_numbers.empty()) {
+    std::cerr << "Usage: odrive_serial_emulator <serial>... [--simulator]" << std::endl;
+    return 1;
+  }
+
+  std::unique_ptr<ODriveEmulator> boards;
+  if (simulator) {
+    boards.reset(new ODriveSimulator(AxisDynamics{1e-4, 1e-4, 1e-3}));
+  } else {
+    boards.reset(new ODriveEmulator());
+  }
+  boards->init({serial_numbers, {}});
+
+  // Handle SIGINT and SIGTERM in main() only, after the emulator thread inherited the mask
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+  ODriveSerialEmulator emulator(*boards);
+  std::vector<std::string> paths;
+  int ret = emulator.start(serial_numbers, paths);
+  if (ret != LIBUSB_SUCCESS) {
+    std::cerr << "Failed to start: " << libusb_error_name(ret) << std::endl;
+    return 1;
+  }
+
+  int signal_number;
+  sigwait(&signals, &signal_number);
+  emulator.stop();
+  return 0;
+}
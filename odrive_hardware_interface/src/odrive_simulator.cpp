@@ -0,0 +1,255 @@
+// Copyright 2021 Factor Robotics
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "odrive_hardware_interface/odrive_simulator.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace odrive
+{
+ODriveSimulator::ODriveSimulator(
+  const AxisDynamics & dynamics, std::chrono::nanoseconds latency, std::chrono::nanoseconds jitter)
+: ODriveEmulator(latency, jitter), dynamics_(dynamics)
+{
+}
+
+// Starts from the firmware's default configuration with calibrated motors and encoders
+void ODriveSimulator::reset(Board & board)
+{
+  ODriveEmulator::reset(board);
+
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  BoardState & board_state = state(board);
+  board_state.stepped = now;
+
+  for (uint8_t axis = 0; axis < ODRIVE_EMULATOR_AXIS_COUNT; axis++) {
+    board_state.axes[axis] = AxisState{0, 0, 0, 0, 0, now};
+
+    store(board, Endpoint<AXIS__MOTOR__IS_CALIBRATED>::id(axis), true);
+    store(board, Endpoint<AXIS__ENCODER__IS_READY>::id(axis), true);
+    store(board, Endpoint<AXIS__MOTOR__CONFIG__CURRENT_LIM>::id(axis), 10.0f);
+    store(board, Endpoint<AXIS__MOTOR__CONFIG__TORQUE_LIM>::id(axis), INFINITY);
+    store(board, Endpoint<AXIS__MOTOR__FET_THERMISTOR__TEMPERATURE>::id(axis), 25.0f);
+    store(board, Endpoint<AXIS__MOTOR__MOTOR_THERMISTOR__TEMPERATURE>::id(axis), 25.0f);
+    store(board, Endpoint<AXIS__ENCODER__CONFIG__CPR>::id(axis), 8192);
+    store(board, Endpoint<AXIS__ENCODER__CONFIG__BANDWIDTH>::id(axis), 1000.0f);
+    store(
+      board, Endpoint<AXIS__CONTROLLER__CONFIG__CONTROL_MODE>::id(axis),
+      (uint8_t)CONTROL_MODE_POSITION_CONTROL);
+    store(board, Endpoint<AXIS__CONTROLLER__CONFIG__INPUT_MODE>::id(axis), (uint8_t)1);
+    store(board, Endpoint<AXIS__CONTROLLER__CONFIG__POS_GAIN>::id(axis), 20.0f);
+    store(board, Endpoint<AXIS__CONTROLLER__CONFIG__VEL_GAIN>::id(axis), 1.0f / 6);
+    store(board, Endpoint<AXIS__CONTROLLER__CONFIG__VEL_INTEGRATOR_GAIN>::id(axis), 1.0f / 3);
+    store(board, Endpoint<AXIS__CONTROLLER__CONFIG__VEL_LIMIT>::id(axis), 2.0f);
+  }
+}
+
+// Catches the axes up with the wall clock in control loop periods, but does not try to replay
+// pauses longer than a second
+void ODriveSimulator::update(Board & board, std::chrono::steady_clock::time_point now)
+{
+  ODriveEmulator::update(board, now);
+
+  const std::chrono::nanoseconds period(1000000000 / ODRIVE_SIMULATOR_RATE);
+  BoardState & board_state = state(board);
+  if (now - board_state.stepped > std::chrono::seconds(1)) {
+    board_state.stepped = now - std::chrono::seconds(1);
+  }
+
+  for (; board_state.stepped + period <= now; board_state.stepped += period) {
+    for (uint8_t axis = 0; axis < ODRIVE_EMULATOR_AXIS_COUNT; axis++) {
+      step(board, axis, board_state.axes[axis], board_state.stepped + period);
+    }
+  }
+}
+
+void ODriveSimulator::written(Board & board, short endpoint_id)
+{
+  short endpoint;
+  uint8_t axis;
+  if (!axisEndpoint(endpoint_id, endpoint, axis)) {
+    ODriveEmulator::written(board, endpoint_id);
+    return;
+  }
+
+  AxisState & axis_state = state(board).axes[axis];
+  switch (endpoint) {
+    case AXIS__REQUESTED_STATE: {
+      uint8_t requested_state = load<uint8_t>(board, endpoint_id);
+      store(board, endpoint_id, (uint8_t)0);
+
+      // Closed loop control is refused while an error is pending and starts from the current
+      // position so that it does not jump
+      if (requested_state == AXIS_STATE_IDLE) {
+        store(board, Endpoint<AXIS__CURRENT_STATE>::id(axis), requested_state);
+      } else if (
+        requested_state == AXIS_STATE_CLOSED_LOOP_CONTROL &&
+        !load<endpoint_type_t<AXIS__ERROR>>(board, Endpoint<AXIS__ERROR>::id(axis))) {
+        axis_state.vel_integrator_torque = 0;
+        store(
+          board, Endpoint<AXIS__CONTROLLER__INPUT_POS>::id(axis), (float)axis_state.pll_position);
+        store(board, Endpoint<AXIS__CURRENT_STATE>::id(axis), requested_state);
+      }
+      break;
+    }
+
+    case AXIS__WATCHDOG_FEED:
+    case AXIS__CONFIG__ENABLE_WATCHDOG:
+      axis_state.watchdog_fed = std::chrono::steady_clock::now();
+      break;
+
+    default:
+      break;
+  }
+}
+
+ODriveSimulator::BoardState & ODriveSimulator::state(const Board & board)
+{
+  size_t index = &board - &boards_[0];
+  if (states_.size() <= index) {
+    states_.resize(index + 1);
+  }
+  return states_[index];
+}
+
+void ODriveSimulator::step(
+  Board & board, uint8_t axis, AxisState & axis_state, std::chrono::steady_clock::time_point now)
+{
+  const double dt = 1.0 / ODRIVE_SIMULATOR_RATE;
+
+  if (
+    load<endpoint_type_t<AXIS__CONFIG__ENABLE_WATCHDOG>>(
+      board, Endpoint<AXIS__CONFIG__ENABLE_WATCHDOG>::id(axis)) &&
+    now - axis_state.watchdog_fed >
+      std::chrono::duration<float>(load<endpoint_type_t<AXIS__CONFIG__WATCHDOG_TIMEOUT>>(
+        board, Endpoint<AXIS__CONFIG__WATCHDOG_TIMEOUT>::id(axis)))) {
+    short error = Endpoint<AXIS__ERROR>::id(axis);
+    store(
+      board, error,
+      load<endpoint_type_t<AXIS__ERROR>>(board, error) | AXIS_ERROR_WATCHDOG_TIMER_EXPIRED);
+    store(board, Endpoint<AXIS__CURRENT_STATE>::id(axis), (uint8_t)AXIS_STATE_IDLE);
+  }
+
+  control(board, axis, axis_state, dt);
+  double torque =
+    load<float>(board, Endpoint<AXIS__MOTOR__CURRENT_CONTROL__IQ_SETPOINT>::id(axis)) *
+    load<float>(board, Endpoint<AXIS__MOTOR__CONFIG__TORQUE_CONSTANT>::id(axis));
+
+  // Rigid load with viscous and Coulomb friction, where static friction holds the shaft as long
+  // as the motor torque cannot overcome it
+  double velocity = 2 * M_PI * axis_state.velocity;
+  double friction = dynamics_.viscous_friction * velocity;
+  if (velocity != 0) {
+    friction += std::copysign(dynamics_.coulomb_friction, velocity);
+  } else if (std::abs(torque) <= dynamics_.coulomb_friction) {
+    friction = torque;
+  } else {
+    friction = std::copysign(dynamics_.coulomb_friction, torque);
+  }
+  double next_velocity = velocity + (torque - friction) / dynamics_.inertia * dt;
+  if (
+    velocity != 0 && next_velocity * velocity < 0 &&
+    std::abs(torque) <= dynamics_.coulomb_friction) {
+    next_velocity = 0;
+  }
+  axis_state.velocity = next_velocity / (2 * M_PI);
+  axis_state.position += axis_state.velocity * dt;
+
+  // Incremental encoder followed by the firmware's PLL estimator
+  int32_t cpr = load<int32_t>(board, Endpoint<AXIS__ENCODER__CONFIG__CPR>::id(axis));
+  float bandwidth = load<float>(board, Endpoint<AXIS__ENCODER__CONFIG__BANDWIDTH>::id(axis));
+  int32_t count = std::floor(axis_state.position * cpr);
+  double pll_kp = 2 * bandwidth;
+  double pll_ki = 0.25 * pll_kp * pll_kp;
+
+  axis_state.pll_position += dt * axis_state.pll_velocity;
+  double delta = (double)count / cpr - axis_state.pll_position;
+  axis_state.pll_position += dt * pll_kp * delta;
+  axis_state.pll_velocity += dt * pll_ki * delta;
+  if (std::abs(axis_state.pll_velocity) < 0.5 * dt * pll_ki / cpr) {
+    axis_state.pll_velocity = 0;
+  }
+
+  store(board, Endpoint<AXIS__ENCODER__SHADOW_COUNT>::id(axis), count);
+  store(board, Endpoint<AXIS__ENCODER__POS_ESTIMATE>::id(axis), (float)axis_state.pll_position);
+  store(board, Endpoint<AXIS__ENCODER__VEL_ESTIMATE>::id(axis), (float)axis_state.pll_velocity);
+}
+
+// Position, velocity and torque cascade of the firmware controller, ending in the current
+// setpoint. Outside closed loop control the motor is off.
+void ODriveSimulator::control(Board & board, uint8_t axis, AxisState & axis_state, double dt)
+{
+  float torque_constant =
+    load<float>(board, Endpoint<AXIS__MOTOR__CONFIG__TORQUE_CONSTANT>::id(axis));
+
+  if (
+    load<uint8_t>(board, Endpoint<AXIS__CURRENT_STATE>::id(axis)) !=
+    AXIS_STATE_CLOSED_LOOP_CONTROL) {
+    axis_state.vel_integrator_torque = 0;
+    store(board, Endpoint<AXIS__MOTOR__CURRENT_CONTROL__IQ_SETPOINT>::id(axis), 0.0f);
+    store(board, Endpoint<AXIS__MOTOR__CURRENT_CONTROL__IQ_MEASURED>::id(axis), 0.0f);
+    return;
+  }
+
+  uint8_t control_mode =
+    load<uint8_t>(board, Endpoint<AXIS__CONTROLLER__CONFIG__CONTROL_MODE>::id(axis));
+  float pos_setpoint = load<float>(board, Endpoint<AXIS__CONTROLLER__INPUT_POS>::id(axis));
+  float vel_setpoint = load<float>(board, Endpoint<AXIS__CONTROLLER__INPUT_VEL>::id(axis));
+  float torque_setpoint = load<float>(board, Endpoint<AXIS__CONTROLLER__INPUT_TORQUE>::id(axis));
+
+  double vel_des = vel_setpoint;
+  if (control_mode >= CONTROL_MODE_POSITION_CONTROL) {
+    vel_des += load<float>(board, Endpoint<AXIS__CONTROLLER__CONFIG__POS_GAIN>::id(axis)) *
+               (pos_setpoint - axis_state.pll_position);
+  }
+
+  double torque = torque_setpoint;
+  double vel_error = 0;
+  if (control_mode >= CONTROL_MODE_VELOCITY_CONTROL) {
+    float vel_limit = load<float>(board, Endpoint<AXIS__CONTROLLER__CONFIG__VEL_LIMIT>::id(axis));
+    vel_des = std::max<double>(-vel_limit, std::min<double>(vel_limit, vel_des));
+    vel_error = vel_des - axis_state.pll_velocity;
+    torque += load<float>(board, Endpoint<AXIS__CONTROLLER__CONFIG__VEL_GAIN>::id(axis)) *
+                vel_error +
+              axis_state.vel_integrator_torque;
+  }
+
+  // Saturation bleeds off the integrator instead of winding it up further
+  double torque_limit = std::min<double>(
+    load<float>(board, Endpoint<AXIS__MOTOR__CONFIG__CURRENT_LIM>::id(axis)) * torque_constant,
+    load<float>(board, Endpoint<AXIS__MOTOR__CONFIG__TORQUE_LIM>::id(axis)));
+  if (std::abs(torque) > torque_limit) {
+    torque = std::copysign(torque_limit, torque);
+    axis_state.vel_integrator_torque *= 0.99;
+  } else if (control_mode >= CONTROL_MODE_VELOCITY_CONTROL) {
+    axis_state.vel_integrator_torque +=
+      load<float>(board, Endpoint<AXIS__CONTROLLER__CONFIG__VEL_INTEGRATOR_GAIN>::id(axis)) * dt *
+      vel_error;
+  }
+
+  store(board, Endpoint<AXIS__CONTROLLER__POS_SETPOINT>::id(axis), pos_setpoint);
+  store(board, Endpoint<AXIS__CONTROLLER__VEL_SETPOINT>::id(axis), vel_setpoint);
+  store(board, Endpoint<AXIS__CONTROLLER__TORQUE_SETPOINT>::id(axis), torque_setpoint);
+  store(
+    board, Endpoint<AXIS__CONTROLLER__VEL_INTEGRATOR_TORQUE>::id(axis),
+    (float)axis_state.vel_integrator_torque);
+  store(
+    board, Endpoint<AXIS__MOTOR__CURRENT_CONTROL__IQ_SETPOINT>::id(axis),
+    (float)(torque / torque_constant));
+  store(
+    board, Endpoint<AXIS__MOTOR__CURRENT_CONTROL__IQ_MEASURED>::id(axis),
+    (float)(torque / torque_constant));
+}
+}  // namespace odrive
@@ -16,15 +16,30 @@
 
 namespace odrive
 {
-ODriveUSB::ODriveUSB() { libusb_context_ = NULL; }
+ODriveUSB::ODriveUSB()
+{
+  libusb_context_ = NULL;
+  pipeline_depth_ = ODRIVE_DEFAULT_PIPELINE_DEPTH;
+  transaction_timeout_ = ODRIVE_DEFAULT_TRANSACTION_TIMEOUT;
+  hotplug_registered_ = false;
+}
 
 ODriveUSB::~ODriveUSB()
 {
+  if (hotplug_registered_) {
+    libusb_hotplug_deregister_callback(libusb_context_, hotplug_handle_);
+    hotplug_registered_ = false;
+  }
+  for (libusb_device * usb_device : arrived_devices_) {
+    libusb_unref_device(usb_device);
+  }
+  arrived_devices_.clear();
+
   for (auto it = odrive_map_.begin(); it != odrive_map_.end(); it++) {
-    libusb_release_interface(it->second, 2);
-    libusb_close(it->second);
+    closeDevice(it->second);
   }
   odrive_map_.clear();
+  devices_.clear();
 
   if (libusb_context_) {
     libusb_exit(libusb_context_);
@@ -32,248 +47,787 @@ ODriveUSB::~ODriveUSB()
   }
 }
 
-int ODriveUSB::init(const std::vector<std::vector<int64_t>> & serial_numbers)
+int ODriveUSB::init(
+  const std::vector<std::vector<int64_t>> & serial_numbers, size_t pipeline_depth,
+  unsigned int transaction_timeout)
 {
   int ret = libusb_init(&libusb_context_);
   if (ret != LIBUSB_SUCCESS) {
     return ret;
   }
 
+  pipeline_depth_ = pipeline_depth ? pipeline_depth : 1;
+  transaction_timeout_ = transaction_timeout;
+
+  // Without any serial number or port configured the first ODrive found is used
+  std::vector<int64_t> wanted;
+  for (const std::vector<int64_t> & group : serial_numbers) {
+    for (int64_t serial_number : group) {
+      if (serial_number && std::find(wanted.begin(), wanted.end(), serial_number) == wanted.end()) {
+        wanted.emplace_back(serial_number);
+      }
+    }
+  }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
   libusb_device ** device_list;
   ssize_t device_count = libusb_get_device_list(libusb_context_, &device_list);
-  if (device_count <= 0) {
+  if (device_count < 0) {
     return device_count;
   }
-
+  std::vector<std::pair<std::string, libusb_device *>> odrives;
   for (ssize_t i = 0; i < device_count; ++i) {
-    libusb_device * device = device_list[i];
     libusb_device_descriptor descriptor;
+    if (
+      libusb_get_device_descriptor(device_list[i], &descriptor) == LIBUSB_SUCCESS &&
+      descriptor.idVendor == ODRIVE_USB_VENDORID && descriptor.idProduct == ODRIVE_USB_PRODUCTID) {
+      odrives.emplace_back(portPath(device_list[i]), device_list[i]);
+    }
+  }
 
-    if (libusb_get_device_descriptor(device, &descriptor) != LIBUSB_SUCCESS) {
-      continue;
+  // Boards are first looked for where they were found last time, and only if one of them moved
+  // are all ODrives on the bus considered
+  std::vector<libusb_device *> known;
+  std::vector<std::string> known_paths = port_paths_;
+  for (int64_t serial_number : wanted) {
+    auto it = known_ports_.find(serial_number);
+    if (it == known_ports_.end()) {
+      known_paths.clear();
+      break;
     }
+    known_paths.emplace_back(it->second);
+  }
+  for (const std::pair<std::string, libusb_device *> & odrive : odrives) {
+    if (std::find(known_paths.begin(), known_paths.end(), odrive.first) != known_paths.end()) {
+      known.emplace_back(odrive.second);
+    }
+  }
 
-    if (
-      descriptor.idVendor == ODRIVE_USB_VENDORID && descriptor.idProduct == ODRIVE_USB_PRODUCTID) {
-      libusb_device_handle * device_handle;
-      if (libusb_open(device, &device_handle) != LIBUSB_SUCCESS) {
-        continue;
+  std::chrono::steady_clock::time_point enumerated = std::chrono::steady_clock::now();
+
+  bool cached = false;
+  bool moved = false;
+  if (!wanted.empty() && !known.empty()) {
+    claim(known, {}, true);
+    cached = std::all_of(wanted.begin(), wanted.end(), [this](int64_t serial_number) {
+      return odrive_map_.count(serial_number) &&
+             odrive_map_.at(serial_number)->port_path == known_ports_.at(serial_number);
+    });
+    moved = !cached;
+    if (moved) {
+      std::cout << "ODrives moved since the last run, enumerating all of them" << std::endl;
+      for (auto it = odrive_map_.begin(); it != odrive_map_.end(); it++) {
+        closeDevice(it->second);
       }
-      if (
-        (libusb_kernel_driver_active(device_handle, 2) != LIBUSB_SUCCESS) &&
-        (libusb_detach_kernel_driver(device_handle, 2) != LIBUSB_SUCCESS)) {
-        libusb_close(device_handle);
-        continue;
-      }
-      if ((libusb_claim_interface(device_handle, 2)) != LIBUSB_SUCCESS) {
-        libusb_close(device_handle);
-        continue;
+      odrive_map_.clear();
+    }
+  }
+
+  std::chrono::steady_clock::time_point verified = std::chrono::steady_clock::now();
+
+  size_t candidate_count = known.size();
+  if (!cached) {
+    std::vector<libusb_device *> bound, others;
+    for (const std::pair<std::string, libusb_device *> & odrive : odrives) {
+      if (std::find(port_paths_.begin(), port_paths_.end(), odrive.first) != port_paths_.end()) {
+        bound.emplace_back(odrive.second);
+      } else {
+        others.emplace_back(odrive.second);
       }
-      uint64_t serial_number;
-      if ((read(device_handle, SERIAL_NUMBER, serial_number)) != LIBUSB_SUCCESS) {
-        libusb_release_interface(device_handle, 2);
-        libusb_close(device_handle);
-        continue;
+    }
+    // Boards bound by port are all needed, whatever their serial number, while the other ports
+    // are only searched for the boards bound by serial number that are still missing
+    claim(bound, {}, true);
+    candidate_count = bound.size();
+    std::vector<int64_t> missing;
+    for (int64_t serial_number : wanted) {
+      if (!odrive_map_.count(serial_number)) {
+        missing.emplace_back(serial_number);
       }
-      odrive_map_.insert(std::pair<int64_t, libusb_device_handle *>(-serial_number, device_handle));
+    }
+    if (port_paths_.empty() || !missing.empty()) {
+      claim(others, missing, false);
+      candidate_count += others.size();
     }
   }
-
   libusb_free_device_list(device_list, 1);
-  if (!odrive_map_.size()) {
-    return LIBUSB_ERROR_NO_DEVICE;
+
+  std::chrono::steady_clock::time_point claimed = std::chrono::steady_clock::now();
+  auto milliseconds = [](std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  };
+  std::cout << "USB startup: enumerated " << device_count << " devices in "
+            << milliseconds(enumerated - start) << " ms, ";
+  if (moved) {
+    std::cout << "tried known ports for " << milliseconds(verified - enumerated) << " ms, ";
   }
+  std::cout << "claimed " << odrive_map_.size() << " of " << candidate_count << " ODrives"
+            << (cached ? " at their known ports" : "") << " in "
+            << milliseconds(claimed - (cached ? enumerated : verified)) << " ms" << std::endl;
 
-  if (odrive_map_.size() == 1) {
-    auto it = odrive_map_.begin();
-    odrive_map_.insert(std::pair<int64_t, libusb_device_handle *>(-it->first, it->second));
-    std::cout << "Connected to ODrive " << std::hex << -it->first << std::endl;
-    odrive_map_.erase(it);
-  } else {
-    for (size_t i = 0; i < 2; i++) {
-      for (size_t j = 0; j < serial_numbers[0].size(); j++) {
-        if (!odrive_map_.count(serial_numbers[i][j])) {
-          auto it = odrive_map_.find(-serial_numbers[i][j]);
-          if (it != odrive_map_.end()) {
-            odrive_map_.insert(std::pair<int64_t, libusb_device_handle *>(-it->first, it->second));
-            std::cout << "Connected to ODrive " << std::hex << -it->first << std::endl;
-            odrive_map_.erase(it);
-          } else {
-            return LIBUSB_ERROR_NO_DEVICE;
-          }
-        }
-      }
+  if (odrive_map_.empty()) {
+    return LIBUSB_ERROR_NO_DEVICE;
+  }
+  for (int64_t serial_number : wanted) {
+    if (!odrive_map_.count(serial_number)) {
+      std::cerr << "ODrive " << std::hex << serial_number << std::dec << " not found" << std::endl;
+      return LIBUSB_ERROR_NO_DEVICE;
     }
   }
 
   for (auto it = odrive_map_.begin(); it != odrive_map_.end(); it++) {
-    if (it->first < 0) {
-      libusb_release_interface(it->second, 2);
-      libusb_close(it->second);
-      odrive_map_.erase(it);
-    }
+    std::cout << "Connected to ODrive " << std::hex << it->first << std::dec << " at USB port "
+              << it->second->port_path << std::endl;
+    devices_.emplace_back(it->second);
+  }
+  active_devices_.reserve(odrive_map_.size());
+
+  if (libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)) {
+    ret = libusb_hotplug_register_callback(
+      libusb_context_, LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT,
+      LIBUSB_HOTPLUG_NO_FLAGS, ODRIVE_USB_VENDORID, ODRIVE_USB_PRODUCTID,
+      LIBUSB_HOTPLUG_MATCH_ANY, hotplugCallback, this, &hotplug_handle_);
+    hotplug_registered_ = ret == LIBUSB_SUCCESS;
   }
 
   return LIBUSB_SUCCESS;
 }
 
-template <typename T>
-int ODriveUSB::read(int64_t & serial_number, short endpoint_id, T & value)
+// Opens and claims the candidates in parallel, one thread each since opening and claiming are
+// blocking control transfers. All boards then answer for their serial number in one batch, and
+// only boards that ignore it go through the slower descriptor path one by one.
+void ODriveUSB::claim(
+  const std::vector<libusb_device *> & candidates, const std::vector<int64_t> & serial_numbers,
+  bool keep_all)
 {
-  if (serial_number) {
-    return read(odrive_map_[serial_number], endpoint_id, value);
-  } else {
-    return read(odrive_map_.begin()->second, endpoint_id, value);
+  std::vector<Device *> opened(candidates.size(), NULL);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < candidates.size(); i++) {
+    threads.emplace_back([this, &candidates, &serial_numbers, &opened, i]() {
+      opened[i] = openDevice(candidates[i], serial_numbers);
+    });
+  }
+  for (std::thread & thread : threads) {
+    thread.join();
+  }
+  opened.erase(std::remove(opened.begin(), opened.end(), (Device *)NULL), opened.end());
+
+  std::vector<uint64_t> identities(opened.size());
+  std::vector<Transaction> transactions;
+  transactions.reserve(opened.size());
+  for (size_t i = 0; i < opened.size(); i++) {
+    transactions.emplace_back(Transaction::read<SERIAL_NUMBER>(0, identities[i]));
+    enqueue(opened[i], transactions.back());
+  }
+  run(std::chrono::steady_clock::time_point::max());
+
+  for (size_t i = 0; i < opened.size(); i++) {
+    Device * odrive_device = opened[i];
+    if (
+      transactions[i].status != LIBUSB_SUCCESS &&
+      identify(odrive_device, identities[i]) != LIBUSB_SUCCESS) {
+      closeDevice(odrive_device);
+      continue;
+    }
+
+    int64_t serial_number = identities[i];
+    bool needed = keep_all || (serial_numbers.empty()
+                                 ? odrive_map_.empty()
+                                 : std::find(serial_numbers.begin(), serial_numbers.end(),
+                                             serial_number) != serial_numbers.end());
+    if (!needed || odrive_map_.count(serial_number)) {
+      closeDevice(odrive_device);
+      continue;
+    }
+    odrive_map_[serial_number] = odrive_device;
   }
 }
 
-template <typename T>
-int ODriveUSB::read(libusb_device_handle * odrive_handle, short endpoint_id, T & value)
+void ODriveUSB::setPortPaths(const std::vector<std::string> & port_paths)
 {
-  bytes request_payload;
-  bytes response_payload;
+  port_paths_ = port_paths;
+}
 
-  int ret = endpointOperation(
-    odrive_handle, endpoint_id, sizeof(value), request_payload, response_payload, 1);
-  if (ret != LIBUSB_SUCCESS) {
-    return ret;
-  }
+void ODriveUSB::setKnownPorts(const std::map<int64_t, std::string> & known_ports)
+{
+  known_ports_ = known_ports;
+}
 
-  std::memcpy(&value, &response_payload[0], sizeof(value));
+std::string ODriveUSB::portPath(int64_t serial_number)
+{
+  Device * odrive_device = device(serial_number);
+  return odrive_device ? odrive_device->port_path : std::string();
+}
 
-  return LIBUSB_SUCCESS;
+int64_t ODriveUSB::serialNumber(const std::string & port_path)
+{
+  for (auto it = odrive_map_.begin(); it != odrive_map_.end(); it++) {
+    if (it->second->port_path == port_path) {
+      return it->first;
+    }
+  }
+  return 0;
 }
 
-template <typename T>
-int ODriveUSB::write(int64_t & serial_number, short endpoint_id, const T & value)
+std::string ODriveUSB::portPath(libusb_device * usb_device)
 {
-  if (serial_number) {
-    return write(odrive_map_[serial_number], endpoint_id, value);
-  } else {
-    return write(odrive_map_.begin()->second, endpoint_id, value);
+  uint8_t ports[8];
+  int count = libusb_get_port_numbers(usb_device, ports, sizeof(ports));
+  std::string path = std::to_string(libusb_get_bus_number(usb_device));
+  for (int i = 0; i < count; i++) {
+    path += (i ? "." : "-") + std::to_string(ports[i]);
   }
+  return path;
 }
 
-template <typename T>
-int ODriveUSB::write(libusb_device_handle * odrive_handle, short endpoint_id, const T & value)
+int ODriveUSB::transfer(
+  std::vector<Transaction> & transactions, std::chrono::steady_clock::time_point deadline)
 {
-  bytes request_payload;
-  bytes response_payload;
+  attachArrivedDevices();
+
+  for (Transaction & transaction : transactions) {
+    Device * odrive_device = (size_t)transaction.device < devices_.size()
+                               ? devices_[transaction.device]
+                               : device(transaction.serial_number);
+    if (!odrive_device) {
+      transaction.status = LIBUSB_ERROR_NO_DEVICE;
+      continue;
+    }
+    enqueue(odrive_device, transaction);
+  }
 
-  for (size_t i = 0; i < sizeof(value); i++) {
-    request_payload.emplace_back(((unsigned char *)&value)[i]);
+  run(deadline);
+
+  return batchStatus(transactions);
+}
+
+void ODriveUSB::setEndpointTable(int64_t serial_number, const EndpointTable & table)
+{
+  Device * odrive_device = device(serial_number);
+  if (odrive_device) {
+    odrive_device->endpoints = table;
   }
+}
 
-  return endpointOperation(odrive_handle, endpoint_id, 0, request_payload, response_payload, 1);
+bool ODriveUSB::connected(int64_t serial_number)
+{
+  Device * odrive_device = device(serial_number);
+  return odrive_device && odrive_device->connected;
+}
+
+uint32_t ODriveUSB::connections(int64_t serial_number)
+{
+  Device * odrive_device = device(serial_number);
+  return odrive_device ? odrive_device->connections : 0;
 }
 
-int ODriveUSB::call(int64_t & serial_number, short endpoint_id)
+int ODriveUSB::resolve(int64_t serial_number)
 {
-  if (serial_number) {
-    return call(odrive_map_[serial_number], endpoint_id);
-  } else {
-    return call(odrive_map_.begin()->second, endpoint_id);
+  Device * odrive_device = device(serial_number);
+  auto it = std::find(devices_.begin(), devices_.end(), odrive_device);
+  if (!odrive_device || it == devices_.end()) {
+    return LIBUSB_ERROR_NO_DEVICE;
   }
+  return it - devices_.begin();
 }
 
-int ODriveUSB::call(libusb_device_handle * odrive_handle, short endpoint_id)
+ODriveUSB::Device * ODriveUSB::device(int64_t serial_number)
 {
-  bytes request_payload;
-  bytes response_payload;
+  if (!serial_number) {
+    return odrive_map_.empty() ? NULL : odrive_map_.begin()->second;
+  }
 
-  return endpointOperation(odrive_handle, endpoint_id, 0, request_payload, response_payload, 1);
+  auto it = odrive_map_.find(serial_number);
+  return it != odrive_map_.end() ? it->second : NULL;
 }
 
-int ODriveUSB::endpointOperation(
-  libusb_device_handle * odrive_handle, short endpoint_id, short response_size,
-  bytes request_payload, bytes & response_payload, bool MSB)
+ODriveUSB::Device * ODriveUSB::openDevice(
+  libusb_device * usb_device, const std::vector<int64_t> & serial_numbers)
 {
-  int transferred = 0;
-  bytes response_packet;
-  unsigned char response_data[ODRIVE_MAX_PACKET_SIZE] = {0};
+  libusb_device_handle * odrive_handle;
+  if (libusb_open(usb_device, &odrive_handle) != LIBUSB_SUCCESS) {
+    return NULL;
+  }
 
-  if (MSB) {
-    endpoint_id |= 0x8000;
+  // Boards of other robots on the same host are left alone. Their USB serial string is the
+  // serial number in hex, and a board whose string does not parse is identified after claiming.
+  libusb_device_descriptor descriptor;
+  unsigned char serial_string[32];
+  if (
+    !serial_numbers.empty() &&
+    libusb_get_device_descriptor(usb_device, &descriptor) == LIBUSB_SUCCESS &&
+    libusb_get_string_descriptor_ascii(
+      odrive_handle, descriptor.iSerialNumber, serial_string, sizeof(serial_string) - 1) > 0) {
+    char * end;
+    int64_t serial_number = std::strtoull(reinterpret_cast<char *>(serial_string), &end, 16);
+    if (
+      !*end && std::find(serial_numbers.begin(), serial_numbers.end(), serial_number) ==
+                 serial_numbers.end()) {
+      libusb_close(odrive_handle);
+      return NULL;
+    }
   }
-  sequence_number_ = (sequence_number_ + 1) & 0x7fff;
-  sequence_number_ |= LIBUSB_ENDPOINT_IN;
-  short sequence_number = sequence_number_;
 
-  bytes request_packet = encodePacket(sequence_number, endpoint_id, response_size, request_payload);
+  if (
+    (libusb_kernel_driver_active(odrive_handle, 2) != LIBUSB_SUCCESS) &&
+    (libusb_detach_kernel_driver(odrive_handle, 2) != LIBUSB_SUCCESS)) {
+    libusb_close(odrive_handle);
+    return NULL;
+  }
+  if ((libusb_claim_interface(odrive_handle, 2)) != LIBUSB_SUCCESS) {
+    libusb_close(odrive_handle);
+    return NULL;
+  }
+
+  Device * device = new Device();
+  device->handle = odrive_handle;
+  device->usb_device = usb_device;
+  device->port_path = portPath(usb_device);
+  device->connected = true;
+  device->connections = 1;
+  device->sequence_number = 0;
+  device->next = 0;
+  device->awaited_responses = 0;
+  device->outstanding = 0;
+  device->in_halted = false;
+
+  device->slots.resize(pipeline_depth_);
+  device->in_buffers.resize(pipeline_depth_ * ODRIVE_MAX_RESPONSE_PACKET_SIZE);
+  device->idle_in_transfers.reserve(pipeline_depth_);
+  device->queue.reserve(64);
+
+  for (Slot & slot : device->slots) {
+    slot.device = device;
+    slot.transfer = libusb_alloc_transfer(0);
+    slot.transaction = NULL;
+    slot.sending = false;
+    slot.waiting = false;
+    if (!slot.transfer) {
+      closeDevice(device);
+      return NULL;
+    }
+  }
+
+  for (size_t i = 0; i < pipeline_depth_; i++) {
+    libusb_transfer * transfer = libusb_alloc_transfer(0);
+    if (!transfer) {
+      closeDevice(device);
+      return NULL;
+    }
+    transfer->buffer = &device->in_buffers[i * ODRIVE_MAX_RESPONSE_PACKET_SIZE];
+    device->in_transfers.emplace_back(transfer);
+    device->idle_in_transfers.emplace_back(transfer);
+  }
+
+  return device;
+}
+
+// Reads the serial number of a freshly opened board. A board that ignores the request usually
+// runs firmware other than odrive_endpoints.hpp was generated for, and its descriptor, which is
+// readable with any firmware, tells how to address it.
+int ODriveUSB::identify(Device * device, uint64_t & serial_number)
+{
+  Transaction transaction = Transaction::read<SERIAL_NUMBER>(0, serial_number);
+  if (transfer(device, transaction) == LIBUSB_SUCCESS) {
+    return LIBUSB_SUCCESS;
+  }
 
-  int ret = libusb_bulk_transfer(
-    odrive_handle, ODRIVE_OUT_ENDPOINT, request_packet.data(), request_packet.size(), &transferred,
-    0);
+  std::string descriptor;
+  int ret = readDescriptor(
+    [this, device](Transaction & transaction) { return transfer(device, transaction); }, 0,
+    descriptor);
   if (ret != LIBUSB_SUCCESS) {
     return ret;
   }
+  if (parseDescriptor(descriptor, device->endpoints) < 0 || device->endpoints.crc == json_crc) {
+    return LIBUSB_ERROR_NOT_SUPPORTED;
+  }
 
-  if (MSB) {
-    ret = libusb_bulk_transfer(
-      odrive_handle, ODRIVE_IN_ENDPOINT, response_data, ODRIVE_MAX_PACKET_SIZE, &transferred, 0);
-    if (ret != LIBUSB_SUCCESS) {
-      return ret;
+  transaction = Transaction::read<SERIAL_NUMBER>(0, serial_number);
+  ret = transfer(device, transaction);
+  if (ret == LIBUSB_SUCCESS) {
+    std::cout << "ODrive " << std::hex << serial_number << " has descriptor CRC 0x"
+              << device->endpoints.crc << ", using its endpoint table" << std::dec << std::endl;
+  }
+  return ret;
+}
+
+void ODriveUSB::closeDevice(Device * device)
+{
+  // IN transfers may still be posted for responses that were given up on
+  for (libusb_transfer * transfer : device->in_transfers) {
+    if (
+      std::find(device->idle_in_transfers.begin(), device->idle_in_transfers.end(), transfer) ==
+      device->idle_in_transfers.end()) {
+      libusb_cancel_transfer(transfer);
     }
+  }
+  while (device->idle_in_transfers.size() < device->in_transfers.size()) {
+    libusb_handle_events_completed(libusb_context_, NULL);
+  }
+
+  libusb_release_interface(device->handle, 2);
+  libusb_close(device->handle);
 
-    for (int i = 0; i < transferred; i++) {
-      response_packet.emplace_back(response_data[i]);
+  for (Slot & slot : device->slots) {
+    libusb_free_transfer(slot.transfer);
+  }
+  for (libusb_transfer * transfer : device->in_transfers) {
+    libusb_free_transfer(transfer);
+  }
+  delete device;
+}
+
+// Hotplug events are only delivered while libusb handles events, so poll for them before every
+// batch and re-attach boards that came back under a serial number we lost
+void ODriveUSB::attachArrivedDevices()
+{
+  if (!hotplug_registered_) {
+    return;
+  }
+
+  timeval timeout = {0, 0};
+  libusb_handle_events_timeout_completed(libusb_context_, &timeout, NULL);
+
+  while (!arrived_devices_.empty()) {
+    libusb_device * usb_device = arrived_devices_.back();
+    arrived_devices_.pop_back();
+
+    std::vector<int64_t> serial_numbers;
+    for (auto it = odrive_map_.begin(); it != odrive_map_.end(); it++) {
+      serial_numbers.emplace_back(it->first);
+    }
+    Device * odrive_device = openDevice(usb_device, serial_numbers);
+    libusb_unref_device(usb_device);
+    if (!odrive_device) {
+      continue;
+    }
+
+    uint64_t serial_number;
+    auto it = odrive_map_.end();
+    if (identify(odrive_device, serial_number) == LIBUSB_SUCCESS) {
+      it = odrive_map_.find(serial_number);
+    }
+    if (it == odrive_map_.end() || it->second->connected) {
+      closeDevice(odrive_device);
+      continue;
     }
 
-    response_payload = decodePacket(response_packet);
+    odrive_device->connections = it->second->connections + 1;
+    std::replace(devices_.begin(), devices_.end(), it->second, odrive_device);
+    closeDevice(it->second);
+    it->second = odrive_device;
+    std::cout << "Reconnected to ODrive " << std::hex << serial_number << std::dec << std::endl;
   }
+}
 
-  return LIBUSB_SUCCESS;
+int ODriveUSB::hotplugCallback(
+  libusb_context *, libusb_device * usb_device, libusb_hotplug_event event, void * user_data)
+{
+  ODriveUSB * usb = static_cast<ODriveUSB *>(user_data);
+
+  if (event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED) {
+    usb->arrived_devices_.emplace_back(libusb_ref_device(usb_device));
+  } else if (event == LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT) {
+    for (auto it = usb->odrive_map_.begin(); it != usb->odrive_map_.end(); it++) {
+      if (it->second->usb_device == usb_device) {
+        it->second->connected = false;
+      }
+    }
+  }
+
+  return 0;
+}
+
+int ODriveUSB::transfer(Transaction & transaction)
+{
+  attachArrivedDevices();
+
+  Device * odrive_device = device(transaction.serial_number);
+  if (!odrive_device) {
+    return LIBUSB_ERROR_NO_DEVICE;
+  }
+  return transfer(odrive_device, transaction);
 }
 
-bytes ODriveUSB::encodePacket(
-  short sequence_number, short endpoint_id, short response_size, const bytes & request_payload)
+int ODriveUSB::transfer(Device * device, Transaction & transaction)
 {
-  bytes packet;
+  enqueue(device, transaction);
+  run(std::chrono::steady_clock::time_point::max());
 
-  packet.emplace_back((sequence_number >> 0) & 0xFF);
-  packet.emplace_back((sequence_number >> 8) & 0xFF);
-  packet.emplace_back((endpoint_id >> 0) & 0xFF);
-  packet.emplace_back((endpoint_id >> 8) & 0xFF);
-  packet.emplace_back((response_size >> 0) & 0xFF);
-  packet.emplace_back((response_size >> 8) & 0xFF);
+  return transaction.status;
+}
 
-  for (uint8_t b : request_payload) {
-    packet.emplace_back(b);
+void ODriveUSB::enqueue(Device * device, Transaction & transaction)
+{
+  if (!device->connected) {
+    transaction.status = LIBUSB_ERROR_NO_DEVICE;
+    return;
   }
+  if (device->queue.empty()) {
+    active_devices_.emplace_back(device);
+  }
+  device->queue.emplace_back(&transaction);
+}
+
+void ODriveUSB::run(std::chrono::steady_clock::time_point deadline)
+{
+  bool busy = true;
+  bool expired = false;
+
+  while (busy) {
+    if (!expired && std::chrono::steady_clock::now() >= deadline) {
+      expired = true;
+      for (Device * device : active_devices_) {
+        cancel(*device);
+      }
+    }
+
+    busy = false;
+    for (Device * device : active_devices_) {
+      dispatch(*device);
+      // dispatch() leaves requests queued only while every slot is taken, so there is never a
+      // blocking wait with nothing in flight
+      busy |= device->outstanding > 0;
+      if (expired) {
+        busy |= device->idle_in_transfers.size() < device->in_transfers.size();
+      }
+    }
 
-  short crc = ((endpoint_id & 0x7fff) == 0) ? ODRIVE_PROTOCOL_VERSION : json_crc;
-  packet.emplace_back((crc >> 0) & 0xFF);
-  packet.emplace_back((crc >> 8) & 0xFF);
+    if (!busy) {
+      break;
+    }
+    if (expired || deadline == std::chrono::steady_clock::time_point::max()) {
+      libusb_handle_events_completed(libusb_context_, NULL);
+    } else {
+      std::chrono::microseconds remaining = std::max(
+        std::chrono::microseconds(0), std::chrono::duration_cast<std::chrono::microseconds>(
+                                        deadline - std::chrono::steady_clock::now()));
+      timeval timeout;
+      timeout.tv_sec = remaining.count() / 1000000;
+      timeout.tv_usec = remaining.count() % 1000000;
+      libusb_handle_events_timeout_completed(libusb_context_, &timeout, NULL);
+    }
+  }
 
-  return packet;
+  for (Device * device : active_devices_) {
+    device->queue.clear();
+    device->next = 0;
+  }
+  active_devices_.clear();
 }
 
-bytes ODriveUSB::decodePacket(bytes & response_packet)
+// Gives up on everything still pending for a device. Responses that arrive after their IN
+// transfer was cancelled no longer match any slot and are discarded by the next cycle.
+void ODriveUSB::cancel(Device & device)
 {
-  bytes payload;
+  for (; device.next < device.queue.size(); device.next++) {
+    device.queue[device.next]->status = LIBUSB_ERROR_TIMEOUT;
+  }
 
-  for (bytes::size_type i = 2; i < response_packet.size(); ++i) {
-    payload.emplace_back(response_packet[i]);
+  abandon(device, LIBUSB_ERROR_TIMEOUT);
+  for (Slot & slot : device.slots) {
+    if (slot.sending) {
+      slot.transaction->status = LIBUSB_ERROR_TIMEOUT;
+      libusb_cancel_transfer(slot.transfer);
+    }
   }
 
-  return payload;
+  for (libusb_transfer * transfer : device.in_transfers) {
+    if (
+      std::find(device.idle_in_transfers.begin(), device.idle_in_transfers.end(), transfer) ==
+      device.idle_in_transfers.end()) {
+      libusb_cancel_transfer(transfer);
+    }
+  }
 }
 
-template int ODriveUSB::read(int64_t &, short, bool &);
-template int ODriveUSB::read(int64_t &, short, float &);
-template int ODriveUSB::read(int64_t &, short, int32_t &);
-template int ODriveUSB::read(int64_t &, short, int64_t &);
-template int ODriveUSB::read(int64_t &, short, uint8_t &);
-template int ODriveUSB::read(int64_t &, short, uint16_t &);
-template int ODriveUSB::read(int64_t &, short, uint32_t &);
-template int ODriveUSB::read(int64_t &, short, uint64_t &);
+void ODriveUSB::dispatch(Device & device)
+{
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+  // A request that cannot be sent does not use up the slot, the next one is taken instead
+  for (Slot & slot : device.slots) {
+    while (!slot.sending && !slot.waiting && device.next < device.queue.size()) {
+      Transaction & transaction = *device.queue[device.next++];
+      transaction.status = LIBUSB_SUCCESS;
 
-template int ODriveUSB::write(int64_t &, short, const bool &);
-template int ODriveUSB::write(int64_t &, short, const float &);
-template int ODriveUSB::write(int64_t &, short, const int32_t &);
-template int ODriveUSB::write(int64_t &, short, const int64_t &);
-template int ODriveUSB::write(int64_t &, short, const uint8_t &);
-template int ODriveUSB::write(int64_t &, short, const uint16_t &);
-template int ODriveUSB::write(int64_t &, short, const uint32_t &);
-template int ODriveUSB::write(int64_t &, short, const uint64_t &);
+      short endpoint_id = device.endpoints.id(transaction.endpoint_id);
+      if (endpoint_id < 0) {
+        transaction.status = LIBUSB_ERROR_NOT_SUPPORTED;
+        continue;
+      }
+      if (transaction.ack) {
+        endpoint_id |= 0x8000;
+      }
+      device.sequence_number = (device.sequence_number + 1) & 0x7fff;
+      device.sequence_number |= LIBUSB_ENDPOINT_IN;
+
+      int length = transaction.packet ? encodePacket(
+                                          slot.buffer, device.sequence_number, endpoint_id,
+                                          *transaction.packet, transaction.request,
+                                          device.endpoints.crc)
+                                      : encodePacket(
+                                          slot.buffer, device.sequence_number, endpoint_id,
+                                          transaction.ack ? transaction.response_size : 0,
+                                          transaction.request, transaction.request_size,
+                                          device.endpoints.crc);
+      if (length < 0) {
+        transaction.status = length;
+        continue;
+      }
+
+      libusb_fill_bulk_transfer(
+        slot.transfer, device.handle, ODRIVE_OUT_ENDPOINT, slot.buffer, length, outCallback, &slot,
+        transaction_timeout_);
+      int ret = libusb_submit_transfer(slot.transfer);
+      if (ret != LIBUSB_SUCCESS) {
+        transaction.status = ret;
+        continue;
+      }
+
+      slot.transaction = &transaction;
+      slot.sequence_number = device.sequence_number;
+      slot.sending = true;
+      slot.waiting = transaction.ack;
+      slot.timeout = now + std::chrono::milliseconds(transaction_timeout_);
+      device.awaited_responses += transaction.ack;
+      device.outstanding++;
+    }
+  }
+
+  if (device.in_halted) {
+    libusb_clear_halt(device.handle, ODRIVE_IN_ENDPOINT);
+    device.in_halted = false;
+  }
+
+  // Keep one IN transfer posted for every response that is still awaited
+  while (device.awaited_responses > device.in_transfers.size() - device.idle_in_transfers.size() &&
+         !device.idle_in_transfers.empty()) {
+    libusb_transfer * transfer = device.idle_in_transfers.back();
+    libusb_fill_bulk_transfer(
+      transfer, device.handle, ODRIVE_IN_ENDPOINT, transfer->buffer,
+      ODRIVE_MAX_RESPONSE_PACKET_SIZE, inCallback, &device, transaction_timeout_);
+    int ret = libusb_submit_transfer(transfer);
+    if (ret != LIBUSB_SUCCESS) {
+      abandon(device, ret);
+      break;
+    }
+    device.idle_in_transfers.pop_back();
+  }
+}
+
+void ODriveUSB::finish(Device & device, Slot & slot, int status)
+{
+  if (status == LIBUSB_ERROR_NO_DEVICE) {
+    device.connected = false;
+  }
+  if (status != LIBUSB_SUCCESS && slot.transaction->status == LIBUSB_SUCCESS) {
+    slot.transaction->status = status;
+  }
+  if (!slot.sending && !slot.waiting) {
+    slot.transaction = NULL;
+    device.outstanding--;
+  }
+}
+
+void ODriveUSB::abandon(Device & device, int status)
+{
+  for (Slot & slot : device.slots) {
+    if (slot.waiting) {
+      slot.waiting = false;
+      device.awaited_responses--;
+      finish(device, slot, status);
+    }
+  }
+}
+
+void ODriveUSB::expire(Device & device, std::chrono::steady_clock::time_point now)
+{
+  for (Slot & slot : device.slots) {
+    if (slot.waiting && now >= slot.timeout) {
+      slot.waiting = false;
+      device.awaited_responses--;
+      finish(device, slot, LIBUSB_ERROR_TIMEOUT);
+    }
+  }
+}
+
+void ODriveUSB::outCallback(libusb_transfer * transfer)
+{
+  Slot & slot = *static_cast<Slot *>(transfer->user_data);
+  Device & device = *slot.device;
+
+  slot.sending = false;
+  int status = transferError(transfer->status);
+  if (status != LIBUSB_SUCCESS && slot.waiting) {
+    slot.waiting = false;
+    device.awaited_responses--;
+  }
+  finish(device, slot, status);
+}
+
+void ODriveUSB::inCallback(libusb_transfer * transfer)
+{
+  Device & device = *static_cast<Device *>(transfer->user_data);
+  device.idle_in_transfers.emplace_back(transfer);
+
+  // An IN transfer that timed out or was cancelled may be left over from an earlier batch, so it
+  // only fails the requests that are past their own timeout. The others get the next one.
+  int status = transferError(transfer->status);
+  if (status == LIBUSB_ERROR_TIMEOUT || status == LIBUSB_ERROR_INTERRUPTED) {
+    expire(device, std::chrono::steady_clock::now());
+    return;
+  }
+  if (status != LIBUSB_SUCCESS) {
+    device.in_halted = status == LIBUSB_ERROR_PIPE || status == LIBUSB_ERROR_OVERFLOW;
+    abandon(device, status);
+    return;
+  }
+  if (transfer->actual_length < 2) {
+    return;
+  }
+
+  // Responses echo the sequence number with the MSB set. Late responses to cancelled requests
+  // carry a sequence number no slot is waiting for.
+  short sequence_number = (transfer->buffer[0] | (transfer->buffer[1] << 8)) & 0x7fff;
+  for (Slot & slot : device.slots) {
+    if (slot.waiting && slot.sequence_number == sequence_number) {
+      int length = decodePacket(
+        transfer->buffer, transfer->actual_length, slot.transaction->response,
+        slot.transaction->response_size);
+      if (slot.transaction->endpoint_id == 0) {
+        slot.transaction->response_size = length;
+      }
+
+      slot.waiting = false;
+      device.awaited_responses--;
+      finish(
+        device, slot,
+        length == slot.transaction->response_size ? LIBUSB_SUCCESS : LIBUSB_ERROR_IO);
+      return;
+    }
+  }
+}
+
+int ODriveUSB::transferError(libusb_transfer_status status)
+{
+  switch (status) {
+    case LIBUSB_TRANSFER_COMPLETED:
+      return LIBUSB_SUCCESS;
+    case LIBUSB_TRANSFER_TIMED_OUT:
+      return LIBUSB_ERROR_TIMEOUT;
+    case LIBUSB_TRANSFER_STALL:
+      return LIBUSB_ERROR_PIPE;
+    case LIBUSB_TRANSFER_NO_DEVICE:
+      return LIBUSB_ERROR_NO_DEVICE;
+    case LIBUSB_TRANSFER_OVERFLOW:
+      return LIBUSB_ERROR_OVERFLOW;
+    case LIBUSB_TRANSFER_CANCELLED:
+      return LIBUSB_ERROR_INTERRUPTED;
+    default:
+      return LIBUSB_ERROR_IO;
+  }
+}
 }  // namespace odrive
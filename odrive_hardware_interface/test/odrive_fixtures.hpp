@@ -0,0 +1,82 @@
+// Copyright 2021 Factor Robotics
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Shared by the tests and benchmarks that run the hardware interface on emulated ODrives. It
+// replaces the global operator new, so it is included from one translation unit per program.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <string>
+
+#include "odrive_hardware_interface/odrive_emulator.hpp"
+#include "odrive_hardware_interface/odrive_hardware_interface.hpp"
+
+namespace odrive_fixtures
+{
+// Every allocation goes through here, so that the ones made inside read() and write() are counted
+static std::atomic<uint64_t> allocations(0);
+
+const int64_t serial_number_base = 0x200000000000;
+
+inline hardware_interface::ComponentInfo component(
+  const std::string & name, int64_t serial_number)
+{
+  std::ostringstream serial;
+  serial << std::hex << serial_number;
+
+  hardware_interface::ComponentInfo info;
+  info.name = name;
+  info.parameters["serial_number"] = serial.str();
+  return info;
+}
+
+// A sensor per board and a joint per axis, without watchdogs or any of the caches
+inline hardware_interface::HardwareInfo hardwareInfo(size_t joints)
+{
+  hardware_interface::HardwareInfo info;
+  info.hardware_parameters["descriptor_cache"] = "";
+  info.hardware_parameters["config_cache"] = "";
+  for (size_t i = 0; i < joints; i++) {
+    int64_t serial_number = serial_number_base + i / ODRIVE_EMULATOR_AXIS_COUNT;
+    if (i % ODRIVE_EMULATOR_AXIS_COUNT == 0) {
+      info.sensors.emplace_back(
+        component("odrive" + std::to_string(i / ODRIVE_EMULATOR_AXIS_COUNT), serial_number));
+    }
+
+    info.joints.emplace_back(component("joint" + std::to_string(i), serial_number));
+    info.joints.back().parameters["axis"] = std::to_string(i % ODRIVE_EMULATOR_AXIS_COUNT);
+    info.joints.back().parameters["enable_watchdog"] = "0";
+  }
+  return info;
+}
+}  // namespace odrive_fixtures
+
+void * operator new(size_t size)
+{
+  odrive_fixtures::allocations.fetch_add(1, std::memory_order_relaxed);
+  void * memory = std::malloc(size ? size : 1);
+  if (!memory) {
+    throw std::bad_alloc();
+  }
+  return memory;
+}
+
+void operator delete(void * memory) noexcept { std::free(memory); }
+
+void operator delete(void * memory, size_t) noexcept { std::free(memory); }
@@ -0,0 +1,97 @@
+// Copyright 2021 Factor Robotics
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "odrive_fixtures.hpp"
+
+using namespace odrive;
+using namespace odrive_fixtures;
+
+namespace
+{
+// Two joints per board with watchdogs, and slow interfaces polled every few cycles or at a fixed
+// rate
+hardware_interface::HardwareInfo watchedHardwareInfo(size_t joints)
+{
+  hardware_interface::HardwareInfo info = hardwareInfo(joints);
+  for (hardware_interface::ComponentInfo & sensor : info.sensors) {
+    sensor.parameters["vbus_voltage_poll_rate"] = "50";
+  }
+  for (hardware_interface::ComponentInfo & joint : info.joints) {
+    joint.parameters["enable_watchdog"] = "1";
+    joint.parameters["watchdog_timeout"] = "1";
+    joint.parameters["fet_temperature_poll_divisor"] = "10";
+    joint.parameters["motor_temperature_poll_divisor"] = "10";
+    joint.parameters["input_pos_deadband"] = "0.001";
+  }
+  return info;
+}
+
+// Counts the allocations of cycles of read() and write() from the first one after activation
+uint64_t cycleAllocations(hardware_interface::HardwareInfo info, int cycles)
+{
+  ODriveEmulator emulator;
+  odrive_hardware_interface::ODriveHardwareInterface hardware(&emulator);
+  EXPECT_EQ(hardware.on_init(info), CallbackReturn::SUCCESS);
+  EXPECT_EQ(hardware.on_configure(rclcpp_lifecycle::State()), CallbackReturn::SUCCESS);
+  std::vector<hardware_interface::StateInterface> state_interfaces =
+    hardware.export_state_interfaces();
+  std::vector<hardware_interface::CommandInterface> command_interfaces =
+    hardware.export_command_interfaces();
+  EXPECT_EQ(hardware.on_activate(rclcpp_lifecycle::State()), CallbackReturn::SUCCESS);
+
+  std::vector<std::string> start_interfaces;
+  for (const hardware_interface::ComponentInfo & joint : info.joints) {
+    start_interfaces.emplace_back(joint.name + "/" + hardware_interface::HW_IF_POSITION);
+  }
+  EXPECT_EQ(hardware.prepare_command_mode_switch(start_interfaces, {}), return_type::OK);
+  EXPECT_EQ(hardware.perform_command_mode_switch(start_interfaces, {}), return_type::OK);
+
+  rclcpp::Time time;
+  rclcpp::Duration period(0, 1000000);
+  uint64_t start = allocations.load();
+  for (int i = 0; i < cycles; i++) {
+    for (hardware_interface::CommandInterface & command_interface : command_interfaces) {
+      command_interface.set_value(0.01 * (i % 7));
+    }
+    EXPECT_EQ(hardware.read(time, period), return_type::OK);
+    EXPECT_EQ(hardware.write(time, period), return_type::OK);
+  }
+  return allocations.load() - start;
+}
+}  // namespace
+
+TEST(ZeroAllocation, AcknowledgedSetpoints)
+{
+  EXPECT_EQ(cycleAllocations(watchedHardwareInfo(6), 200), 0u);
+}
+
+TEST(ZeroAllocation, UnacknowledgedSetpointsWithReadBack)
+{
+  hardware_interface::HardwareInfo info = watchedHardwareInfo(6);
+  info.hardware_parameters["acknowledge_setpoints"] = "0";
+  info.hardware_parameters["setpoint_verify_period"] = "5";
+  EXPECT_EQ(cycleAllocations(info, 200), 0u);
+}
+
+TEST(ZeroAllocation, TransactionBudget)
+{
+  hardware_interface::HardwareInfo info = watchedHardwareInfo(6);
+  info.hardware_parameters["cycle_transaction_budget"] = "30";
+  EXPECT_EQ(cycleAllocations(info, 200), 0u);
+}